@@ -0,0 +1,493 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "ds1302.h"
+# include "settings.h"
+# include "telemetry.h"
+# include "uart.h"
+# include "alarm.h"
+
+
+// ------------------------------------------------------------ //
+// names of the types (console)
+
+static const char alarm_type_names[ALARM_TYPES][6] PROGMEM = {"off", "daily", "days", "once"};
+
+
+// ------------------------------------------------------------ //
+// removes an alarm from the sorted list (if it is in it)
+
+static void ALARMSremove(Alarms * alarms, uint8_t index) {
+    
+    uint8_t i;
+    
+    for (i = 0; i < alarms->_active && alarms->_order[i] != index; i++);
+    
+    if (i == alarms->_active) {
+        
+        return;
+        
+    }
+    
+    alarms->_active--;
+    
+    for (; i < alarms->_active; i++) {
+        
+        alarms->_order[i] = alarms->_order[i + 1];
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// computes the next fire time of an alarm and inserts it at its
+// place in the sorted list (alarms that never fire are left out)
+
+static void ALARMSinsert(Alarms * alarms, uint8_t index, uint32_t now) {
+    
+    uint32_t next = ALARMnextFire(&alarms->entries[index], now);
+    uint8_t i;
+    
+    alarms->evaluations++;
+    alarms->_next[index] = next;
+    
+    if (next == ALARM_NEVER) {
+        
+        return;
+        
+    }
+    
+    // shift the later ones back, equal times keep their order
+    for (i = alarms->_active; i > 0 && alarms->_next[alarms->_order[i - 1]] > next; i--) {
+        
+        alarms->_order[i] = alarms->_order[i - 1];
+        
+    }
+    
+    alarms->_order[i] = index;
+    alarms->_active++;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// marks an alarm for writing to EEPROM
+
+static void ALARMSmarkDirty(Alarms * alarms, uint8_t index) {
+    
+    alarms->_dirty |= (1 << index);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// loads the alarms from EEPROM, slots that fail the crc are off
+// (the schedule is computed by ALARMSschedule once the time is
+// known)
+
+void ALARMSload(Alarms * alarms) {
+    
+    uint8_t buffer[ALARM_SLOT_SIZE];
+    uint16_t address;
+    
+    for (uint8_t index = 0; index < ALARMS_MAX; index++) {
+        
+        address = ALARMS_EEPROM_BASE + index * ALARM_SLOT_SIZE;
+        
+        for (uint8_t i = 0; i < ALARM_SLOT_SIZE; i++) {
+            
+            buffer[i] = hal_eeprom_read(address + i);
+            
+        }
+        
+        // same crc as the telemetry frames and the settings
+        if (TELcrc8(buffer, ALARM_SLOT_SIZE - 1) == buffer[ALARM_SLOT_SIZE - 1] && buffer[0] < ALARM_TYPES) {
+            
+            memcpy(&alarms->entries[index], buffer, sizeof(alarmEntry));
+            
+        } else {
+            
+            memset(&alarms->entries[index], 0, sizeof(alarmEntry));
+            
+        }
+        
+        alarms->_next[index] = ALARM_NEVER;
+        
+    }
+    
+    alarms->_active      = 0;
+    alarms->_dirty       = 0;
+    alarms->_write_pos   = 0xFF;
+    alarms->fired        = 0;
+    alarms->missed       = 0;
+    alarms->evaluations  = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// changes an alarm, reschedules only that one and queues it for
+// writing
+
+void ALARMSset(Alarms * alarms, uint8_t index, const alarmEntry * entry, uint32_t now) {
+    
+    if (index >= ALARMS_MAX) {
+        
+        return;
+        
+    }
+    
+    ALARMSremove(alarms, index);
+    alarms->entries[index] = *entry;
+    ALARMSinsert(alarms, index, now);
+    ALARMSmarkDirty(alarms, index);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call regularly from the main loop, writes at most one byte
+// per call (only when the EEPROM is ready)
+
+void ALARMSservice(Alarms * alarms) {
+    
+    uint16_t address;
+    
+    // start writing the next changed alarm
+    if (alarms->_write_pos == 0xFF) {
+        
+        if (!alarms->_dirty) {
+            
+            return;
+            
+        }
+        
+        for (alarms->_write_alarm = 0; !(alarms->_dirty & (1 << alarms->_write_alarm)); alarms->_write_alarm++);
+        
+        alarms->_dirty &= ~(1 << alarms->_write_alarm);
+        memcpy(alarms->_buffer, &alarms->entries[alarms->_write_alarm], sizeof(alarmEntry));
+        alarms->_buffer[ALARM_SLOT_SIZE - 1] = TELcrc8(alarms->_buffer, ALARM_SLOT_SIZE - 1);
+        alarms->_write_pos = 0;
+        
+    }
+    
+    // previous byte (or a settings byte) still being written
+    if (!hal_eeprom_ready()) {
+        
+        return;
+        
+    }
+    
+    address = ALARMS_EEPROM_BASE + alarms->_write_alarm * ALARM_SLOT_SIZE + alarms->_write_pos;
+    hal_eeprom_update(address, alarms->_buffer[alarms->_write_pos]);
+    
+    if (++alarms->_write_pos == ALARM_SLOT_SIZE) {
+        
+        alarms->_write_pos = 0xFF;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// computes the schedule of all alarms (after power on or when
+// the time was set)
+
+void ALARMSschedule(Alarms * alarms, uint32_t now) {
+    
+    alarms->_active = 0;
+    
+    for (uint8_t index = 0; index < ALARMS_MAX; index++) {
+        
+        ALARMSinsert(alarms, index, now);
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call once per second with the local time, returns the index
+// of the alarm that fired or ALARM_NONE
+//
+// only the first alarm of the list is compared, one that fired
+// gets its next time and moves back to its place, one-shot alarms
+// are switched off (and written)
+
+uint8_t ALARMScheck(Alarms * alarms, uint32_t now) {
+    
+    uint8_t index;
+    uint8_t late;
+    
+    while (alarms->_active && alarms->_next[alarms->_order[0]] <= now) {
+        
+        index = alarms->_order[0];
+        late  = now - alarms->_next[index] > ALARMS_MISSED_LIMIT;
+        
+        ALARMSremove(alarms, index);
+        
+        if (alarms->entries[index].type == ALARM_ONCE) {
+            
+            alarms->entries[index].type = ALARM_OFF;
+            alarms->_next[index] = ALARM_NEVER;
+            ALARMSmarkDirty(alarms, index);
+            
+        } else {
+            
+            ALARMSinsert(alarms, index, now);
+            
+        }
+        
+        if (!late) {
+            
+            alarms->fired++;
+            return index;
+            
+        }
+        
+        // skipped, the next one may still be due
+        alarms->missed++;
+        
+    }
+    
+    return ALARM_NONE;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// fire time of the first alarm in the list
+
+uint32_t ALARMSnext(const Alarms * alarms) {
+    
+    return alarms->_active ? alarms->_next[alarms->_order[0]] : ALARM_NEVER;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// first time after now at which the alarm fires (local seconds)
+
+uint32_t ALARMnextFire(const alarmEntry * entry, uint32_t now) {
+    
+    timeData date = {0, entry->minute, entry->hour, entry->day, entry->month, 0, entry->year};
+    uint32_t midnight = now - now % 86400UL;
+    uint32_t time = entry->hour * 3600UL + entry->minute * 60UL;
+    uint16_t days = now / 86400UL;
+    
+    switch (entry->type) {
+        
+        case ALARM_DAILY:
+            
+            return (midnight + time > now) ? midnight + time : midnight + 86400UL + time;
+        
+        case ALARM_WEEKDAYS:
+            
+            // today (if the time is still ahead) and the next 7 days (2000-01-01 was a saturday)
+            for (uint8_t i = 0; i < 8; i++) {
+                
+                if ((entry->days & (1 << ((days + i + 6) % 7))) && midnight + i * 86400UL + time > now) {
+                    
+                    return midnight + i * 86400UL + time;
+                    
+                }
+                
+            }
+            
+            return ALARM_NEVER;
+        
+        case ALARM_ONCE:
+            
+            if (entry->month < 1 || entry->month > 12 || entry->year > 99 || entry->day < 1 || entry->day > DS1302daysInMonth(entry->month, entry->year)) {
+                
+                return ALARM_NEVER;
+                
+            }
+            
+            time = DS1302timeDataToSeconds(&date);
+            
+            return (time > now) ? time : ALARM_NEVER;
+        
+        default:
+            
+            return ALARM_NEVER;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// prints one alarm and its next fire time
+
+static void ALARMSprint(const Alarms * alarms, uint8_t index) {
+    
+    const alarmEntry * entry = &alarms->entries[index];
+    char type[6];
+    char line[48];
+    uint8_t length;
+    timeData next;
+    
+    strcpy_P(type, alarm_type_names[entry->type]);
+    length = snprintf_P(line, sizeof(line), PSTR("%u %s"), index + 1, type);
+    
+    if (entry->type != ALARM_OFF) {
+        
+        length += snprintf_P(line + length, sizeof(line) - length, PSTR(" %02u:%02u"), entry->hour, entry->minute);
+        
+    }
+    
+    if (entry->type == ALARM_WEEKDAYS) {
+        
+        line[length++] = ' ';
+        
+        for (uint8_t day = 0; day < 7; day++) {
+            
+            if (entry->days & (1 << day)) {
+                
+                line[length++] = '0' + day;
+                
+            }
+            
+        }
+        
+    } else if (entry->type == ALARM_ONCE) {
+        
+        length += snprintf_P(line + length, sizeof(line) - length, PSTR(" 20%02u-%02u-%02u"),
+                             entry->year, entry->month, entry->day);
+        
+    }
+    
+    if (alarms->_next[index] != ALARM_NEVER) {
+        
+        DS1302timeDataFromSeconds(&next, alarms->_next[index]);
+        length += snprintf_P(line + length, sizeof(line) - length, PSTR(" next 20%02u-%02u-%02u %02u:%02u"),
+                             next.year, next.month, next.day, next.hour, next.minute);
+        
+    }
+    
+    line[length] = '\0';
+    UARTprint(line);
+    UARTprint_P(PSTR("\r\n"));
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command, now = local time
+//
+//   alarm                               lists all alarms
+//   alarm <n> off
+//   alarm <n> daily HH:MM
+//   alarm <n> days HH:MM <days>         days as digits, 0 or 7 = sunday
+//   alarm <n> once YYYY-MM-DD HH:MM
+
+void ALARMScommand(Alarms * alarms, char * args, uint32_t now) {
+    
+    alarmEntry entry = {ALARM_OFF, 0, 0, 0, 0, 0, 0};
+    unsigned int number, hour = 0, minute = 0, year, month, day;
+    char type[6];
+    char days[9];
+    int fields;
+    
+    if (*args == '\0') {
+        
+        for (uint8_t index = 0; index < ALARMS_MAX; index++) {
+            
+            ALARMSprint(alarms, index);
+            
+        }
+        
+        return;
+        
+    }
+    
+    fields = sscanf_P(args, PSTR("%u %5s"), &number, type);
+    
+    if (fields != 2 || number < 1 || number > ALARMS_MAX) {
+        
+        UARTprint_P(PSTR("error: alarm <1-8> off|daily|days|once ...\r\n"));
+        return;
+        
+    }
+    
+    for (entry.type = 0; entry.type < ALARM_TYPES && strcmp_P(type, alarm_type_names[entry.type]) != 0; entry.type++);
+    
+    switch (entry.type) {
+        
+        case ALARM_OFF:
+            
+            fields = 0;
+            break;
+        
+        case ALARM_DAILY:
+            
+            fields = (sscanf_P(args, PSTR("%*u %*s %u:%u"), &hour, &minute) == 2) ? 0 : -1;
+            break;
+        
+        case ALARM_WEEKDAYS:
+            
+            fields = (sscanf_P(args, PSTR("%*u %*s %u:%u %8s"), &hour, &minute, days) == 3) ? 0 : -1;
+            
+            for (uint8_t i = 0; fields == 0 && days[i] != '\0'; i++) {
+                
+                if (days[i] < '0' || days[i] > '7') {
+                    
+                    fields = -1;
+                    break;
+                    
+                }
+                
+                entry.days |= 1 << ((days[i] - '0') % 7);
+                
+            }
+            
+            break;
+        
+        case ALARM_ONCE:
+            
+            fields = (sscanf_P(args, PSTR("%*u %*s %u-%u-%u %u:%u"), &year, &month, &day, &hour, &minute) == 5 &&
+                      year >= 2000 && year <= 2099 && month >= 1 && month <= 12 && day >= 1 && day <= DS1302daysInMonth(month, year - 2000)) ? 0 : -1;
+            entry.year  = year - 2000;
+            entry.month = month;
+            entry.day   = day;
+            break;
+        
+        default:
+            
+            fields = -1;
+            break;
+        
+    }
+    
+    if (entry.type != ALARM_OFF && fields == 0 && (hour > 23 || minute > 59)) {
+        
+        fields = -1;
+        
+    }
+    
+    if (fields != 0) {
+        
+        UARTprint_P(PSTR("error: bad alarm\r\n"));
+        return;
+        
+    }
+    
+    if (entry.type != ALARM_OFF) {
+        
+        entry.hour   = hour;
+        entry.minute = minute;
+        
+    }
+    
+    ALARMSset(alarms, number - 1, &entry, now);
+    ALARMSprint(alarms, number - 1);
+    
+}
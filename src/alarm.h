@@ -0,0 +1,116 @@
+# ifndef ALARM_H
+# define ALARM_H
+
+// ------------------------------------------------------------ //
+// alarms and timers
+//
+// every alarm fires at a wall clock time (local time, see
+// timezone.h), either every day, on the days of a week mask or
+// once at a date:
+//
+//   type | hour | minute | days | day | month | year
+//
+// the next fire time (local seconds since 2000) is computed when
+// an alarm is set or fires, the active alarms are kept sorted by
+// it, so a tick only compares the time with the first one
+//
+// alarms are stored in EEPROM behind the settings ring, one slot
+// with a crc per alarm (they change rarely, so no wear leveling),
+// written one byte per call of ALARMSservice like the settings
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define ALARMS_MAX               8
+# define ALARMS_EEPROM_BASE       (SETTINGS_EEPROM_BASE + SETTINGS_SLOTS * SETTINGS_SLOT_SIZE)
+
+// alarms that are more than this late (s) are skipped instead of
+// fired (e.g. after the clock was set forward)
+# define ALARMS_MISSED_LIMIT      3600
+
+// no fire time / no alarm fired
+# define ALARM_NEVER              0xFFFFFFFFUL
+# define ALARM_NONE               0xFF
+
+
+// ------------------------------------------------------------ //
+// alarm types and the stored record
+
+enum alarmTypes {
+    ALARM_OFF = 0,
+    ALARM_DAILY,
+    ALARM_WEEKDAYS,
+    ALARM_ONCE,
+    ALARM_TYPES
+};
+
+typedef struct alarmEntry {
+    
+    uint8_t type;
+    uint8_t hour;
+    uint8_t minute;
+    
+    // week mask for ALARM_WEEKDAYS (bit 0 = sunday, as dayofweek)
+    uint8_t days;
+    
+    // date for ALARM_ONCE (year 0-99 = 2000-2099)
+    uint8_t day;
+    uint8_t month;
+    uint8_t year;
+    
+} alarmEntry;
+
+// record and crc
+# define ALARM_SLOT_SIZE          (sizeof(alarmEntry) + 1)
+
+
+// ------------------------------------------------------------ //
+// struct for storing the alarms and the schedule
+
+typedef struct Alarms {
+    
+    alarmEntry entries[ALARMS_MAX];
+    
+    // next fire time of every alarm and the active ones sorted by it
+    uint32_t _next[ALARMS_MAX];
+    uint8_t _order[ALARMS_MAX];
+    uint8_t _active;
+    
+    // alarms waiting to be written (bit mask) and the write in progress
+    uint8_t _dirty;
+    uint8_t _write_alarm;
+    uint8_t _write_pos;
+    uint8_t _buffer[ALARM_SLOT_SIZE];
+    
+    // statistics
+    uint16_t fired;
+    uint16_t missed;
+    uint16_t evaluations;
+    
+} Alarms;
+
+
+// ------------------------------------------------------------ //
+// loading, changing and committing
+
+void ALARMSload(Alarms * alarms);
+void ALARMSset(Alarms * alarms, uint8_t index, const alarmEntry * entry, uint32_t now);
+void ALARMSservice(Alarms * alarms);
+
+
+// ------------------------------------------------------------ //
+// scheduling (now = local seconds since 2000)
+
+void ALARMSschedule(Alarms * alarms, uint32_t now);
+uint8_t ALARMScheck(Alarms * alarms, uint32_t now);
+uint32_t ALARMSnext(const Alarms * alarms);
+uint32_t ALARMnextFire(const alarmEntry * entry, uint32_t now);
+
+
+// ------------------------------------------------------------ //
+// console command ("alarm ...", arguments behind the word)
+
+void ALARMScommand(Alarms * alarms, char * args, uint32_t now);
+
+# endif
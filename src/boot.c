@@ -0,0 +1,95 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+
+# include "hal.h"
+# include "boot.h"
+
+
+// ------------------------------------------------------------ //
+// names of the phases (in flash)
+
+static const char boot_name_lcd_poweron[] PROGMEM = "lcd_poweron";
+static const char boot_name_sensor[] PROGMEM      = "sensor";
+static const char boot_name_settings[] PROGMEM    = "settings";
+static const char boot_name_rtc[] PROGMEM         = "rtc";
+static const char boot_name_lcd_ready[] PROGMEM   = "lcd_ready";
+static const char boot_name_first_frame[] PROGMEM = "first_frame";
+static const char boot_name_climate[] PROGMEM     = "climate";
+
+static const char * const boot_names[BOOT_PHASES] PROGMEM = {
+    boot_name_lcd_poweron,
+    boot_name_sensor,
+    boot_name_settings,
+    boot_name_rtc,
+    boot_name_lcd_ready,
+    boot_name_first_frame,
+    boot_name_climate
+};
+
+
+// ------------------------------------------------------------ //
+// time of every phase (HALmicros)
+
+static uint32_t boot_stamps[BOOT_PHASES];
+
+
+// ------------------------------------------------------------ //
+// no phase reached
+
+void BOOTinit(void) {
+    
+    for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+        
+        boot_stamps[i] = BOOT_PENDING;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// stores the time of a phase, later calls keep the first one
+// (cheap enough to be called on every pass of a loop)
+
+void BOOTmark(uint8_t phase) {
+    
+    if (boot_stamps[phase] == BOOT_PENDING) {
+        
+        boot_stamps[phase] = HALmicros();
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// returns 1 if the phase was reached
+
+uint8_t BOOTreached(uint8_t phase) {
+    
+    return boot_stamps[phase] != BOOT_PENDING;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// time of the phase in us since HALtimerInit (BOOT_PENDING if
+// it was not reached)
+
+uint32_t BOOTtime(uint8_t phase) {
+    
+    return boot_stamps[phase];
+    
+}
+
+
+// ------------------------------------------------------------ //
+// name of the phase (string in flash)
+
+const char * BOOTname(uint8_t phase) {
+    
+    return pgm_read_ptr(&boot_names[phase]);
+    
+}
@@ -0,0 +1,47 @@
+# ifndef BOOT_H
+# define BOOT_H
+
+// ------------------------------------------------------------ //
+// boot timeline
+//
+// the start-up phases overlap: the power on wait of the LCD
+// (LCD_POWERON_US) and the start-up of the DHT11 begin right
+// after the timer, the settings and the RTC are read while they
+// elapse, and the panel is only initialized once its wait passed
+//
+// every phase stores when it was first reached, in us since
+// HALtimerInit (the first thing main does, so since reset
+// without the start-up time of the fuses or a bootloader)
+//
+// "boot" on the serial console prints the timeline, the host
+// build prints it after the run
+
+
+// ------------------------------------------------------------ //
+// phases in the order main reaches them
+
+enum bootPhases {
+    BOOT_LCD_POWERON = 0,   // power on wait of the LCD started
+    BOOT_SENSOR,            // DHT11 start-up started
+    BOOT_SETTINGS,          // settings, alarms and history loaded
+    BOOT_RTC,               // time read from the RTC, alarms scheduled
+    BOOT_LCD_READY,         // initialization of the LCD complete
+    BOOT_FIRST_FRAME,       // first screen drawn with the time
+    BOOT_CLIMATE,           // first valid DHT11 reading
+    BOOT_PHASES
+};
+
+// phase not reached yet
+# define BOOT_PENDING    0xFFFFFFFFUL
+
+
+// ------------------------------------------------------------ //
+// recording and readout
+
+void BOOTinit(void);
+void BOOTmark(uint8_t phase);
+uint8_t BOOTreached(uint8_t phase);
+uint32_t BOOTtime(uint8_t phase);
+const char * BOOTname(uint8_t phase);
+
+# endif
@@ -0,0 +1,170 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+
+# include "hal.h"
+# include "profile.h"
+# include "comfort.h"
+
+
+// ------------------------------------------------------------ //
+// log2(1 + i / 16) in Q12
+
+static const uint16_t comfort_log2[17] PROGMEM = {
+       0,  358,  696, 1016, 1319, 1607, 1882, 2145, 2396,
+    2637, 2869, 3092, 3307, 3514, 3715, 3908, 4096
+};
+
+
+// ------------------------------------------------------------ //
+// heat index (0.1 C) by temperature (rows, 26-50 C in steps of
+// 2 C) and humidity (columns, 40-100 % in steps of 10 %)
+
+static const int16_t comfort_heat[13][7] PROGMEM = {
+    { 262,  266,  269,  273,  277,  280,  284},  // 26 C
+    { 277,  284,  294,  307,  321,  337,  356},  // 28 C
+    { 297,  310,  328,  350,  377,  407,  442},  // 30 C
+    { 323,  344,  371,  404,  444,  490,  542},  // 32 C
+    { 354,  384,  422,  468,  522,  584,  655},  // 34 C
+    { 391,  431,  481,  542,  612,  692,  782},  // 36 C
+    { 434,  486,  550,  625,  713,  812,  924},  // 38 C
+    { 483,  548,  626,  719,  825,  945, 1079},  // 40 C
+    { 537,  617,  712,  823,  949, 1090, 1248},  // 42 C
+    { 596,  693,  806,  936, 1084, 1249, 1430},  // 44 C
+    { 662,  776,  909, 1060, 1230, 1419, 1627},  // 46 C
+    { 733,  866, 1020, 1194, 1388, 1602, 1837},  // 48 C
+    { 809,  964, 1140, 1337, 1557, 1798, 2062},  // 50 C
+};
+
+
+// ------------------------------------------------------------ //
+// division rounded to the nearest integer (den > 0)
+
+static int32_t COMFORTdivide(int32_t num, int32_t den) {
+    
+    return (num >= 0) ? (num + den / 2) / den : (num - den / 2) / den;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// log2(x) in Q12 for x >= 1 (error below 0.0004)
+
+int32_t COMFORTlog2(uint16_t x) {
+    
+    uint8_t exponent = 15;
+    uint16_t fraction;
+    uint8_t index;
+    int16_t low;
+    int16_t high;
+    
+    // x = 2^exponent * (1 + fraction / 2^15)
+    while (!(x & 0x8000)) {
+        
+        x <<= 1;
+        exponent--;
+        
+    }
+    
+    fraction = x & 0x7FFF;
+    index    = fraction >> 11;
+    low      = pgm_read_word(&comfort_log2[index]);
+    high     = pgm_read_word(&comfort_log2[index + 1]);
+    
+    return ((int32_t) exponent << 12) + low + (((int32_t) (high - low) * (fraction & 0x07FF)) >> 11);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// dew point (0.1 C) with the Magnus formula
+//
+//   gamma = ln(RH) + b * T / (c + T)
+//   Td    = c * gamma / (b - gamma)
+
+int16_t COMFORTdewPoint(int16_t temperature, uint16_t humidity) {
+    
+    PROFILE_BEGIN(PROF_DEWPOINT);
+    
+    int32_t gamma;
+    int16_t dewpoint;
+    
+    if (humidity < 1) {
+        
+        humidity = 1;
+        
+    } else if (humidity > 1000) {
+        
+        humidity = 1000;
+        
+    }
+    
+    // ln(humidity / 1000) = ln(2) * (log2(humidity) - log2(1000))
+    gamma  = (COMFORTlog2(humidity) - COMFORTlog2(1000)) * COMFORT_LN2 / 4096;
+    gamma += COMFORTdivide(COMFORT_MAGNUS_B * temperature * 10, COMFORT_MAGNUS_C + temperature * 10L);
+    
+    dewpoint = COMFORTdivide(COMFORT_MAGNUS_C * gamma, 10 * (COMFORT_MAGNUS_B - gamma));
+    
+    PROFILE_END(PROF_DEWPOINT);
+    
+    return dewpoint;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// heat index (0.1 C), the temperature below the range of the
+// regression, COMFORT_HEAT_NONE above it
+
+int16_t COMFORTheatIndex(int16_t temperature, uint16_t humidity) {
+    
+    PROFILE_BEGIN(PROF_HEATINDEX);
+    
+    uint8_t row, col;
+    int16_t dt, dh;
+    int32_t low, high;
+    int16_t heat = temperature;
+    
+    if (temperature > COMFORT_HEAT_MAX_T && humidity >= COMFORT_HEAT_MIN_H) {
+        
+        heat = COMFORT_HEAT_NONE;
+        
+    } else if (temperature >= COMFORT_HEAT_MIN_T && humidity >= COMFORT_HEAT_MIN_H) {
+        
+        // position in the table, the last cell also covers its upper edge
+        humidity = (humidity > 1000) ? 1000 : humidity;
+        row = (temperature - 260) / 20;
+        dt  = (temperature - 260) % 20;
+        col = (humidity - 400) / 100;
+        dh  = (humidity - 400) % 100;
+        
+        if (row == 12) {
+            
+            row = 11;
+            dt  = 20;
+            
+        }
+        
+        if (col == 6) {
+            
+            col = 5;
+            dh  = 100;
+            
+        }
+        
+        // along the temperature for both columns, then along the humidity
+        low  = (int32_t) (int16_t) pgm_read_word(&comfort_heat[row][col]) * (20 - dt) +
+               (int32_t) (int16_t) pgm_read_word(&comfort_heat[row + 1][col]) * dt;
+        high = (int32_t) (int16_t) pgm_read_word(&comfort_heat[row][col + 1]) * (20 - dt) +
+               (int32_t) (int16_t) pgm_read_word(&comfort_heat[row + 1][col + 1]) * dt;
+        
+        heat = COMFORTdivide(low * (100 - dh) + high * dh, 2000);
+        
+    }
+    
+    PROFILE_END(PROF_HEATINDEX);
+    
+    return heat;
+    
+}
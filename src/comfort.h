@@ -0,0 +1,56 @@
+# ifndef COMFORT_H
+# define COMFORT_H
+
+// ------------------------------------------------------------ //
+// dew point and heat index from temperature and humidity
+//
+// integer math only (no libm), inputs and results in tenths
+// (0.1 C, 0.1 %):
+//
+// dew point:  Magnus formula, the logarithm of the humidity is
+//             taken from a 17 entry log2 table (linear
+//             interpolation between the entries)
+//
+// heat index: Rothfusz regression (as used by the NOAA), looked
+//             up in a 13 x 7 table (26-50 C, 40-100 %) with
+//             bilinear interpolation, below 27 C or 40 % it is
+//             the temperature itself, above 50 C (from 40 %)
+//             it is COMFORT_HEAT_NONE
+//
+// host/comfortcheck.c compares both with double precision
+// references ("make comfortcheck")
+
+
+// ------------------------------------------------------------ //
+// settings
+
+// constants of the Magnus formula (b = 17.62 in Q12, c = 243.12 C
+// in 0.01 C)
+# define COMFORT_MAGNUS_B         72172L
+# define COMFORT_MAGNUS_C         24312L
+
+// ln(2) in Q12
+# define COMFORT_LN2              2839L
+
+// range of the heat index
+# define COMFORT_HEAT_MIN_T       270
+# define COMFORT_HEAT_MAX_T       500
+# define COMFORT_HEAT_MIN_H       400
+
+// heat index above the table, shown as "--"
+# define COMFORT_HEAT_NONE        INT16_MIN
+
+
+// ------------------------------------------------------------ //
+// user commands for the metrics
+
+int16_t COMFORTdewPoint(int16_t temperature, uint16_t humidity);
+int16_t COMFORTheatIndex(int16_t temperature, uint16_t humidity);
+
+
+// ------------------------------------------------------------ //
+// fixed-point helpers
+
+int32_t COMFORTlog2(uint16_t x);
+
+# endif
@@ -0,0 +1,95 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+
+# include "hal.h"
+# include "uart.h"
+# include "console.h"
+
+
+// ------------------------------------------------------------ //
+// initialize the console
+
+void CONSOLEinit(Console * console) {
+    
+    console->_length   = 0;
+    console->_overflow = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// takes the received characters, returns the line once it is
+// complete ('\0' terminated, valid until the next call) and 0
+// otherwise
+//
+// empty lines and lines longer than the buffer are dropped
+
+char * CONSOLEread(Console * console) {
+    
+    char c;
+    
+    while (UARTavailable()) {
+        
+        c = UARTgetc();
+        
+        if (c == '\r' || c == '\n') {
+            
+            if (console->_overflow || console->_length == 0) {
+                
+                console->_overflow = 0;
+                console->_length   = 0;
+                continue;
+                
+            }
+            
+            console->_line[console->_length] = '\0';
+            console->_length = 0;
+            
+            return console->_line;
+            
+        }
+        
+        if (console->_length < CONSOLE_LINE_MAX - 1) {
+            
+            console->_line[console->_length++] = c;
+            
+        } else {
+            
+            console->_overflow = 1;
+            
+        }
+        
+    }
+    
+    return 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// checks if the line starts with word (in flash), returns the
+// arguments behind it or 0
+
+char * CONSOLEmatch(char * line, const char * word) {
+    
+    uint8_t length = strlen_P(word);
+    
+    if (strncmp_P(line, word, length) != 0 || (line[length] != ' ' && line[length] != '\0')) {
+        
+        return 0;
+        
+    }
+    
+    line += length;
+    
+    while (*line == ' ') {
+        
+        line++;
+        
+    }
+    
+    return line;
+    
+}
@@ -0,0 +1,46 @@
+# ifndef CONSOLE_H
+# define CONSOLE_H
+
+// ------------------------------------------------------------ //
+// line based command console on the serial port
+//
+// received characters are collected until a line ends ('\r' or
+// '\n'), the line is then handed to the main loop, which picks
+// the module by the first word:
+//
+//   alarm 1 daily 07:30
+//
+// replies are plain text and interleave with the telemetry
+// frames, the UART puts them between 0x00 delimiters (see uart.h)
+// so a decoder sees them as blocks of their own that do not
+// decode, the frames around them stay intact
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define CONSOLE_LINE_MAX     40
+
+
+// ------------------------------------------------------------ //
+// struct for storing the line being received
+
+typedef struct Console {
+    
+    char _line[CONSOLE_LINE_MAX];
+    uint8_t _length;
+    
+    // lines that did not fit into the buffer
+    uint8_t _overflow;
+    
+} Console;
+
+
+// ------------------------------------------------------------ //
+// user commands for the console
+
+void CONSOLEinit(Console * console);
+char * CONSOLEread(Console * console);
+char * CONSOLEmatch(char * line, const char * word);
+
+# endif
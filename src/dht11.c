@@ -3,48 +3,198 @@
 
 # include <stdint.h>
 
-# include <avr/io.h>
-# include <util/delay.h>
+# include "hal.h"
 
 # include "dht11.h"
+# include "profile.h"
 # include "macros.h"
 
 
 // ------------------------------------------------------------ //
 // initialization of DHT11
 
-void DHT11init(DHT11 * dht11, uint8_t io) {
+void DHT11init(DHT11 * dht11, uint8_t port, uint8_t io) {
     
     // pin
+    dht11->_io_port = port;
     dht11->_io_pin  = io;
     
     // io direction (initially output)
     dht11->_io_dir  = 1;
     
     // IO pin initially high
-    set_io_bit(PORTB, dht11->_io_pin);
+    hal_gpio_set(dht11->_io_port, dht11->_io_pin);
+    
+    // start-up of the sensor
+    dht11->_start   = HALmillis();
+    dht11->_timeout = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// returns 1 once the start-up time of the sensor has passed
+
+uint8_t DHT11ready(const DHT11 * dht11) {
+    
+    return HALmillis() - dht11->_start >= DHT11_STARTUP_MS;
     
 }
 
 
 // ------------------------------------------------------------ //
 // user command for retrieving temperature and humidity data
+//
+// returns DHT11_OK, DHT11_TIMEOUT (no answer) or DHT11_CHECKSUM
 
-void DHT11readData(DHT11 * dht11, DHT11Data * data) {
+uint8_t DHT11readData(DHT11 * dht11, DHT11Data * data) {
     
-    DHT11beginTransfer(dht11);
+    PROFILE_BEGIN(PROF_DHT11READDATA);
     
-    // wait for data transfer
-    while ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 1);
-    while ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 0);
-    while ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 1);
+    uint8_t result;
     
-    // store the data
-    data->humi_integral = DHT11read8bit(dht11);
-    data->humi_decimal  = DHT11read8bit(dht11);
-    data->temp_integral = DHT11read8bit(dht11);
-    data->temp_decimal  = DHT11read8bit(dht11);
-    data->checksum      = DHT11read8bit(dht11);
+    DHT11startSignal(dht11);
+    hal_delay_ms(DHT11_START_MS);
+    result = DHT11receive(dht11, data);
+    
+    PROFILE_END(PROF_DHT11READDATA);
+    
+    return result;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// no sensors
+
+void DHT11scanInit(DHT11scan * scan) {
+    
+    scan->count    = 0;
+    scan->_next    = 0;
+    scan->_pending = DHT11_NONE;
+    scan->_last    = HALmillis();
+    
+}
+
+
+// ------------------------------------------------------------ //
+// adds a sensor read every interval ms (at least once per
+// second), returns its index (DHT11_NONE if the scan is full)
+
+uint8_t DHT11scanAdd(DHT11scan * scan, uint8_t port, uint8_t io, uint16_t interval) {
+    
+    dht11Sensor * sensor;
+    
+    if (scan->count == DHT11_SENSORS_MAX) {
+        
+        return DHT11_NONE;
+        
+    }
+    
+    sensor = &scan->sensors[scan->count];
+    
+    DHT11init(&sensor->dht11, port, io);
+    sensor->interval        = (interval < DHT11_MIN_INTERVAL) ? DHT11_MIN_INTERVAL : interval;
+    sensor->valid           = 0;
+    sensor->reads           = 0;
+    sensor->timeouts        = 0;
+    sensor->checksum_errors = 0;
+    
+    // due as soon as it started up
+    sensor->_last = HALmillis() - sensor->interval;
+    
+    return scan->count++;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call in the main loop, starts the next due sensor (round-
+// robin) or reads the one whose start signal passed, with
+// start = 0 only a transfer that is under way is finished
+// (nothing needs a reading right now)
+//
+// returns the index of the sensor with a new valid reading,
+// otherwise DHT11_NONE
+
+uint8_t DHT11scanService(DHT11scan * scan, uint8_t start) {
+    
+    dht11Sensor * sensor;
+    DHT11Data data;
+    uint32_t now = HALmillis();
+    uint8_t index;
+    
+    // the start signal of a sensor is held, read its frame once it was long enough
+    if (scan->_pending != DHT11_NONE) {
+        
+        if (now - scan->_since < DHT11_START_MS) {
+            
+            return DHT11_NONE;
+            
+        }
+        
+        index  = scan->_pending;
+        sensor = &scan->sensors[index];
+        
+        scan->_pending = DHT11_NONE;
+        sensor->reads++;
+        
+        switch (DHT11receive(&sensor->dht11, &data)) {
+            
+            case DHT11_OK:
+                
+                sensor->data    = data;
+                sensor->valid   = 1;
+                sensor->updated = HALmillis();
+                break;
+                
+            case DHT11_TIMEOUT:
+                
+                sensor->timeouts++;
+                index = DHT11_NONE;
+                break;
+                
+            default:
+                
+                sensor->checksum_errors++;
+                index = DHT11_NONE;
+                break;
+                
+        }
+        
+        scan->_last = HALmillis();
+        
+        return index;
+        
+    }
+    
+    // keep the transfers of different sensors apart
+    if (!start || now - scan->_last < DHT11_SCAN_GAP_MS) {
+        
+        return DHT11_NONE;
+        
+    }
+    
+    // first due sensor after the one started last
+    for (uint8_t i = 0; i < scan->count; i++) {
+        
+        index  = (scan->_next + i) % scan->count;
+        sensor = &scan->sensors[index];
+        
+        if (DHT11ready(&sensor->dht11) && now - sensor->_last >= sensor->interval) {
+            
+            DHT11startSignal(&sensor->dht11);
+            sensor->_last  = now;
+            scan->_pending = index;
+            scan->_since   = now;
+            scan->_next    = index + 1;
+            break;
+            
+        }
+        
+    }
+    
+    return DHT11_NONE;
     
 }
 
@@ -64,20 +214,28 @@ uint8_t DHT11read8bit(DHT11 * dht11) {
     for (int i = 0; i < 8; i++) {
         
         // wait for the next bit
-        while ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 0);
+        if (!DHT11wait(dht11, 0)) {
+            
+            return 0;
+            
+        }
         
         // wait out a potential 0
-        _delay_us(30);
+        hal_delay_us(30);
         
         // if the io pin is still high, the data's current bit is 1
-        if ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 1) {
+        if (hal_gpio_read(dht11->_io_port, dht11->_io_pin) == 1) {
             
             buffer |= (1 << (7 - i));
             
         }
         
         // wait out the remaining high if needed
-        while ((get_io_bit(PINB, dht11->_io_pin) >> dht11->_io_pin) == 1);
+        if (!DHT11wait(dht11, 1)) {
+            
+            return 0;
+            
+        }
         
     }
     
@@ -87,24 +245,91 @@ uint8_t DHT11read8bit(DHT11 * dht11) {
 
 
 // -------------------------------------------------- //
-// sends the start signal through io pin (datasheet page 6)
+// waits while the io pin is at level, returns 0 (and sets
+// the timeout flag) if it does not change in time, or right
+// away after an earlier timeout of the transfer
+
+uint8_t DHT11wait(DHT11 * dht11, uint8_t level) {
+    
+    uint16_t loops = DHT11_TIMEOUT_LOOPS;
+    
+    if (dht11->_timeout) {
+        
+        return 0;
+        
+    }
+    
+    while (hal_gpio_read(dht11->_io_port, dht11->_io_pin) == level) {
+        
+        if (--loops == 0) {
+            
+            dht11->_timeout = 1;
+            return 0;
+            
+        }
+        
+    }
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// begins the start signal through io pin (datasheet page 6),
+// the pin has to stay low for DHT11_START_MS before
+// DHT11receive
 
-void DHT11beginTransfer(DHT11 * dht11) {
+void DHT11startSignal(DHT11 * dht11) {
     
     // change io pin to output
     DHT11setIOdir(dht11, 1);
     
     // pull the io pin low to begin start signal
-    clear_io_bit(PORTB, dht11->_io_pin);
-    _delay_ms(20);
+    hal_gpio_clear(dht11->_io_port, dht11->_io_pin);
+    
+}
+
+
+// -------------------------------------------------- //
+// ends the start signal and reads the response and the
+// frame (the timing-critical part)
+
+uint8_t DHT11receive(DHT11 * dht11, DHT11Data * data) {
+    
+    uint8_t sum;
     
     // pull the io pin high to wait for the response
-    set_io_bit(PORTB, dht11->_io_pin);
-    _delay_us(40);
+    hal_gpio_set(dht11->_io_port, dht11->_io_pin);
+    hal_delay_us(40);
     
     // change io pin to input
     DHT11setIOdir(dht11, 0);
     
+    // wait for data transfer (a timeout skips the rest)
+    dht11->_timeout = 0;
+    DHT11wait(dht11, 1);
+    DHT11wait(dht11, 0);
+    DHT11wait(dht11, 1);
+    
+    // store the data
+    data->humi_integral = DHT11read8bit(dht11);
+    data->humi_decimal  = DHT11read8bit(dht11);
+    data->temp_integral = DHT11read8bit(dht11);
+    data->temp_decimal  = DHT11read8bit(dht11);
+    data->checksum      = DHT11read8bit(dht11);
+    
+    sum = data->humi_integral + data->humi_decimal + data->temp_integral + data->temp_decimal;
+    data->isvalid = !dht11->_timeout && sum == data->checksum;
+    
+    if (dht11->_timeout) {
+        
+        return DHT11_TIMEOUT;
+        
+    }
+    
+    return data->isvalid ? DHT11_OK : DHT11_CHECKSUM;
+    
 }
 
 
@@ -117,6 +342,6 @@ void DHT11beginTransfer(DHT11 * dht11) {
 void DHT11setIOdir(DHT11 * dht11, uint8_t dir) {
     
     dht11->_io_dir = dir;
-    change_io_bit(DDRB, dht11->_io_pin, dht11->_io_dir);
+    hal_gpio_dir(dht11->_io_port, dht11->_io_pin, dht11->_io_dir);
     
-}
\ No newline at end of file
+}
@@ -16,37 +16,133 @@ typedef struct DHT11Data {
 } DHT11Data;
 
 
+// ------------------------------------------------------------ //
+// the sensor does not answer reliably in the first second after
+// power on (datasheet section 5.2), counted from DHT11init, and
+// should not be read more often than once per second
+
+# define DHT11_STARTUP_MS    1000
+# define DHT11_MIN_INTERVAL  1000
+
+// start signal (low for at least 18 ms)
+# define DHT11_START_MS      20
+
+// polls of the io pin before a level counts as stuck (>= 250 us
+// even at one poll per 125 ns, the longest level of a frame is
+// 80 us), so a missing sensor does not hang the firmware
+# define DHT11_TIMEOUT_LOOPS 2000
+
+// results of a reading
+# define DHT11_OK            0
+# define DHT11_TIMEOUT       1
+# define DHT11_CHECKSUM      2
+
+
+// ------------------------------------------------------------ //
+// several sensors read round-robin (DHT11scan)
+//
+// only one sensor is in a transfer at a time: its start signal
+// is held while the main loop goes on, then the frame is read
+// (about 4 ms with interrupts), and the next sensor is only
+// started DHT11_SCAN_GAP_MS later
+
+# ifndef DHT11_SENSORS_MAX
+# define DHT11_SENSORS_MAX   2
+# endif
+
+# define DHT11_SCAN_GAP_MS   50
+
+// no sensor
+# define DHT11_NONE          0xFF
+
+
 // ------------------------------------------------------------ //
 // struct for storing information about the pins and settings
 
 typedef struct DHT11 {
     
-    // io pin
+    // io port and pin
+    uint8_t _io_port;
     uint8_t _io_pin;
     
     // current direction of io pin
     uint8_t _io_dir;
     
+    // time of DHT11init (HALmillis)
+    uint32_t _start;
+    
+    // set when a level did not change in time
+    uint8_t _timeout;
+    
 } DHT11;
 
 
+// ------------------------------------------------------------ //
+// struct for storing a sensor of a scan, its interval (ms), the
+// last valid reading and the outcome of the transfers
+
+typedef struct dht11Sensor {
+    
+    DHT11 dht11;
+    uint16_t interval;
+    uint32_t _last;
+    
+    // last valid reading and its time (HALmillis), valid = 0
+    // until there is one
+    DHT11Data data;
+    uint8_t valid;
+    uint32_t updated;
+    
+    // transfers, and those without an answer or with a wrong checksum
+    uint16_t reads;
+    uint16_t timeouts;
+    uint16_t checksum_errors;
+    
+} dht11Sensor;
+
+typedef struct DHT11scan {
+    
+    dht11Sensor sensors[DHT11_SENSORS_MAX];
+    uint8_t count;
+    
+    // next sensor to check, sensor whose start signal is held and
+    // since when, end of the last transfer
+    uint8_t _next;
+    uint8_t _pending;
+    uint32_t _since;
+    uint32_t _last;
+    
+} DHT11scan;
+
+
 // ------------------------------------------------------------ //
 // configuration of DHT11
 
-void DHT11init(DHT11 * dht11, uint8_t io);
+void DHT11init(DHT11 * dht11, uint8_t port, uint8_t io);
+uint8_t DHT11ready(const DHT11 * dht11);
 
 
 // ------------------------------------------------------------ //
 // user command for retrieving temperature and humidity data
 
-void DHT11readData(DHT11 * dht11, DHT11Data * data);
+uint8_t DHT11readData(DHT11 * dht11, DHT11Data * data);
+
+
+// ------------------------------------------------------------ //
+// user commands for several sensors
+
+void DHT11scanInit(DHT11scan * scan);
+uint8_t DHT11scanAdd(DHT11scan * scan, uint8_t port, uint8_t io, uint16_t interval);
+uint8_t DHT11scanService(DHT11scan * scan, uint8_t start);
 
 
 // ------------------------------------------------------------ //
 // functions for communicating with DHT11
 
+void DHT11startSignal(DHT11 * dht11);
+uint8_t DHT11receive(DHT11 * dht11, DHT11Data * data);
 uint8_t DHT11read8bit(DHT11 * dht11);
-void DHT11beginTransfer(DHT11 * dht11);
+uint8_t DHT11wait(DHT11 * dht11, uint8_t level);
 void DHT11setIOdir(DHT11 * dht11, uint8_t dir);
 
 # endif
\ No newline at end of file
@@ -0,0 +1,276 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "ds1302.h"
+# include "settings.h"
+# include "telemetry.h"
+# include "alarm.h"
+# include "timesync.h"
+# include "uart.h"
+# include "drift.h"
+
+
+// ------------------------------------------------------------ //
+// loads the correction (none if the slot is not valid)
+
+void DRIFTload(Drift * drift) {
+    
+    uint8_t buffer[DRIFT_SLOT_SIZE];
+    
+    for (uint8_t i = 0; i < DRIFT_SLOT_SIZE; i++) {
+        
+        buffer[i] = hal_eeprom_read(DRIFT_EEPROM_BASE + i);
+        
+    }
+    
+    // same crc as the telemetry frames, the settings and the alarms
+    if (TELcrc8(buffer, DRIFT_SLOT_SIZE - 1) == buffer[DRIFT_SLOT_SIZE - 1]) {
+        
+        memcpy(&drift->record, buffer, sizeof(driftRecord));
+        
+    } else {
+        
+        memset(&drift->record, 0, sizeof(driftRecord));
+        
+    }
+    
+    drift->_error     = 0;
+    drift->_last      = 0;
+    drift->_dirty     = 0;
+    drift->_write_pos = 0xFF;
+    drift->measured   = 0;
+    drift->nudges     = 0;
+    drift->nudged     = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call after a synchronization set the RTC (utc = second written)
+// with the offset it applied and the seconds since the previous
+// one (0 = none)
+
+void DRIFTmeasure(Drift * drift, const syncOffset * offset, uint32_t elapsed, uint32_t utc) {
+    
+    int32_t ms;
+    int32_t residual;
+    int32_t ppb;
+    
+    // error that was expected but not nudged away yet
+    ms = drift->_error / 1000000L;
+    
+    // the RTC is exact now
+    drift->_error = 0;
+    drift->_last  = utc;
+    
+    if (elapsed < DRIFT_MIN_ELAPSED_S || offset->seconds < -DRIFT_MAX_OFFSET_S || offset->seconds >= DRIFT_MAX_OFFSET_S) {
+        
+        return;
+        
+    }
+    
+    // ppb = -ms / elapsed * 10^6, in two steps so it fits 32 bits
+    ms      += offset->seconds * 1000L + offset->ms;
+    residual = -(ms * 10000L / (int32_t) elapsed) * 100;
+    
+    // drift of the RTC itself (the correction was applied in between)
+    drift->last = drift->record.ppb + residual;
+    
+    if (drift->measured == 0 || drift->last < drift->min) {
+        
+        drift->min = drift->last;
+        
+    }
+    
+    if (drift->measured == 0 || drift->last > drift->max) {
+        
+        drift->max = drift->last;
+        
+    }
+    
+    drift->measured++;
+    
+    ppb = (drift->record.measurements == 0) ? drift->last : drift->record.ppb + residual / 2;
+    
+    if (ppb > DRIFT_MAX_PPB) {
+        
+        ppb = DRIFT_MAX_PPB;
+        
+    } else if (ppb < -DRIFT_MAX_PPB) {
+        
+        ppb = -DRIFT_MAX_PPB;
+        
+    }
+    
+    DRIFTset(drift, ppb, (drift->record.measurements < 0xFFFF) ? drift->record.measurements + 1 : 0xFFFF);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call regularly from the main loop, writes a changed record one
+// byte per call
+
+void DRIFTservice(Drift * drift) {
+    
+    if (drift->_write_pos == 0xFF) {
+        
+        if (!drift->_dirty) {
+            
+            return;
+            
+        }
+        
+        drift->_dirty = 0;
+        memcpy(drift->_buffer, &drift->record, sizeof(driftRecord));
+        drift->_buffer[DRIFT_SLOT_SIZE - 1] = TELcrc8(drift->_buffer, DRIFT_SLOT_SIZE - 1);
+        drift->_write_pos = 0;
+        
+    }
+    
+    // previous byte (or a settings or alarm byte) still being written
+    if (!hal_eeprom_ready()) {
+        
+        return;
+        
+    }
+    
+    hal_eeprom_update(DRIFT_EEPROM_BASE + drift->_write_pos, drift->_buffer[drift->_write_pos]);
+    
+    if (++drift->_write_pos == DRIFT_SLOT_SIZE) {
+        
+        drift->_write_pos = 0xFF;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call when the RTC second changed, sums up the expected error
+//
+// returns the ms the RTC should be moved (negative = back) once
+// the error reached DRIFT_STEP_MS, otherwise 0
+
+int16_t DRIFTtick(Drift * drift, uint32_t utc) {
+    
+    if (drift->_last != 0 && utc > drift->_last && utc - drift->_last <= DRIFT_MAX_GAP_S) {
+        
+        drift->_error += (int32_t) (utc - drift->_last) * drift->record.ppb;
+        
+    }
+    
+    drift->_last = utc;
+    
+    if (drift->_error >= DRIFT_STEP_MS * 1000000L) {
+        
+        return -DRIFT_STEP_MS;
+        
+    }
+    
+    if (drift->_error <= -DRIFT_STEP_MS * 1000000L) {
+        
+        return DRIFT_STEP_MS;
+        
+    }
+    
+    return 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call once a nudge of DRIFTtick was scheduled
+
+void DRIFTnudged(Drift * drift, int16_t ms) {
+    
+    drift->_error += ms * 1000000L;
+    drift->nudges++;
+    drift->nudged += ms;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command, prints the correction and the statistics or
+// clears them ("drift reset")
+
+void DRIFTcommand(Drift * drift, const char * args) {
+    
+    char line[64];
+    
+    if (strcmp_P(args, PSTR("reset")) == 0) {
+        
+        DRIFTset(drift, 0, 0);
+        drift->_error   = 0;
+        drift->measured = 0;
+        drift->nudges   = 0;
+        drift->nudged   = 0;
+        
+    } else if (*args != '\0') {
+        
+        UARTprint_P(PSTR("error: drift [reset]\r\n"));
+        return;
+        
+    }
+    
+    UARTprint_P(PSTR("drift correction "));
+    DRIFTprintPpm(drift->record.ppb);
+    snprintf_P(line, sizeof(line), PSTR(" ppm measurements %u\r\n"), drift->record.measurements);
+    UARTprint(line);
+    
+    UARTprint_P(PSTR("measured"));
+    
+    if (drift->measured != 0) {
+        
+        UARTprint_P(PSTR(" last "));
+        DRIFTprintPpm(drift->last);
+        UARTprint_P(PSTR(" min "));
+        DRIFTprintPpm(drift->min);
+        UARTprint_P(PSTR(" max "));
+        DRIFTprintPpm(drift->max);
+        UARTprint_P(PSTR(" ppm\r\n"));
+        
+    } else {
+        
+        UARTprint_P(PSTR(" -\r\n"));
+        
+    }
+    
+    snprintf_P(line, sizeof(line), PSTR("nudges %u sum %ld ms error %ld ms\r\n"),
+               drift->nudges, (long) drift->nudged, (long) (drift->_error / 1000000L));
+    UARTprint(line);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// changes the correction and queues it for writing
+
+void DRIFTset(Drift * drift, int32_t ppb, uint16_t measurements) {
+    
+    drift->record.ppb          = ppb;
+    drift->record.measurements = measurements;
+    drift->_dirty              = 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// prints ppb as ppm with two decimals
+
+void DRIFTprintPpm(int32_t ppb) {
+    
+    char text[16];
+    uint32_t value = (ppb < 0) ? -ppb : ppb;
+    
+    snprintf_P(text, sizeof(text), PSTR("%s%lu.%02u"), (ppb < 0) ? "-" : "",
+               (unsigned long) (value / 1000), (unsigned) (value % 1000 / 10));
+    UARTprint(text);
+    
+}
@@ -0,0 +1,117 @@
+# ifndef DRIFT_H
+# define DRIFT_H
+
+// ------------------------------------------------------------ //
+// drift of the RTC and its compensation
+//
+// the DS1302 has no trim, its crystal runs a few ppm fast or slow
+// (1 ppm = 0.6 s per week), so the drift is measured between two
+// synchronizations (see timesync.h): the offset the second one
+// applies is the error that was left over the time in between,
+// apart from the part of the correction not nudged away yet
+//
+//   residual = -(offset + pending) / elapsed   (positive = RTC fast)
+//
+// the residual is added to the correction (the first one fully,
+// later ones by half, so a single noisy exchange does not swing
+// it), which is kept in EEPROM behind the alarms
+//
+// the correction is applied by nudging the RTC: the expected
+// error is summed up every second, once it reaches DRIFT_STEP_MS
+// the RTC is set back or forward by that much at its next second
+// (the write restarts its second divider, see SYNCadjust)
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define DRIFT_EEPROM_BASE        (ALARMS_EEPROM_BASE + ALARMS_MAX * ALARM_SLOT_SIZE)
+
+// size of a nudge (ms)
+# define DRIFT_STEP_MS            100
+
+// a measurement needs this long between the synchronizations (s),
+// offsets beyond DRIFT_MAX_OFFSET_S are a set, not a drift
+# define DRIFT_MIN_ELAPSED_S      600
+# define DRIFT_MAX_OFFSET_S       60
+
+// corrections are limited to +-DRIFT_MAX_PPB
+# define DRIFT_MAX_PPB            500000L
+
+// gaps in the seconds beyond this (s) are a set of the time and
+// are not counted
+# define DRIFT_MAX_GAP_S          60
+
+
+// ------------------------------------------------------------ //
+// the stored record (correction and number of measurements)
+
+typedef struct driftRecord {
+    
+    int32_t ppb;
+    uint16_t measurements;
+    
+} driftRecord;
+
+// record and crc
+# define DRIFT_SLOT_SIZE          (sizeof(driftRecord) + 1)
+
+
+// ------------------------------------------------------------ //
+// struct for storing the correction and the statistics
+
+typedef struct Drift {
+    
+    // correction (ppb, positive = RTC fast) and measurements so far
+    driftRecord record;
+    
+    // error of the RTC since the last nudge (ns) and the second it
+    // was summed up to
+    int32_t _error;
+    uint32_t _last;
+    
+    // changed record and the write in progress (0xFF = none)
+    uint8_t _dirty;
+    uint8_t _write_pos;
+    uint8_t _buffer[DRIFT_SLOT_SIZE];
+    
+    // statistics since power on: measurements, drift (ppb) measured
+    // by the last one and the range, nudges and their sum (ms)
+    uint16_t measured;
+    int32_t last;
+    int32_t min;
+    int32_t max;
+    uint16_t nudges;
+    int32_t nudged;
+    
+} Drift;
+
+
+// ------------------------------------------------------------ //
+// loading, measuring and committing
+
+void DRIFTload(Drift * drift);
+void DRIFTmeasure(Drift * drift, const syncOffset * offset, uint32_t elapsed, uint32_t utc);
+void DRIFTservice(Drift * drift);
+
+
+// ------------------------------------------------------------ //
+// compensation (utc = RTC seconds since 2000)
+
+int16_t DRIFTtick(Drift * drift, uint32_t utc);
+void DRIFTnudged(Drift * drift, int16_t ms);
+
+
+// ------------------------------------------------------------ //
+// console command ("drift", "drift reset")
+
+void DRIFTcommand(Drift * drift, const char * args);
+
+
+// ------------------------------------------------------------ //
+// helper functions
+
+void DRIFTset(Drift * drift, int32_t ppb, uint16_t measurements);
+void DRIFTprintPpm(int32_t ppb);
+
+# endif
@@ -6,10 +6,10 @@
 # include <stdint.h>
 # include <string.h>
 
-# include <avr/io.h>
-# include <util/delay.h>
+# include "hal.h"
 
 # include "ds1302.h"
+# include "profile.h"
 # include "macros.h"
 
 
@@ -36,16 +36,16 @@ int DS1302dayOfWeekFromDate(int d, int m, int y) {
 
 void DS1302timeDataInit(timeData * data, const char * date, const char * time, uint8_t offset) {
     
-    static const char * monthStrings[] = {
+    static const char monthStrings[12][4] PROGMEM = {
         "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep",
-        "Oct", "Nov", "Dec", NULL
+        "Oct", "Nov", "Dec"
     };
     int hour, minute, second, day, year;
     char monthtext[4];
     
     // parse the strings and extract data
-    sscanf(time, "%d:%d:%d", &hour, &minute, &second);
-    sscanf(date, "%s %d %d", monthtext, &day, &year);
+    sscanf_P(time, PSTR("%d:%d:%d"), &hour, &minute, &second);
+    sscanf_P(date, PSTR("%3s %d %d"), monthtext, &day, &year);
     
     // fill in the data
     data->second = second + offset;
@@ -55,8 +55,8 @@ void DS1302timeDataInit(timeData * data, const char * date, const char * time, u
     data->year   = year-(year/100 * 100);
     
     // translate month names into numbers 1-12
-    for (int i = 0; monthStrings[i] != NULL; i++) {
-        if (strcmp(monthStrings[i], monthtext) == 0) {
+    for (int i = 0; i < 12; i++) {
+        if (strcmp_P(monthtext, monthStrings[i]) == 0) {
             data->month = i+1;
         }
     }
@@ -67,6 +67,152 @@ void DS1302timeDataInit(timeData * data, const char * date, const char * time, u
 }
 
 
+// ------------------------------------------------------------ //
+// same with the strings in flash, e.g. PSTR(__DATE__), so they
+// do not occupy SRAM for the whole runtime
+
+void DS1302timeDataInit_P(timeData * data, const char * date, const char * time, uint8_t offset) {
+    
+    char datetext[12];
+    char timetext[9];
+    
+    strncpy_P(datetext, date, sizeof(datetext) - 1);
+    strncpy_P(timetext, time, sizeof(timetext) - 1);
+    datetext[sizeof(datetext) - 1] = '\0';
+    timetext[sizeof(timetext) - 1] = '\0';
+    
+    DS1302timeDataInit(data, datetext, timetext, offset);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// converts time data as read from the DS1302 (bcd) into
+// decimal
+
+void DS1302timeDataFromBCD(timeData * data) {
+    
+    data->second    = bcd_to_dec(data->second);
+    data->minute    = bcd_to_dec(data->minute);
+    data->hour      = bcd_to_dec(data->hour);
+    data->day       = bcd_to_dec(data->day);
+    data->month     = bcd_to_dec(data->month);
+    data->dayofweek = bcd_to_dec(data->dayofweek);
+    data->year      = bcd_to_dec(data->year);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// takes time data (decimal) and returns the seconds elapsed
+// since 2000-01-01 00:00:00
+//
+// valid for the years 2000-2099, which is all the DS1302 can hold
+
+uint32_t DS1302timeDataToSeconds(timeData * data) {
+    
+    // days before the first of each month in a non-leap year
+    static const uint16_t daysBeforeMonth[] PROGMEM = {
+        0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+    };
+    uint16_t days;
+    
+    // whole years (2000 is a leap year, so every 4th year starting with 0)
+    days = 365 * data->year + (data->year + 3) / 4;
+    
+    // whole months and days of the current year
+    days += pgm_read_word(&daysBeforeMonth[data->month - 1]) + data->day - 1;
+    
+    if ((data->year % 4) == 0 && data->month > 2) {
+        
+        days++;
+        
+    }
+    
+    return ((uint32_t) days * 24 + data->hour) * 3600UL + data->minute * 60U + data->second;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// number of days in the month (1 - 12) of the year (0 - 99)
+
+uint8_t DS1302daysInMonth(uint8_t month, uint8_t year) {
+    
+    switch (month) {
+        
+        case FEB:
+            return (year % 4) ? 28 : 29;
+            
+        case APR:
+        case JUN:
+        case SEP:
+        case NOV:
+            return 30;
+            
+        default:
+            return 31;
+            
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// takes the seconds elapsed since 2000-01-01 00:00:00 and fills
+// in the time data (decimal, including the day of the week)
+
+void DS1302timeDataFromSeconds(timeData * data, uint32_t seconds) {
+    
+    uint16_t days = seconds / 86400UL;
+    uint32_t rest = seconds - days * 86400UL;
+    uint16_t length;
+    uint8_t month;
+    
+    data->hour   = rest / 3600;
+    rest        -= data->hour * 3600U;
+    data->minute = rest / 60;
+    data->second = rest - data->minute * 60U;
+    
+    // 2000-01-01 was a saturday (0 = sunday)
+    data->dayofweek = (days + 6) % 7;
+    
+    // whole years
+    for (data->year = 0; ; data->year++) {
+        
+        length = (data->year % 4) ? 365 : 366;
+        
+        if (days < length) {
+            
+            break;
+            
+        }
+        
+        days -= length;
+        
+    }
+    
+    // whole months
+    for (month = 1; month < 12; month++) {
+        
+        length = DS1302daysInMonth(month, data->year);
+        
+        if (days < length) {
+            
+            break;
+            
+        }
+        
+        days -= length;
+        
+    }
+    
+    data->month = month;
+    data->day   = days + 1;
+    
+}
+
+
 // -------------------------------------------------- //
 // initialize the DS1302
 // 
@@ -85,8 +231,8 @@ void DS1302init(DS1302 * ds1302, uint8_t ce, uint8_t io, uint8_t clk) {
     ds1302->_io_dir  = 1;
     
     // chip enable off and no clock signal (kept low)
-    clear_io_bit(PORTB, ds1302->_ce_pin);
-    clear_io_bit(PORTB, ds1302->_clk_pin);
+    hal_gpio_clear(HAL_PORTB, ds1302->_ce_pin);
+    hal_gpio_clear(HAL_PORTB, ds1302->_clk_pin);
     
 }
 
@@ -216,6 +362,8 @@ void DS1302setClockMode(DS1302 * ds1302, uint8_t mode) {
 
 void DS1302readTimeData(DS1302 * ds1302, timeData * data) {
     
+    PROFILE_BEGIN(PROF_DS1302READTIMEDATA);
+    
     // begin communication in burst mode
     DS1302beginCommunication(ds1302, REGISTER_CLOCKBURST, 0);
     
@@ -231,6 +379,8 @@ void DS1302readTimeData(DS1302 * ds1302, timeData * data) {
     // end communication
     DS1302setCEpin(ds1302, 0);
     
+    PROFILE_END(PROF_DS1302READTIMEDATA);
+    
 }
 
 
@@ -298,7 +448,7 @@ uint8_t DS1302read(DS1302 * ds1302) {
     
     for (int i = 0; i < 8; i++) {
         
-        if ((get_io_bit(PIND, ds1302->_io_pin) >> ds1302->_io_pin) == 1) {
+        if (hal_gpio_read(HAL_PORTD, ds1302->_io_pin) == 1) {
             
             buffer |= (1 << i);
             
@@ -320,7 +470,7 @@ void DS1302write(DS1302 * ds1302, uint8_t message) {
     
     for (int i = 0; i < 8; i++) {
         
-        change_io_bit(PORTD, ds1302->_io_pin, ((message >> i) & 1));
+        hal_gpio_write(HAL_PORTD, ds1302->_io_pin, ((message >> i) & 1));
         DS1302clockPulse(ds1302);
         
     }
@@ -392,7 +542,7 @@ void DS1302setclearFlag(DS1302 * ds1302, uint8_t flag_register, uint8_t flag, ui
 void DS1302setIOdir(DS1302 * ds1302, uint8_t dir) {
     
     ds1302->_io_dir = dir;
-    change_io_bit(DDRD, ds1302->_io_pin, ds1302->_io_dir);
+    hal_gpio_dir(HAL_PORTD, ds1302->_io_pin, ds1302->_io_dir);
     
 }
 
@@ -402,7 +552,7 @@ void DS1302setIOdir(DS1302 * ds1302, uint8_t dir) {
 
 void DS1302setCEpin(DS1302 * ds1302, uint8_t value) {
     
-    change_io_bit(PORTB, ds1302->_ce_pin, value);
+    hal_gpio_write(HAL_PORTB, ds1302->_ce_pin, value);
     
 }
 
@@ -415,10 +565,10 @@ void DS1302setCEpin(DS1302 * ds1302, uint8_t value) {
 
 void DS1302clockPulse(DS1302 * ds1302) {
     
-    set_io_bit(PORTB, ds1302->_clk_pin);
-    _delay_us(1);
+    hal_gpio_set(HAL_PORTB, ds1302->_clk_pin);
+    hal_delay_us(1);
     
-    clear_io_bit(PORTB, ds1302->_clk_pin);
-    _delay_us(1);
+    hal_gpio_clear(HAL_PORTB, ds1302->_clk_pin);
+    hal_delay_us(1);
     
 }
\ No newline at end of file
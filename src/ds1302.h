@@ -105,6 +105,11 @@ typedef struct DS1302 {
 
 int DS1302dayOfWeekFromDate(int d, int m, int y);
 void DS1302timeDataInit(timeData * data, const char * date, const char * time, uint8_t offset);
+void DS1302timeDataInit_P(timeData * data, const char * date, const char * time, uint8_t offset);
+void DS1302timeDataFromBCD(timeData * data);
+uint32_t DS1302timeDataToSeconds(timeData * data);
+uint8_t DS1302daysInMonth(uint8_t month, uint8_t year);
+void DS1302timeDataFromSeconds(timeData * data, uint32_t seconds);
 
 // ------------------------------------------------------------ //
 // initialization of DS1302
@@ -0,0 +1,88 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include <util/atomic.h>
+
+# include "hal.h"
+
+
+// -------------------------------------------------- //
+// milliseconds since HALtimerInit
+
+static volatile uint32_t hal_millis = 0;
+
+
+// -------------------------------------------------- //
+// start timer0 in CTC mode with a 1 kHz interrupt
+//
+// F_CPU / 64 / 250 = 1000 Hz
+
+void HALtimerInit(void) {
+    
+    TCCR0A = (1 << WGM01);
+    TCCR0B = (1 << CS01) | (1 << CS00);
+    OCR0A  = 249;
+    TIMSK0 = (1 << OCIE0A);
+    
+}
+
+
+// -------------------------------------------------- //
+// returns the milliseconds since HALtimerInit
+
+uint32_t HALmillis(void) {
+    
+    uint32_t millis;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        
+        millis = hal_millis;
+        
+    }
+    
+    return millis;
+    
+}
+
+
+// -------------------------------------------------- //
+// returns the microseconds since HALtimerInit (4 us steps)
+//
+// the interrupt counts a millisecond when timer0 matches 249,
+// so the fraction of the millisecond starts after the match, a
+// match that happened inside the atomic block is still pending
+// (unless the counter was read just before it, at 248)
+
+uint32_t HALmicros(void) {
+    
+    uint32_t millis;
+    uint8_t ticks;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        
+        millis = hal_millis;
+        ticks  = TCNT0;
+        
+        if ((TIFR0 & (1 << OCF0A)) && ticks != 248) {
+            
+            millis++;
+            
+        }
+        
+    }
+    
+    return millis * 1000 + ((ticks == 249) ? 0 : ticks + 1) * 4;
+    
+}
+
+
+// -------------------------------------------------- //
+// interrupt service routine for timer0 compare match A
+
+ISR(TIMER0_COMPA_vect) {
+    
+    hal_millis++;
+    
+}
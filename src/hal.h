@@ -0,0 +1,103 @@
+# ifndef HAL_H
+# define HAL_H
+
+// ------------------------------------------------------------ //
+// hardware abstraction layer
+//
+// the drivers only access pins, delays and timers through this
+// header, on the target everything expands to plain register
+// accesses (sbi/cbi for constant ports and pins), when built
+// with HOST defined the calls go to the simulated peripherals
+// in host/
+//
+// constant tables and strings are kept in flash (PROGMEM) and
+// read with the avr-libc _P functions and pgm_read_*, the host
+// build maps those onto plain memory accesses
+
+# include <stdint.h>
+
+# include "macros.h"
+
+
+// ------------------------------------------------------------ //
+// ports
+
+# define HAL_PORTB 0
+# define HAL_PORTC 1
+# define HAL_PORTD 2
+
+
+# ifndef HOST
+
+# include <avr/io.h>
+# include <avr/interrupt.h>
+# include <avr/eeprom.h>
+# include <avr/pgmspace.h>
+# include <util/delay.h>
+
+// ------------------------------------------------------------ //
+// registers of a port (PINx, DDRx and PORTx are consecutive)
+
+# define hal_pin_reg(port)      _SFR_MEM8(0x23 + 3 * (port))
+# define hal_ddr_reg(port)      _SFR_MEM8(0x24 + 3 * (port))
+# define hal_port_reg(port)     _SFR_MEM8(0x25 + 3 * (port))
+
+
+// ------------------------------------------------------------ //
+// gpio
+//
+// dir: 1 = output, 0 = input
+
+# define hal_gpio_set(port, bit)            set_io_bit(hal_port_reg(port), bit)
+# define hal_gpio_clear(port, bit)          clear_io_bit(hal_port_reg(port), bit)
+# define hal_gpio_write(port, bit, value)   ((value) ? hal_gpio_set(port, bit) : hal_gpio_clear(port, bit))
+# define hal_gpio_read(port, bit)           ((hal_pin_reg(port) >> (bit)) & 1)
+# define hal_gpio_dir(port, bit, dir)       ((dir) ? set_io_bit(hal_ddr_reg(port), bit) : clear_io_bit(hal_ddr_reg(port), bit))
+# define hal_port_init(port, ddr, value)    do { hal_ddr_reg(port) = (ddr); hal_port_reg(port) = (value); } while (0)
+
+
+// ------------------------------------------------------------ //
+// busy-wait delays (arguments must be compile time constants)
+
+# define hal_delay_us(us)   _delay_us(us)
+# define hal_delay_ms(ms)   _delay_ms(ms)
+
+
+// ------------------------------------------------------------ //
+// EEPROM (update only writes if the value differs, check ready
+// first to avoid waiting for the previous write)
+
+# define hal_eeprom_read(address)           eeprom_read_byte((const uint8_t *) (address))
+# define hal_eeprom_update(address, value)  eeprom_update_byte((uint8_t *) (address), value)
+# define hal_eeprom_ready()                 eeprom_is_ready()
+
+# else
+
+# include "host/hal_host.h"
+
+# define hal_gpio_set(port, bit)            HALhostWrite(port, bit, 1)
+# define hal_gpio_clear(port, bit)          HALhostWrite(port, bit, 0)
+# define hal_gpio_write(port, bit, value)   HALhostWrite(port, bit, value)
+# define hal_gpio_read(port, bit)           HALhostRead(port, bit)
+# define hal_gpio_dir(port, bit, dir)       HALhostDir(port, bit, dir)
+# define hal_port_init(port, ddr, value)    HALhostPortInit(port, ddr, value)
+
+# define hal_delay_us(us)   HALhostDelayNs((uint64_t) ((us) * 1000))
+# define hal_delay_ms(ms)   HALhostDelayNs((uint64_t) ((ms) * 1000000))
+
+# define hal_eeprom_read(address)           HALhostEepromRead(address)
+# define hal_eeprom_update(address, value)  HALhostEepromUpdate(address, value)
+# define hal_eeprom_ready()                 HALhostEepromReady()
+
+# endif
+
+
+// ------------------------------------------------------------ //
+// millisecond timer (timer0 on the target), the microseconds are
+// read from the same timer (4 us resolution, wraps after 71 min)
+
+void HALtimerInit(void);
+uint32_t HALmillis(void);
+uint32_t HALmicros(void);
+
+# endif
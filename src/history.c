@@ -0,0 +1,302 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+
+# include "hal.h"
+# include "history.h"
+
+
+// ------------------------------------------------------------ //
+// unpacks the values (0.1 C and 0.1 %) of a sample, returns the
+// distance to the previous sample in intervals
+
+static uint8_t HISTORYunpack(const uint8_t * sample, int16_t * values) {
+    
+    uint16_t word = sample[1] | (sample[2] << 8);
+    
+    values[HISTORY_TEMPERATURE] = (int16_t) (word & 0x07FF) - HISTORY_TEMP_OFFSET;
+    values[HISTORY_HUMIDITY]    = sample[0] * 5;
+    
+    return word >> 11;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// looks through all samples for the minimum and maximum of a
+// value (only needed when one of them left the window)
+
+static void HISTORYrescan(History * history, uint8_t value) {
+    
+    historyStats * stats = &history->_stats[value];
+    int16_t values[HISTORY_VALUES];
+    uint16_t index = history->_first;
+    
+    history->rescans++;
+    stats->min = INT16_MAX;
+    stats->max = INT16_MIN;
+    
+    for (uint16_t i = 0; i < history->_count; i++) {
+        
+        HISTORYunpack(history->_samples[index], values);
+        
+        if (values[value] < stats->min) {
+            
+            stats->min = values[value];
+            
+        }
+        
+        if (values[value] > stats->max) {
+            
+            stats->max = values[value];
+            
+        }
+        
+        if (++index == HISTORY_SAMPLES) {
+            
+            index = 0;
+            
+        }
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// removes the oldest sample
+
+static void HISTORYevict(History * history) {
+    
+    int16_t values[HISTORY_VALUES];
+    int16_t next[HISTORY_VALUES];
+    historyStats * stats;
+    
+    HISTORYunpack(history->_samples[history->_first], values);
+    
+    if (++history->_first == HISTORY_SAMPLES) {
+        
+        history->_first = 0;
+        
+    }
+    
+    history->_count--;
+    
+    // the new oldest sample tells how far it was from the removed one
+    if (history->_count) {
+        
+        history->_oldest += (uint32_t) HISTORYunpack(history->_samples[history->_first], next) * HISTORY_INTERVAL;
+        
+    }
+    
+    for (uint8_t value = 0; value < HISTORY_VALUES; value++) {
+        
+        stats = &history->_stats[value];
+        stats->_sum -= values[value];
+        
+        if (values[value] == stats->min || values[value] == stats->max) {
+            
+            HISTORYrescan(history, value);
+            
+        }
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// removes all samples
+
+static void HISTORYclear(History * history) {
+    
+    history->_first  = 0;
+    history->_count  = 0;
+    history->_oldest = 0;
+    history->_newest = 0;
+    
+    for (uint8_t value = 0; value < HISTORY_VALUES; value++) {
+        
+        history->_stats[value]._sum = 0;
+        history->_stats[value].min  = 0;
+        history->_stats[value].max  = 0;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// initialize an empty history
+
+void HISTORYinit(History * history) {
+    
+    HISTORYclear(history);
+    history->samples = 0;
+    history->rescans = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// returns 1 if the interval of utc has no sample yet
+
+uint8_t HISTORYdue(const History * history, uint32_t utc) {
+    
+    return history->_count == 0 || utc - utc % HISTORY_INTERVAL != history->_newest;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// adds a sample for the interval of utc (temperature in 0.1 C,
+// humidity in 0.1 %), samples older than 24 h are removed
+//
+// a second sample in the same interval is ignored, a gap of more
+// than HISTORY_MAX_DELTA intervals starts the history over
+
+void HISTORYadd(History * history, uint32_t utc, int16_t temperature, int16_t humidity) {
+    
+    uint8_t * sample;
+    uint32_t time = utc - utc % HISTORY_INTERVAL;
+    uint32_t delta = 0;
+    uint16_t word;
+    int16_t values[HISTORY_VALUES];
+    historyStats * stats;
+    
+    if (history->_count) {
+        
+        if (time <= history->_newest) {
+            
+            return;
+            
+        }
+        
+        delta = (time - history->_newest) / HISTORY_INTERVAL;
+        
+        if (delta > HISTORY_MAX_DELTA) {
+            
+            HISTORYclear(history);
+            delta = 0;
+            
+        }
+        
+    }
+    
+    // drop what is 24 h older than the new sample (and make room)
+    while (history->_count && (time - history->_oldest >= HISTORY_WINDOW || history->_count == HISTORY_SAMPLES)) {
+        
+        HISTORYevict(history);
+        
+    }
+    
+    if (history->_count == 0) {
+        
+        history->_oldest = time;
+        
+    }
+    
+    // clamp to what fits into the sample
+    temperature += HISTORY_TEMP_OFFSET;
+    temperature  = (temperature < 0) ? 0 : (temperature > HISTORY_TEMP_MAX) ? HISTORY_TEMP_MAX : temperature;
+    humidity     = (humidity < 0) ? 0 : (humidity > 1275) ? 1275 : humidity;
+    
+    sample = history->_samples[(history->_first + history->_count) % HISTORY_SAMPLES];
+    word   = ((uint16_t) delta << 11) | temperature;
+    
+    sample[0] = (humidity + 2) / 5;
+    sample[1] = word & 0xFF;
+    sample[2] = word >> 8;
+    
+    history->_count++;
+    history->_newest = time;
+    history->samples++;
+    
+    // statistics of the stored (rounded) values
+    HISTORYunpack(sample, values);
+    
+    for (uint8_t value = 0; value < HISTORY_VALUES; value++) {
+        
+        stats = &history->_stats[value];
+        stats->_sum += values[value];
+        
+        if (history->_count == 1 || values[value] < stats->min) {
+            
+            stats->min = values[value];
+            
+        }
+        
+        if (history->_count == 1 || values[value] > stats->max) {
+            
+            stats->max = values[value];
+            
+        }
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// number of samples in the history
+
+uint16_t HISTORYcount(const History * history) {
+    
+    return history->_count;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// values of a sample (age 0 = newest), returns its UTC
+//
+// the time is found by going back through the deltas, so reading
+// all samples from the newest one on is cheapest
+
+uint32_t HISTORYget(const History * history, uint16_t age, int16_t * values) {
+    
+    uint16_t index = (history->_first + history->_count - 1) % HISTORY_SAMPLES;
+    uint32_t time = history->_newest;
+    
+    for (uint16_t i = 0; i < age; i++) {
+        
+        time -= (uint32_t) HISTORYunpack(history->_samples[index], values) * HISTORY_INTERVAL;
+        index = index ? index - 1 : HISTORY_SAMPLES - 1;
+        
+    }
+    
+    HISTORYunpack(history->_samples[index], values);
+    
+    return time;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// minimum and maximum of a value (0.1 C or 0.1 %)
+
+const historyStats * HISTORYstats(const History * history, uint8_t value) {
+    
+    return &history->_stats[value];
+    
+}
+
+
+// ------------------------------------------------------------ //
+// mean of a value, rounded (0 without samples)
+
+int16_t HISTORYmean(const History * history, uint8_t value) {
+    
+    int32_t sum = history->_stats[value]._sum;
+    int16_t count = history->_count;
+    
+    if (count == 0) {
+        
+        return 0;
+        
+    }
+    
+    return (sum >= 0) ? (sum + count / 2) / count : (sum - count / 2) / count;
+    
+}
@@ -0,0 +1,94 @@
+# ifndef HISTORY_H
+# define HISTORY_H
+
+// ------------------------------------------------------------ //
+// temperature and humidity history of the last 24 h
+//
+// one sample per HISTORY_INTERVAL seconds (aligned to UTC), packed
+// into 3 bytes:
+//
+//   humidity (0.5 %) | delta (5 bit) | temperature (11 bit)
+//
+// delta is the distance to the previous sample in intervals, so
+// missed readings cost nothing, only the time of the newest
+// sample is stored (temperature in 0.1 C from -40.0 to 164.7)
+//
+// sum, minimum and maximum of both values are updated with every
+// sample, so the statistics cost no scan of the buffer, only a
+// sample that leaves the window while it is the minimum or
+// maximum makes that value look through the remaining samples
+
+
+// ------------------------------------------------------------ //
+// settings
+
+// seconds between samples (the buffer holds 24 h of them)
+# ifndef HISTORY_INTERVAL
+# define HISTORY_INTERVAL         900
+# endif
+
+# define HISTORY_WINDOW           86400UL
+# define HISTORY_SAMPLES          (HISTORY_WINDOW / HISTORY_INTERVAL)
+
+// longer gaps start the history over
+# define HISTORY_MAX_DELTA        31
+
+# define HISTORY_TEMP_OFFSET      400
+# define HISTORY_TEMP_MAX         2047
+
+// values of a sample
+enum historyValues {
+    HISTORY_TEMPERATURE = 0,
+    HISTORY_HUMIDITY,
+    HISTORY_VALUES
+};
+
+
+// ------------------------------------------------------------ //
+// statistics of one value (0.1 C or 0.1 %)
+
+typedef struct historyStats {
+    
+    int32_t _sum;
+    int16_t min;
+    int16_t max;
+    
+} historyStats;
+
+
+// ------------------------------------------------------------ //
+// struct for storing the samples and the statistics
+
+typedef struct History {
+    
+    uint8_t _samples[HISTORY_SAMPLES][3];
+    
+    // index of the oldest sample and number of samples
+    uint16_t _first;
+    uint16_t _count;
+    
+    // UTC of the oldest and the newest sample
+    uint32_t _oldest;
+    uint32_t _newest;
+    
+    historyStats _stats[HISTORY_VALUES];
+    
+    // samples added since power on and minimum/maximum scans after evictions
+    uint16_t samples;
+    uint16_t rescans;
+    
+} History;
+
+
+// ------------------------------------------------------------ //
+// user commands for the history
+
+void HISTORYinit(History * history);
+uint8_t HISTORYdue(const History * history, uint32_t utc);
+void HISTORYadd(History * history, uint32_t utc, int16_t temperature, int16_t humidity);
+uint16_t HISTORYcount(const History * history);
+uint32_t HISTORYget(const History * history, uint16_t age, int16_t * values);
+const historyStats * HISTORYstats(const History * history, uint8_t value);
+int16_t HISTORYmean(const History * history, uint8_t value);
+
+# endif
@@ -0,0 +1,112 @@
+// -------------------------------------------------- //
+// checks the integer dew point and heat index (comfort.c)
+// against double precision references
+//
+// every combination of 0.0-50.0 C and 1.0-100.0 % (steps of
+// 0.1, the resolution of the sensor data) is computed both
+// ways, the maximum and mean absolute errors are printed,
+// above 50 C the heat index has to be COMFORT_HEAT_NONE
+//
+// usage: comfortcheck [max_dewpoint_error max_heatindex_error]
+//        (C, defaults 0.2 and 1.0, exit code 1 if exceeded)
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <math.h>
+
+# include "../hal.h"
+# include "../comfort.h"
+
+
+// -------------------------------------------------- //
+// references (C and %)
+
+static double dewPoint(double t, double rh) {
+    
+    double gamma = log(rh / 100.0) + 17.62 * t / (243.12 + t);
+    
+    return 243.12 * gamma / (17.62 - gamma);
+    
+}
+
+static double heatIndex(double t, double rh) {
+    
+    double f = t * 9.0 / 5.0 + 32.0;
+    double hi;
+    
+    if (t < 27.0 || rh < 40.0) {
+        
+        return t;
+        
+    }
+    
+    hi = -42.379 + 2.04901523 * f + 10.14333127 * rh - 0.22475541 * f * rh
+         - 0.00683783 * f * f - 0.05481717 * rh * rh + 0.00122874 * f * f * rh
+         + 0.00085282 * f * rh * rh - 0.00000199 * f * f * rh * rh;
+    
+    return (hi - 32.0) * 5.0 / 9.0;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    double limit_dew  = (argc > 2) ? atof(argv[1]) : 0.2;
+    double limit_heat = (argc > 2) ? atof(argv[2]) : 1.0;
+    double max_dew = 0, max_heat = 0, sum_dew = 0, sum_heat = 0;
+    double error;
+    int worst_dew[2] = {0, 0};
+    int worst_heat[2] = {0, 0};
+    unsigned long count = 0;
+    int above;
+    
+    for (int t = 0; t <= 500; t++) {
+        
+        for (int h = 10; h <= 1000; h++) {
+            
+            error = fabs(COMFORTdewPoint(t, h) / 10.0 - dewPoint(t / 10.0, h / 10.0));
+            sum_dew += error;
+            
+            if (error > max_dew) {
+                
+                max_dew = error;
+                worst_dew[0] = t;
+                worst_dew[1] = h;
+                
+            }
+            
+            error = fabs(COMFORTheatIndex(t, h) / 10.0 - heatIndex(t / 10.0, h / 10.0));
+            sum_heat += error;
+            
+            if (error > max_heat) {
+                
+                max_heat = error;
+                worst_heat[0] = t;
+                worst_heat[1] = h;
+                
+            }
+            
+            count++;
+            
+        }
+        
+    }
+    
+    printf("points %lu\n", count);
+    printf("dewpoint_max_error_c %.3f (at %.1f C %.1f %%)\n", max_dew, worst_dew[0] / 10.0, worst_dew[1] / 10.0);
+    printf("dewpoint_mean_error_c %.4f\n", sum_dew / count);
+    printf("heatindex_max_error_c %.3f (at %.1f C %.1f %%)\n", max_heat, worst_heat[0] / 10.0, worst_heat[1] / 10.0);
+    printf("heatindex_mean_error_c %.4f\n", sum_heat / count);
+    
+    // above the table there is no heat index, below 40 % it is the temperature
+    above = COMFORTheatIndex(501, 400) == COMFORT_HEAT_NONE && COMFORTheatIndex(600, 1000) == COMFORT_HEAT_NONE &&
+            COMFORTheatIndex(600, 390) == 600;
+    printf("heatindex_above_range_ok %d\n", above);
+    
+    return (max_dew > limit_dew || max_heat > limit_heat || !above) ? 1 : 0;
+    
+}
@@ -0,0 +1,147 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+# include "dht11_sim.h"
+
+
+// -------------------------------------------------- //
+// prepares the segments of a frame starting at time
+
+static void DHT11simStartFrame(DHT11sim * sim, uint64_t time) {
+    
+    uint8_t data[5];
+    uint8_t n = 0;
+    
+    data[0] = sim->humi_integral;
+    data[1] = sim->humi_decimal;
+    data[2] = sim->temp_integral;
+    data[3] = sim->temp_decimal;
+    data[4] = data[0] + data[1] + data[2] + data[3];
+    
+    // response
+    time += DHT11_SIM_RESPONSE;
+    sim->_segment_end[n++] = time;
+    time += DHT11_SIM_RESPONSE;
+    sim->_segment_end[n++] = time;
+    
+    // data bits, msb first
+    for (int i = 0; i < 40; i++) {
+        
+        uint8_t bit = (data[i / 8] >> (7 - (i % 8))) & 1;
+        
+        time += DHT11_SIM_BIT_LOW;
+        sim->_segment_end[n++] = time;
+        time += bit ? DHT11_SIM_BIT_ONE : DHT11_SIM_BIT_ZERO;
+        sim->_segment_end[n++] = time;
+        
+    }
+    
+    // end of frame
+    time += DHT11_SIM_BIT_LOW;
+    sim->_segment_end[n++] = time;
+    
+    sim->_active = 1;
+    sim->frames++;
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu changes a pin
+
+static void DHT11simChanged(void * ctx, uint64_t time, uint8_t port, uint8_t mask, uint8_t value) {
+    
+    DHT11sim * sim = ctx;
+    uint8_t level;
+    
+    if (port != sim->_port || !(mask & (1 << sim->_bit))) {
+        
+        return;
+        
+    }
+    
+    level = (value >> sim->_bit) & 1;
+    
+    if (level == 0) {
+        
+        sim->_low_since = time;
+        
+    } else if (sim->_level == 0 && time - sim->_low_since >= DHT11_SIM_START_MIN) {
+        
+        // the host releases the line for 40us before switching to input
+        DHT11simStartFrame(sim, time + 40000ULL + DHT11_SIM_WAIT);
+        
+    }
+    
+    sim->_level = level;
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu reads a pin
+//
+// even segments are low, odd segments are high
+
+static int DHT11simDrive(void * ctx, uint64_t time, uint8_t port, uint8_t bit) {
+    
+    DHT11sim * sim = ctx;
+    
+    if (!sim->_active || port != sim->_port || bit != sim->_bit) {
+        
+        return -1;
+        
+    }
+    
+    if (time < sim->_segment_end[0] - DHT11_SIM_RESPONSE) {
+        
+        return -1;
+        
+    }
+    
+    for (int i = 0; i < DHT11_SIM_SEGMENTS; i++) {
+        
+        if (time < sim->_segment_end[i]) {
+            
+            return i & 1;
+            
+        }
+        
+    }
+    
+    // frame is over, the line is released
+    sim->_active = 0;
+    
+    return -1;
+    
+}
+
+
+// -------------------------------------------------- //
+// creates the sensor and attaches it to the hal
+
+void DHT11simInit(DHT11sim * sim, uint8_t port, uint8_t bit) {
+    
+    sim->_port = port;
+    sim->_bit  = bit;
+    
+    sim->humi_integral = 45;
+    sim->humi_decimal  = 0;
+    sim->temp_integral = 21;
+    sim->temp_decimal  = 5;
+    
+    sim->_level     = 1;
+    sim->_low_since = 0;
+    sim->_active    = 0;
+    sim->frames     = 0;
+    
+    sim->_device.ctx     = sim;
+    sim->_device.changed = DHT11simChanged;
+    sim->_device.drive   = DHT11simDrive;
+    sim->_device.tick    = 0;
+    HALhostAttach(&sim->_device);
+    
+}
@@ -0,0 +1,60 @@
+# ifndef DHT11_SIM_H
+# define DHT11_SIM_H
+
+// ------------------------------------------------------------ //
+// simulated DHT11 on the host
+//
+// answers a start signal (low for at least 18ms) with the
+// response and a 40 bit frame (datasheet page 6-8)
+
+# include <stdint.h>
+
+# include "hal_host.h"
+
+
+// ------------------------------------------------------------ //
+// timing in ns
+
+# define DHT11_SIM_START_MIN     18000000ULL
+# define DHT11_SIM_WAIT          20000ULL
+# define DHT11_SIM_RESPONSE      80000ULL
+# define DHT11_SIM_BIT_LOW       50000ULL
+# define DHT11_SIM_BIT_ZERO      27000ULL
+# define DHT11_SIM_BIT_ONE       70000ULL
+
+// response (low, high), 40 bits (low, high), end of frame (low)
+# define DHT11_SIM_SEGMENTS      (2 + 2 * 40 + 1)
+
+
+// ------------------------------------------------------------ //
+// struct for storing the state of the simulated sensor
+
+typedef struct DHT11sim {
+    
+    // pin (port, bit)
+    uint8_t _port, _bit;
+    
+    // values sent in the next frame
+    uint8_t humi_integral, humi_decimal;
+    uint8_t temp_integral, temp_decimal;
+    
+    // start signal and the end of each segment of the frame
+    uint8_t _level;
+    uint64_t _low_since;
+    uint8_t _active;
+    uint64_t _segment_end[DHT11_SIM_SEGMENTS];
+    
+    // statistics
+    uint32_t frames;
+    
+    HALhostDevice _device;
+    
+} DHT11sim;
+
+
+// ------------------------------------------------------------ //
+// creation
+
+void DHT11simInit(DHT11sim * sim, uint8_t port, uint8_t bit);
+
+# endif
@@ -0,0 +1,347 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+# include "../ds1302.h"
+# include "ds1302_sim.h"
+
+
+// -------------------------------------------------- //
+// protocol states
+
+# define SIM_IDLE       0
+# define SIM_COMMAND    1
+# define SIM_READ       2
+# define SIM_WRITE      3
+# define SIM_IGNORE     4
+
+
+// -------------------------------------------------- //
+// lets the clock registers catch up with the virtual
+// time (one increment per elapsed second of the chip)
+
+static void DS1302simCatchUp(DS1302sim * sim, uint64_t time) {
+    
+    static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    uint8_t * r = sim->_registers;
+    
+    // clock halted
+    if (r[0] & FLAG_CLOCKHALT) {
+        
+        sim->_last_update = time;
+        return;
+        
+    }
+    
+    while (time - sim->_last_update >= sim->_second) {
+        
+        uint8_t second = bcd_to_dec(r[0]);
+        uint8_t minute = bcd_to_dec(r[1]);
+        uint8_t hour   = bcd_to_dec(r[2] & MASK_HOURNOAMPM);
+        uint8_t day    = bcd_to_dec(r[3]);
+        uint8_t month  = bcd_to_dec(r[4]);
+        uint8_t dow    = r[5];
+        uint8_t year   = bcd_to_dec(r[6]);
+        uint8_t length = daysInMonth[month - 1] + (month == 2 && (year % 4) == 0);
+        
+        sim->_last_update += sim->_second;
+        
+        if (++second < 60) goto store;
+        second = 0;
+        if (++minute < 60) goto store;
+        minute = 0;
+        if (++hour < 24) goto store;
+        hour = 0;
+        dow = (dow + 1) % 7;
+        if (++day <= length) goto store;
+        day = 1;
+        if (++month <= 12) goto store;
+        month = 1;
+        year = (year + 1) % 100;
+        
+        store:
+        
+        r[0] = dec_to_bcd(second);
+        r[1] = dec_to_bcd(minute);
+        r[2] = dec_to_bcd(hour);
+        r[3] = dec_to_bcd(day);
+        r[4] = dec_to_bcd(month);
+        r[5] = dow;
+        r[6] = dec_to_bcd(year);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// rising clock edge: sample command or write data
+
+static void DS1302simRisingEdge(DS1302sim * sim) {
+    
+    switch (sim->_state) {
+        
+        case SIM_COMMAND:
+            
+            sim->_shift |= (sim->_io << sim->_bits);
+            
+            if (++sim->_bits < 8) {
+                
+                break;
+                
+            }
+            
+            sim->commands++;
+            sim->_index = (sim->_shift >> 1) & 0x1F;
+            sim->_burst = (sim->_index == 0x1F);
+            sim->_bits  = 0;
+            
+            if (sim->_burst) {
+                
+                sim->_index = 0;
+                
+            }
+            
+            // RAM accesses and unknown registers are ignored
+            if ((sim->_shift & (1 << 6)) || sim->_index > 7) {
+                
+                sim->_state = SIM_IGNORE;
+                
+            } else {
+                
+                sim->_state = (sim->_shift & 1) ? SIM_READ : SIM_WRITE;
+                
+            }
+            
+            sim->_shift = 0;
+            break;
+        
+        case SIM_WRITE:
+            
+            sim->_shift |= (sim->_io << sim->_bits);
+            
+            if (++sim->_bits < 8) {
+                
+                break;
+                
+            }
+            
+            sim->bytes_written++;
+            
+            // only the write protect register is writable when protected
+            if (!(sim->_registers[7] & FLAG_WRITEPROTECT) || sim->_index == 7) {
+                
+                sim->_registers[sim->_index] = sim->_shift;
+                
+            }
+            
+            // a write resets the seconds divider
+            if (sim->_index == 0) {
+                
+                sim->_last_update = HALhostTime();
+                
+            }
+            
+            sim->_bits  = 0;
+            sim->_shift = 0;
+            sim->_index = (sim->_index + 1) & 7;
+            
+            if (!sim->_burst) {
+                
+                sim->_state = SIM_IGNORE;
+                
+            }
+            
+            break;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// falling clock edge: output the next read bit
+
+static void DS1302simFallingEdge(DS1302sim * sim) {
+    
+    if (sim->_state != SIM_READ) {
+        
+        return;
+        
+    }
+    
+    sim->_io_drive = (sim->_registers[sim->_index] >> sim->_bits) & 1;
+    
+    if (++sim->_bits == 8) {
+        
+        sim->bytes_read++;
+        sim->_bits  = 0;
+        sim->_index = (sim->_index + 1) & 7;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu changes a pin
+
+static void DS1302simChanged(void * ctx, uint64_t time, uint8_t port, uint8_t mask, uint8_t value) {
+    
+    DS1302sim * sim = ctx;
+    
+    if (port == sim->_io_port && (mask & (1 << sim->_io_bit))) {
+        
+        sim->_io = (value >> sim->_io_bit) & 1;
+        
+    }
+    
+    if (port == sim->_ce_port && (mask & (1 << sim->_ce_bit))) {
+        
+        sim->_ce = (value >> sim->_ce_bit) & 1;
+        sim->_io_drive = -1;
+        sim->_state = sim->_ce ? SIM_COMMAND : SIM_IDLE;
+        sim->_bits  = 0;
+        sim->_shift = 0;
+        
+        // the chip latches the time when a transfer starts
+        if (sim->_ce) {
+            
+            DS1302simCatchUp(sim, time);
+            
+        }
+        
+    }
+    
+    if (port == sim->_clk_port && (mask & (1 << sim->_clk_bit))) {
+        
+        sim->_clk = (value >> sim->_clk_bit) & 1;
+        
+        if (sim->_ce) {
+            
+            if (sim->_clk) {
+                
+                DS1302simRisingEdge(sim);
+                
+            } else {
+                
+                DS1302simFallingEdge(sim);
+                
+            }
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu reads a pin
+
+static int DS1302simDrive(void * ctx, uint64_t time, uint8_t port, uint8_t bit) {
+    
+    DS1302sim * sim = ctx;
+    
+    if (port == sim->_io_port && bit == sim->_io_bit && sim->_state == SIM_READ) {
+        
+        return sim->_io_drive;
+        
+    }
+    
+    return -1;
+    
+}
+
+
+// -------------------------------------------------- //
+// creates the chip and attaches it to the hal
+// (starts running at 2000-01-01 00:00:00)
+
+void DS1302simInit(DS1302sim * sim, uint8_t ce_port, uint8_t ce_bit,
+                   uint8_t io_port, uint8_t io_bit,
+                   uint8_t clk_port, uint8_t clk_bit) {
+    
+    sim->_ce_port  = ce_port;
+    sim->_ce_bit   = ce_bit;
+    sim->_io_port  = io_port;
+    sim->_io_bit   = io_bit;
+    sim->_clk_port = clk_port;
+    sim->_clk_bit  = clk_bit;
+    
+    sim->_ce  = 0;
+    sim->_io  = 1;
+    sim->_clk = 0;
+    
+    sim->_state    = SIM_IDLE;
+    sim->_io_drive = -1;
+    
+    sim->commands      = 0;
+    sim->bytes_read    = 0;
+    sim->bytes_written = 0;
+    
+    DS1302simSetTime(sim, 0, 1, 1, 0, 0, 0);
+    sim->_registers[7] = FLAG_WRITEPROTECT;
+    sim->_second       = 1000000000ULL;
+    
+    sim->_device.ctx     = sim;
+    sim->_device.changed = DS1302simChanged;
+    sim->_device.drive   = DS1302simDrive;
+    sim->_device.tick    = 0;
+    HALhostAttach(&sim->_device);
+    
+}
+
+
+// -------------------------------------------------- //
+// sets the clock registers
+
+void DS1302simSetTime(DS1302sim * sim, uint8_t year, uint8_t month, uint8_t day,
+                      uint8_t hour, uint8_t minute, uint8_t second) {
+    
+    sim->_registers[0] = dec_to_bcd(second);
+    sim->_registers[1] = dec_to_bcd(minute);
+    sim->_registers[2] = dec_to_bcd(hour);
+    sim->_registers[3] = dec_to_bcd(day);
+    sim->_registers[4] = dec_to_bcd(month);
+    sim->_registers[5] = DS1302dayOfWeekFromDate(day, month, 2000 + year);
+    sim->_registers[6] = dec_to_bcd(year);
+    sim->_last_update  = HALhostTime();
+    
+}
+
+
+// -------------------------------------------------- //
+// lets the crystal run fast (ppb > 0) or slow
+
+void DS1302simSetDrift(DS1302sim * sim, int32_t ppb) {
+    
+    DS1302simCatchUp(sim, HALhostTime());
+    sim->_second = 1000000000LL - ppb;
+    
+}
+
+
+// -------------------------------------------------- //
+// time of the registers in ns since 2000-01-01 00:00:00,
+// including the part of the running second
+
+uint64_t DS1302simTime(DS1302sim * sim) {
+    
+    uint8_t * r = sim->_registers;
+    timeData data;
+    
+    DS1302simCatchUp(sim, HALhostTime());
+    
+    data.second = bcd_to_dec(r[0] & ~FLAG_CLOCKHALT);
+    data.minute = bcd_to_dec(r[1]);
+    data.hour   = bcd_to_dec(r[2] & MASK_HOURNOAMPM);
+    data.day    = bcd_to_dec(r[3]);
+    data.month  = bcd_to_dec(r[4]);
+    data.year   = bcd_to_dec(r[6]);
+    
+    return DS1302timeDataToSeconds(&data) * 1000000000ULL + (HALhostTime() - sim->_last_update);
+    
+}
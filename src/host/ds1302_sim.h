@@ -0,0 +1,68 @@
+# ifndef DS1302_SIM_H
+# define DS1302_SIM_H
+
+// ------------------------------------------------------------ //
+// simulated DS1302 on the host
+//
+// follows the 3-wire protocol bit by bit (datasheet page 7-8):
+// command and write data are sampled on rising clock edges,
+// read data is put onto the io line after falling edges
+// the clock registers keep running with the virtual time
+// (24h mode only, optionally off by a drift), the RAM is not
+// simulated
+
+# include <stdint.h>
+
+# include "hal_host.h"
+
+
+// ------------------------------------------------------------ //
+// struct for storing the state of the simulated chip
+
+typedef struct DS1302sim {
+    
+    // pins (port, bit)
+    uint8_t _ce_port, _ce_bit;
+    uint8_t _io_port, _io_bit;
+    uint8_t _clk_port, _clk_bit;
+    
+    // last levels driven by the mcu
+    uint8_t _ce, _io, _clk;
+    
+    // clock registers (bcd) incl. write protect
+    uint8_t _registers[8];
+    uint64_t _last_update;
+    
+    // length of a second (ns, shorter if the crystal runs fast)
+    uint64_t _second;
+    
+    // protocol state
+    uint8_t _state;
+    uint8_t _shift;
+    uint8_t _bits;
+    uint8_t _index;
+    uint8_t _burst;
+    int _io_drive;
+    
+    // statistics
+    uint32_t commands;
+    uint32_t bytes_read;
+    uint32_t bytes_written;
+    
+    HALhostDevice _device;
+    
+} DS1302sim;
+
+
+// ------------------------------------------------------------ //
+// creation and access to the registers (decimal values)
+
+void DS1302simInit(DS1302sim * sim, uint8_t ce_port, uint8_t ce_bit,
+                   uint8_t io_port, uint8_t io_bit,
+                   uint8_t clk_port, uint8_t clk_bit);
+void DS1302simSetTime(DS1302sim * sim, uint8_t year, uint8_t month, uint8_t day,
+                      uint8_t hour, uint8_t minute, uint8_t second);
+void DS1302simSetDrift(DS1302sim * sim, int32_t ppb);
+uint64_t DS1302simTime(DS1302sim * sim);
+
+# endif
@@ -0,0 +1,470 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+
+
+// -------------------------------------------------- //
+// register file of the peripherals that are not simulated
+
+volatile uint8_t EICRA, EIMSK;
+volatile uint8_t TCCR0A, TCCR0B, OCR0A, TIMSK0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A;
+
+
+// -------------------------------------------------- //
+// simulated ports (B, C, D and the expander), virtual time
+// and devices
+
+static uint8_t port_ddr[HAL_HOST_PORTS];
+static uint8_t port_out[HAL_HOST_PORTS];
+static uint8_t port_level[HAL_HOST_PORTS];
+
+static uint64_t now = 0;
+static uint64_t deadline = UINT64_MAX;
+static void (*deadline_expired)(void) = 0;
+static void (*tick_hook)(uint64_t time) = 0;
+static void (*trace_hook)(uint64_t time, uint8_t port, uint8_t mask, uint8_t value) = 0;
+static uint8_t trace_level[3];
+
+static HALhostDevice * devices[HAL_HOST_DEVICES];
+static uint8_t device_count = 0;
+
+static uint64_t eeprom_busy_until = 0;
+
+
+// -------------------------------------------------- //
+// resets ports, time and the list of devices
+
+void HALhostReset(void) {
+    
+    for (int i = 0; i < HAL_HOST_PORTS; i++) {
+        
+        port_ddr[i]   = 0;
+        port_out[i]   = 0;
+        port_level[i] = 0xFF;
+        
+    }
+    
+    for (int i = 0; i < 3; i++) {
+        
+        trace_level[i] = 0xFF;
+        
+    }
+    
+    now = 0;
+    deadline = UINT64_MAX;
+    deadline_expired = 0;
+    tick_hook = 0;
+    trace_hook = 0;
+    device_count = 0;
+    eeprom_busy_until = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// attaches a peripheral model
+
+void HALhostAttach(HALhostDevice * device) {
+    
+    if (device_count < HAL_HOST_DEVICES) {
+        
+        devices[device_count++] = device;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// sets the virtual time at which expired is called
+// (expired is expected not to return, e.g. longjmp)
+
+void HALhostSetDeadline(uint64_t time, void (*expired)(void)) {
+    
+    deadline = time;
+    deadline_expired = expired;
+    
+}
+
+
+// -------------------------------------------------- //
+// sets a function that is called whenever time advances
+// (used to inject button presses)
+
+void HALhostSetTickHook(void (*hook)(uint64_t time)) {
+    
+    tick_hook = hook;
+    
+}
+
+
+// -------------------------------------------------- //
+// sets a function that receives the gpio trace, it first
+// gets the current levels of all ports (mask 0xFF)
+
+void HALhostSetTraceHook(void (*hook)(uint64_t time, uint8_t port, uint8_t mask, uint8_t value)) {
+    
+    trace_hook = hook;
+    
+    for (uint8_t port = 0; port < 3 && hook; port++) {
+        
+        trace_level[port] = 0;
+        
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            
+            trace_level[port] |= HALhostInput(port, bit) << bit;
+            
+        }
+        
+        hook(now, port, 0xFF, trace_level[port]);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// virtual time in ns and in cpu cycles
+
+uint64_t HALhostTime(void) {
+    
+    return now;
+    
+}
+
+uint32_t HALhostCycles(void) {
+    
+    return (uint32_t) (now * (F_CPU / 1000000UL) / 1000);
+    
+}
+
+
+// -------------------------------------------------- //
+// level the mcu currently drives onto a port
+
+uint8_t HALhostOutput(uint8_t port) {
+    
+    return port_level[port];
+    
+}
+
+
+// -------------------------------------------------- //
+// level of a pin as the mcu would read it, a pin configured
+// as input follows the devices
+
+uint8_t HALhostInput(uint8_t port, uint8_t bit) {
+    
+    uint8_t level = (port_level[port] >> bit) & 1;
+    
+    if ((port_ddr[port] & (1 << bit)) == 0) {
+        
+        for (uint8_t i = 0; i < device_count; i++) {
+            
+            int driven = devices[i]->drive ? devices[i]->drive(devices[i]->ctx, now, port, bit) : -1;
+            
+            if (driven >= 0) {
+                
+                level = driven;
+                break;
+                
+            }
+            
+        }
+        
+    }
+    
+    return level;
+    
+}
+
+
+// -------------------------------------------------- //
+// advances the virtual time
+
+static void advance(uint64_t ns) {
+    
+    uint64_t target = now + ns;
+    HALhostDevice * due;
+    
+    // background work of the devices, in the order it is due
+    while (1) {
+        
+        due = 0;
+        
+        for (uint8_t i = 0; i < device_count; i++) {
+            
+            if (devices[i]->tick && devices[i]->next && devices[i]->next <= target &&
+                (!due || devices[i]->next < due->next)) {
+                
+                due = devices[i];
+                
+            }
+            
+        }
+        
+        if (!due) {
+            
+            break;
+            
+        }
+        
+        now = (due->next > now) ? due->next : now;
+        due->next = 0;
+        due->tick(due->ctx, now);
+        
+    }
+    
+    now = target;
+    
+    if (tick_hook) {
+        
+        tick_hook(now);
+        
+    }
+    
+    if (now >= deadline && deadline_expired) {
+        
+        deadline_expired();
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// recomputes the driven levels of a port and notifies
+// the devices about changes
+
+static void update(uint8_t port) {
+    
+    // outputs drive their PORTx bit, inputs are pulled up
+    uint8_t level = (port_out[port] & port_ddr[port]) | ~port_ddr[port];
+    uint8_t mask  = level ^ port_level[port];
+    
+    port_level[port] = level;
+    
+    if (mask == 0) {
+        
+        return;
+        
+    }
+    
+    for (uint8_t i = 0; i < device_count; i++) {
+        
+        if (devices[i]->changed) {
+            
+            devices[i]->changed(devices[i]->ctx, now, port, mask, level);
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// passes changed line levels to the trace hook (all ports,
+// devices may change their pins on any access)
+
+static void trace(void) {
+    
+    if (!trace_hook) {
+        
+        return;
+        
+    }
+    
+    for (uint8_t port = 0; port < 3; port++) {
+        
+        uint8_t level = 0;
+        
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            
+            level |= HALhostInput(port, bit) << bit;
+            
+        }
+        
+        if (level != trace_level[port]) {
+            
+            trace_hook(now, port, level ^ trace_level[port], level);
+            trace_level[port] = level;
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// gpio accesses
+
+void HALhostWrite(uint8_t port, uint8_t bit, uint8_t value) {
+    
+    if (value) {
+        
+        port_out[port] |= (1 << bit);
+        
+    } else {
+        
+        port_out[port] &= ~(1 << bit);
+        
+    }
+    
+    update(port);
+    trace();
+    advance(HAL_HOST_ACCESS_NS);
+    
+}
+
+uint8_t HALhostRead(uint8_t port, uint8_t bit) {
+    
+    uint8_t level = HALhostInput(port, bit);
+    
+    trace();
+    advance(HAL_HOST_ACCESS_NS);
+    
+    return level;
+    
+}
+
+void HALhostDir(uint8_t port, uint8_t bit, uint8_t dir) {
+    
+    if (dir) {
+        
+        port_ddr[port] |= (1 << bit);
+        
+    } else {
+        
+        port_ddr[port] &= ~(1 << bit);
+        
+    }
+    
+    update(port);
+    trace();
+    advance(HAL_HOST_ACCESS_NS);
+    
+}
+
+void HALhostPortInit(uint8_t port, uint8_t ddr, uint8_t value) {
+    
+    port_ddr[port] = ddr;
+    port_out[port] = value;
+    
+    update(port);
+    trace();
+    advance(2 * HAL_HOST_ACCESS_NS);
+    
+}
+
+
+// -------------------------------------------------- //
+// sets the registers of a port at a given time, used when
+// the pins are driven by a model (the I2C expander)
+
+void HALhostSetPort(uint64_t time, uint8_t port, uint8_t ddr, uint8_t value) {
+    
+    now = time;
+    port_ddr[port] = ddr;
+    port_out[port] = value;
+    
+    update(port);
+    
+}
+
+
+// -------------------------------------------------- //
+// busy-wait delay
+
+void HALhostDelayNs(uint64_t ns) {
+    
+    advance(ns);
+    
+}
+
+
+// -------------------------------------------------- //
+// EEPROM
+
+uint8_t HALhostEeprom[HAL_HOST_EEPROM_SIZE];
+uint32_t HALhostEepromWrites[HAL_HOST_EEPROM_SIZE];
+
+uint8_t HALhostEepromRead(uint16_t address) {
+    
+    // reading waits for a running write like the real thing
+    if (now < eeprom_busy_until) {
+        
+        advance(eeprom_busy_until - now);
+        
+    }
+    
+    advance(HAL_HOST_ACCESS_NS);
+    
+    return HALhostEeprom[address % HAL_HOST_EEPROM_SIZE];
+    
+}
+
+void HALhostEepromUpdate(uint16_t address, uint8_t value) {
+    
+    address %= HAL_HOST_EEPROM_SIZE;
+    
+    if (now < eeprom_busy_until) {
+        
+        advance(eeprom_busy_until - now);
+        
+    }
+    
+    if (HALhostEeprom[address] != value) {
+        
+        HALhostEeprom[address] = value;
+        HALhostEepromWrites[address]++;
+        eeprom_busy_until = now + HAL_HOST_EEPROM_NS;
+        
+    }
+    
+    advance(HAL_HOST_ACCESS_NS);
+    
+}
+
+uint8_t HALhostEepromReady(void) {
+    
+    return now >= eeprom_busy_until;
+    
+}
+
+void HALhostEepromErase(void) {
+    
+    for (uint16_t i = 0; i < HAL_HOST_EEPROM_SIZE; i++) {
+        
+        HALhostEeprom[i] = 0xFF;
+        HALhostEepromWrites[i] = 0;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// millisecond and microsecond timer (virtual time)
+
+void HALtimerInit(void) {
+    
+}
+
+uint32_t HALmillis(void) {
+    
+    return (uint32_t) (now / 1000000);
+    
+}
+
+uint32_t HALmicros(void) {
+    
+    return (uint32_t) (now / 1000);
+    
+}
@@ -0,0 +1,194 @@
+# ifndef HAL_HOST_H
+# define HAL_HOST_H
+
+// ------------------------------------------------------------ //
+// host side of the hardware abstraction layer
+//
+// keeps the simulated port registers and a virtual clock in ns,
+// every gpio access costs HAL_HOST_ACCESS_NS of virtual time and
+// every change of the pin levels is passed to the attached
+// peripheral models
+//
+// the trace hook sees the resulting line levels of a port (mcu
+// outputs and device driven inputs) whenever a gpio access
+// changes them, this is the gpio trace (see host/trace.h)
+
+# include <stdint.h>
+# include <stdio.h>
+# include <string.h>
+
+
+// ------------------------------------------------------------ //
+// settings
+
+// virtual time of one gpio access (2 cycles at 16 MHz)
+# define HAL_HOST_ACCESS_NS     125
+
+// maximum number of attached peripheral models
+# define HAL_HOST_DEVICES       8
+
+// outputs of a port expander (after the mcu ports B, C and D),
+// set by its model with HALhostSetPort, not in the gpio trace
+# define HAL_HOST_PORTX         3
+# define HAL_HOST_PORTS         4
+
+// EEPROM size and write time
+# define HAL_HOST_EEPROM_SIZE   1024
+# define HAL_HOST_EEPROM_NS     3300000ULL
+
+
+// ------------------------------------------------------------ //
+// register file of the peripherals that are not simulated, so
+// the register setup in main, lcd and uart compiles unchanged
+
+# define HAL_HOST_REGISTER(name) extern volatile uint8_t name;
+
+HAL_HOST_REGISTER(EICRA)
+HAL_HOST_REGISTER(EIMSK)
+HAL_HOST_REGISTER(TCCR0A)
+HAL_HOST_REGISTER(TCCR0B)
+HAL_HOST_REGISTER(OCR0A)
+HAL_HOST_REGISTER(TIMSK0)
+HAL_HOST_REGISTER(TCCR1A)
+HAL_HOST_REGISTER(TCCR1B)
+HAL_HOST_REGISTER(TIMSK1)
+HAL_HOST_REGISTER(TIFR1)
+HAL_HOST_REGISTER(TCCR2A)
+HAL_HOST_REGISTER(TCCR2B)
+HAL_HOST_REGISTER(OCR2A)
+
+// pins
+# define PB0 0
+# define PB1 1
+# define PB2 2
+# define PB3 3
+# define PB4 4
+# define PB5 5
+# define PB6 6
+# define PB7 7
+# define PC0 0
+# define PC1 1
+# define PC2 2
+# define PC3 3
+# define PC4 4
+# define PC5 5
+# define PD0 0
+# define PD1 1
+# define PD2 2
+# define PD3 3
+# define PD4 4
+# define PD5 5
+# define PD6 6
+# define PD7 7
+
+// register bits
+# define ISC00  0
+# define ISC01  1
+# define INT0   0
+# define WGM20  0
+# define WGM21  1
+# define COM2A1 7
+# define CS20   0
+# define CS10   0
+# define TOIE1  0
+# define TOV1   0
+
+// interrupts become plain functions the simulation can call
+# define ISR(vector)    void vector(void)
+# define sei()
+# define cli()
+
+// program memory is ordinary memory on the host
+# define PROGMEM
+# define PGM_P                   const char *
+# define PSTR(s)                 (s)
+# define pgm_read_byte(address)  (*(const uint8_t *) (address))
+# define pgm_read_word(address)  (*(const uint16_t *) (address))
+# define pgm_read_ptr(address)   (*(const void * const *) (address))
+# define memcpy_P                memcpy
+# define strcpy_P                strcpy
+# define strncpy_P               strncpy
+# define strncmp_P               strncmp
+# define strcmp_P                strcmp
+# define strlen_P                strlen
+# define snprintf_P              snprintf
+# define sscanf_P                sscanf
+
+
+// ------------------------------------------------------------ //
+// struct for a simulated peripheral
+//
+// changed: called whenever the level the mcu drives onto a port
+//          changes (released pins read as 1, external pull-ups)
+// drive:   returns the level the device drives onto a pin or -1
+// tick:    called once the virtual time reaches next (0 = nothing
+//          pending), for models that work in the background like
+//          the TWI, they set next again for the following event
+
+typedef struct HALhostDevice {
+    
+    void * ctx;
+    void (*changed)(void * ctx, uint64_t time, uint8_t port, uint8_t mask, uint8_t value);
+    int (*drive)(void * ctx, uint64_t time, uint8_t port, uint8_t bit);
+    void (*tick)(void * ctx, uint64_t time);
+    uint64_t next;
+    
+} HALhostDevice;
+
+
+// ------------------------------------------------------------ //
+// simulation control
+
+void HALhostReset(void);
+void HALhostAttach(HALhostDevice * device);
+void HALhostSetDeadline(uint64_t deadline, void (*expired)(void));
+void HALhostSetTickHook(void (*hook)(uint64_t time));
+void HALhostSetTraceHook(void (*hook)(uint64_t time, uint8_t port, uint8_t mask, uint8_t value));
+uint64_t HALhostTime(void);
+uint32_t HALhostCycles(void);
+uint8_t HALhostOutput(uint8_t port);
+uint8_t HALhostInput(uint8_t port, uint8_t bit);
+void HALhostSetPort(uint64_t time, uint8_t port, uint8_t ddr, uint8_t value);
+
+
+// ------------------------------------------------------------ //
+// serial port (host/uart_host.c replaces uart.c), every byte the
+// firmware sends is passed to the sink
+
+void UARThostSetSink(void (*sink)(uint8_t c));
+int UARThostReceive(uint8_t c);
+
+
+// ------------------------------------------------------------ //
+// TWI (host/twi_host.c replaces twi.c), the transfers take the
+// time of the bus clock in the background and every byte is
+// passed to the slave with its address when it was sent
+
+# define TWI_HOST_SLAVES        4
+
+void TWIhostAttach(uint8_t address, void (*receive)(void * ctx, uint64_t time, uint8_t value), void * ctx);
+
+
+// ------------------------------------------------------------ //
+// EEPROM, the contents and the number of writes per cell can be
+// inspected (erased cells read 0xFF)
+
+extern uint8_t HALhostEeprom[HAL_HOST_EEPROM_SIZE];
+extern uint32_t HALhostEepromWrites[HAL_HOST_EEPROM_SIZE];
+
+uint8_t HALhostEepromRead(uint16_t address);
+void HALhostEepromUpdate(uint16_t address, uint8_t value);
+uint8_t HALhostEepromReady(void);
+void HALhostEepromErase(void);
+
+
+// ------------------------------------------------------------ //
+// gpio and delays (used by the hal_* macros)
+
+void HALhostWrite(uint8_t port, uint8_t bit, uint8_t value);
+uint8_t HALhostRead(uint8_t port, uint8_t bit);
+void HALhostDir(uint8_t port, uint8_t bit, uint8_t dir);
+void HALhostPortInit(uint8_t port, uint8_t ddr, uint8_t value);
+void HALhostDelayNs(uint64_t ns);
+
+# endif
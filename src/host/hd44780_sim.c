@@ -0,0 +1,558 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+# include <string.h>
+
+# include "../hal.h"
+# include "../lcd.h"
+# include "hd44780_sim.h"
+
+
+// -------------------------------------------------- //
+// moves the address counter by one in the current
+// direction, DDRAM wraps from the end of one line to the
+// start of the other (40 per line in 2-line mode)
+
+static void HD44780simStepAddress(HD44780sim * sim) {
+    
+    if (sim->_cgram_selected) {
+        
+        sim->ac = (sim->ac + (sim->_increment ? 1 : -1)) & 0x3F;
+        return;
+        
+    }
+    
+    if (sim->two_lines) {
+        
+        if (sim->_increment) {
+            
+            sim->ac = (sim->ac == 0x27) ? 0x40 : (sim->ac == 0x67) ? 0x00 : sim->ac + 1;
+            
+        } else {
+            
+            sim->ac = (sim->ac == 0x40) ? 0x27 : (sim->ac == 0x00) ? 0x67 : sim->ac - 1;
+            
+        }
+        
+    } else {
+        
+        if (sim->_increment) {
+            
+            sim->ac = (sim->ac == 0x4F) ? 0x00 : sim->ac + 1;
+            
+        } else {
+            
+            sim->ac = (sim->ac == 0x00) ? 0x4F : sim->ac - 1;
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// shifts the display window by one (right = 1)
+
+static void HD44780simShiftDisplay(HD44780sim * sim, uint8_t right) {
+    
+    uint8_t width = sim->two_lines ? 40 : 80;
+    
+    sim->shift = right ? (sim->shift + width - 1) % width : (sim->shift + 1) % width;
+    
+}
+
+
+// -------------------------------------------------- //
+// index into the DDRAM array for an address
+
+static uint8_t HD44780simDDRAMindex(HD44780sim * sim, uint8_t address) {
+    
+    if (sim->two_lines) {
+        
+        return (address >= 0x40) ? 40 + ((address - 0x40) % 40) : address % 40;
+        
+    }
+    
+    return address % 80;
+    
+}
+
+
+// -------------------------------------------------- //
+// executes one instruction or data write, returns the
+// execution time
+
+static uint64_t HD44780simExecute(HD44780sim * sim, uint8_t rs, uint8_t value) {
+    
+    // data write to DDRAM or CGRAM
+    if (rs) {
+        
+        sim->writes++;
+        
+        if (sim->_cgram_selected) {
+            
+            sim->cgram[sim->ac & 0x3F] = value & 0x1F;
+            
+        } else {
+            
+            sim->ddram[HD44780simDDRAMindex(sim, sim->ac)] = value;
+            
+            if (sim->_autoshift) {
+                
+                HD44780simShiftDisplay(sim, !sim->_increment);
+                
+            }
+            
+        }
+        
+        HD44780simStepAddress(sim);
+        
+        return HD44780_SIM_WRITE_NS;
+        
+    }
+    
+    sim->instructions++;
+    
+    if (value & MASK_SETDDRAMADDR) {
+        
+        sim->ac = value & 0x7F;
+        sim->_cgram_selected = 0;
+        
+    } else if (value & MASK_SETCGRAMADDR) {
+        
+        sim->ac = value & 0x3F;
+        sim->_cgram_selected = 1;
+        
+    } else if (value & MASK_FUNCTIONSET) {
+        
+        sim->_eightbit = (value & FLAG_FUNCTIONSET_8BITBUS) != 0;
+        sim->two_lines = (value & FLAG_FUNCTIONSET_TWOLINE) != 0;
+        sim->_nibble_pending = 0;
+        
+        // the first function sets after power on take longer
+        if (sim->_functionsets++ == 0) {
+            
+            return HD44780_SIM_INIT_NS;
+            
+        }
+        
+    } else if (value & MASK_DISPLAYCURSORSHIFT) {
+        
+        if (value & FLAG_DISPLAYCURSORSHIFT_SHIFTDISPLAY) {
+            
+            HD44780simShiftDisplay(sim, (value & FLAG_DISPLAYCURSORSHIFT_SHIFTRIGHT) != 0);
+            
+        } else {
+            
+            uint8_t increment = sim->_increment;
+            
+            sim->_increment = (value & FLAG_DISPLAYCURSORSHIFT_SHIFTRIGHT) != 0;
+            HD44780simStepAddress(sim);
+            sim->_increment = increment;
+            
+        }
+        
+    } else if (value & MASK_DISPLAYCONTROL) {
+        
+        sim->display_on = (value & FLAG_DISPLAYCONTROL_DISPLAYON) != 0;
+        sim->cursor_on  = (value & FLAG_DISPLAYCONTROL_CURSORON) != 0;
+        sim->blink_on   = (value & FLAG_DISPLAYCONTROL_BLINKON) != 0;
+        
+    } else if (value & MASK_ENTRYMODESET) {
+        
+        sim->_increment = (value & FLAG_ENTRY_SHIFTCURSORRIGHT) != 0;
+        sim->_autoshift = (value & FLAG_ENTRY_AUTOSHIFT) != 0;
+        
+    } else if (value & MASK_RETURNHOME) {
+        
+        sim->ac = 0;
+        sim->shift = 0;
+        sim->_cgram_selected = 0;
+        
+        return HD44780_SIM_HOME_NS;
+        
+    } else if (value & MASK_CLEARDISPLAY) {
+        
+        memset(sim->ddram, ' ', sizeof(sim->ddram));
+        sim->ac = 0;
+        sim->shift = 0;
+        sim->_increment = 1;
+        sim->_cgram_selected = 0;
+        
+        return HD44780_SIM_CLEAR_NS;
+        
+    }
+    
+    return HD44780_SIM_DEFAULT_NS;
+    
+}
+
+
+// -------------------------------------------------- //
+// prepares the byte for a read on a rising enable edge
+// (the first nibble of the 4-bit interface fetches it)
+
+static void HD44780simPrepareRead(HD44780sim * sim, uint64_t time) {
+    
+    uint8_t rs = (HALhostOutput(sim->_rs_port) >> sim->_rs_bit) & 1;
+    
+    sim->_reading = 1;
+    
+    if (!sim->_eightbit && sim->_read_nibble) {
+        
+        return;
+        
+    }
+    
+    if (!rs) {
+        
+        // busy flag and address counter, may be read while busy
+        sim->_read = ((time < sim->_busy_until) ? 0x80 : 0x00) | (sim->ac & 0x7F);
+        
+    } else {
+        
+        if (time < sim->_busy_until) {
+            
+            sim->violations++;
+            
+        }
+        
+        sim->_read = sim->_cgram_selected ? sim->cgram[sim->ac & 0x3F] : sim->ddram[HD44780simDDRAMindex(sim, sim->ac)];
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// ends a read on a falling enable edge, a data read moves
+// the address counter like a write
+
+static void HD44780simFinishRead(HD44780sim * sim, uint64_t time) {
+    
+    uint8_t rs = (HALhostOutput(sim->_rs_port) >> sim->_rs_bit) & 1;
+    
+    sim->_reading = 0;
+    
+    if (!sim->_eightbit && !sim->_read_nibble) {
+        
+        sim->_read_nibble = 1;
+        return;
+        
+    }
+    
+    sim->_read_nibble = 0;
+    
+    if (rs) {
+        
+        sim->reads++;
+        HD44780simStepAddress(sim);
+        sim->_busy_until = time + HD44780_SIM_WRITE_NS;
+        sim->busy_ns    += HD44780_SIM_WRITE_NS;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// level of a data pin during a read (-1 = not driven)
+
+static int HD44780simDrive(void * ctx, uint64_t time, uint8_t port, uint8_t bit) {
+    
+    HD44780sim * sim = ctx;
+    uint8_t value;
+    
+    if (!sim->_reading) {
+        
+        return -1;
+        
+    }
+    
+    // the 4-bit interface sends the high nibble first, both on DB4-DB7
+    value = (!sim->_eightbit && sim->_read_nibble) ? (sim->_read << 4) : sim->_read;
+    
+    for (int i = 0; i < 8; i++) {
+        
+        if (sim->_data_port[i] == port && sim->_data_bit[i] == bit) {
+            
+            return (value >> i) & 1;
+            
+        }
+        
+    }
+    
+    return -1;
+    
+}
+
+
+// -------------------------------------------------- //
+// latches the bus on a falling enable edge
+
+static void HD44780simLatch(HD44780sim * sim, uint64_t time) {
+    
+    uint8_t rs = (HALhostOutput(sim->_rs_port) >> sim->_rs_bit) & 1;
+    uint8_t bus = 0;
+    uint8_t value;
+    uint64_t duration;
+    
+    for (int i = 0; i < 8; i++) {
+        
+        if (sim->_data_port[i] != HD44780_SIM_NC) {
+            
+            bus |= ((HALhostOutput(sim->_data_port[i]) >> sim->_data_bit[i]) & 1) << i;
+            
+        }
+        
+    }
+    
+    if (time - sim->_en_rise < HD44780_SIM_ENABLE_NS) {
+        
+        sim->violations++;
+        
+    }
+    
+    // 4-bit interface: the first nibble is only stored
+    if (!sim->_eightbit) {
+        
+        if (!sim->_nibble_pending) {
+            
+            sim->_nibble = bus & 0xF0;
+            sim->_nibble_pending = 1;
+            
+            return;
+            
+        }
+        
+        sim->_nibble_pending = 0;
+        value = sim->_nibble | (bus >> 4);
+        
+    } else {
+        
+        value = bus;
+        
+    }
+    
+    // the controller ignores the timing before power on completes
+    // and while busy, both are counted as violations
+    if (time < HD44780_SIM_POWERON_NS || time < sim->_busy_until) {
+        
+        sim->violations++;
+        
+    }
+    
+    if (sim->first_transfer == 0) {
+        
+        sim->first_transfer = time;
+        
+    }
+    
+    duration = HD44780simExecute(sim, rs, value);
+    
+    sim->_busy_until   = time + duration;
+    sim->busy_ns      += duration;
+    sim->last_transfer = time;
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu changes a pin
+
+static void HD44780simChanged(void * ctx, uint64_t time, uint8_t port, uint8_t mask, uint8_t value) {
+    
+    HD44780sim * sim = ctx;
+    uint8_t en;
+    uint8_t rw;
+    
+    if (port != sim->_en_port || !(mask & (1 << sim->_en_bit))) {
+        
+        return;
+        
+    }
+    
+    en = (value >> sim->_en_bit) & 1;
+    rw = (sim->_rw_port != HD44780_SIM_NC) && ((HALhostOutput(sim->_rw_port) >> sim->_rw_bit) & 1);
+    
+    if (en && !sim->_en) {
+        
+        sim->_en_rise = time;
+        
+        if (rw) {
+            
+            HD44780simPrepareRead(sim, time);
+            
+        }
+        
+    } else if (!en && sim->_en) {
+        
+        if (sim->_reading) {
+            
+            HD44780simFinishRead(sim, time);
+            
+        } else {
+            
+            HD44780simLatch(sim, time);
+            
+        }
+        
+    }
+    
+    sim->_en = en;
+    
+}
+
+
+// -------------------------------------------------- //
+// creates the controller in its power on state and
+// attaches it to the hal
+
+void HD44780simInit(HD44780sim * sim, uint8_t rows, uint8_t cols,
+                    uint8_t rs_port, uint8_t rs_bit,
+                    uint8_t en_port, uint8_t en_bit,
+                    const uint8_t * data_port, const uint8_t * data_bit) {
+    
+    memset(sim, 0, sizeof(*sim));
+    
+    sim->rows = rows;
+    sim->cols = cols;
+    
+    sim->_rs_port = rs_port;
+    sim->_rs_bit  = rs_bit;
+    sim->_rw_port = HD44780_SIM_NC;
+    sim->_en_port = en_port;
+    sim->_en_bit  = en_bit;
+    
+    for (int i = 0; i < 8; i++) {
+        
+        sim->_data_port[i] = data_port[i];
+        sim->_data_bit[i]  = data_bit[i];
+        
+    }
+    
+    // power on reset state (datasheet page 23)
+    memset(sim->ddram, ' ', sizeof(sim->ddram));
+    sim->_eightbit  = 1;
+    sim->_increment = 1;
+    
+    sim->_device.ctx     = sim;
+    sim->_device.changed = HD44780simChanged;
+    sim->_device.drive   = HD44780simDrive;
+    sim->_device.tick    = 0;
+    HALhostAttach(&sim->_device);
+    
+}
+
+
+// -------------------------------------------------- //
+// connects the read/write pin (not connected = the mcu
+// can only write, as after HD44780simInit)
+
+void HD44780simSetRW(HD44780sim * sim, uint8_t rw_port, uint8_t rw_bit) {
+    
+    sim->_rw_port = rw_port;
+    sim->_rw_bit  = rw_bit;
+    
+}
+
+
+// -------------------------------------------------- //
+// overwrites a DDRAM cell without the mcu noticing
+
+void HD44780simCorrupt(HD44780sim * sim, uint8_t address, uint8_t value) {
+    
+    sim->ddram[HD44780simDDRAMindex(sim, address)] = value;
+    
+}
+
+
+// -------------------------------------------------- //
+// power on reset (datasheet page 23), the interface is back
+// to 8 bits and the first function set takes longer again
+
+void HD44780simPowerOn(HD44780sim * sim) {
+    
+    memset(sim->ddram, ' ', sizeof(sim->ddram));
+    sim->ac              = 0;
+    sim->shift           = 0;
+    sim->_eightbit       = 1;
+    sim->_nibble_pending = 0;
+    sim->_read_nibble    = 0;
+    sim->_reading        = 0;
+    sim->_functionsets   = 0;
+    sim->_increment      = 1;
+    sim->_autoshift      = 0;
+    sim->_cgram_selected = 0;
+    sim->display_on      = 0;
+    sim->cursor_on       = 0;
+    sim->blink_on        = 0;
+    sim->two_lines       = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// clears the counters
+
+void HD44780simResetStatistics(HD44780sim * sim) {
+    
+    sim->instructions   = 0;
+    sim->writes         = 0;
+    sim->reads          = 0;
+    sim->violations     = 0;
+    sim->busy_ns        = 0;
+    sim->first_transfer = 0;
+    sim->last_transfer  = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// character code at a visible position
+
+uint8_t HD44780simCharAt(HD44780sim * sim, uint8_t row, uint8_t col) {
+    
+    uint8_t width = sim->two_lines ? 40 : 80;
+    uint8_t base  = (row & 1) ? 0x40 : 0x00;
+    
+    // rows 2 and 3 of 4-line panels continue rows 0 and 1
+    if (row >= 2) {
+        
+        col += sim->cols;
+        
+    }
+    
+    if (!sim->display_on) {
+        
+        return ' ';
+        
+    }
+    
+    return sim->ddram[HD44780simDDRAMindex(sim, base + (col + sim->shift) % width)];
+    
+}
+
+
+// -------------------------------------------------- //
+// renders the visible contents
+
+void HD44780simRender(HD44780sim * sim, char * out) {
+    
+    for (uint8_t row = 0; row < sim->rows; row++) {
+        
+        for (uint8_t col = 0; col < sim->cols; col++) {
+            
+            uint8_t c = HD44780simCharAt(sim, row, col);
+            
+            *out++ = (c < 0x10) ? '#' : (c < 0x20 || c > 0x7E) ? '?' : c;
+            
+        }
+        
+        *out++ = (row + 1 < sim->rows) ? '\n' : '\0';
+        
+    }
+    
+}
@@ -0,0 +1,136 @@
+# ifndef HD44780_SIM_H
+# define HD44780_SIM_H
+
+// ------------------------------------------------------------ //
+// simulated HD44780 controller on the host
+//
+// latches the bus on the falling edge of the enable pin and
+// follows the instruction set of the datasheet (page 24-27):
+// 8-bit and 4-bit interface incl. nibble sequencing, DDRAM and
+// CGRAM, address counter, entry mode, display shift and the
+// execution time of every instruction
+//
+// with a read/write pin (HD44780simSetRW) the mcu can also read
+// the busy flag and address counter (RS = 0) or the data at the
+// address counter (RS = 1), the controller drives the data pins
+// while enable is high
+//
+// timing violations that are counted:
+// - instruction or data read while the controller is still busy
+// - instruction within 40ms after power on
+// - enable pulse shorter than 450ns
+
+# include <stdint.h>
+
+# include "hal_host.h"
+
+
+// ------------------------------------------------------------ //
+// execution times in ns (datasheet page 24, 270 kHz)
+
+# define HD44780_SIM_CLEAR_NS       1520000ULL
+# define HD44780_SIM_HOME_NS        1520000ULL
+# define HD44780_SIM_DEFAULT_NS     37000ULL
+# define HD44780_SIM_WRITE_NS       41000ULL
+# define HD44780_SIM_POWERON_NS     40000000ULL
+# define HD44780_SIM_INIT_NS        4100000ULL
+# define HD44780_SIM_ENABLE_NS      450ULL
+
+// pin that is not connected
+# define HD44780_SIM_NC             0xFF
+
+
+// ------------------------------------------------------------ //
+// struct for storing the state of the simulated controller
+
+typedef struct HD44780sim {
+    
+    // pins (port, bit), data pins DB0-7 (not connected = 0xFF)
+    uint8_t _rs_port, _rs_bit;
+    uint8_t _rw_port, _rw_bit;
+    uint8_t _en_port, _en_bit;
+    uint8_t _data_port[8], _data_bit[8];
+    
+    // visible area
+    uint8_t rows;
+    uint8_t cols;
+    
+    // interface
+    uint8_t _en;
+    uint64_t _en_rise;
+    uint8_t _eightbit;
+    uint8_t _nibble_pending;
+    uint8_t _nibble;
+    uint8_t _functionsets;
+    
+    // byte the controller drives during a read, and the read nibble
+    uint8_t _read;
+    uint8_t _reading;
+    uint8_t _read_nibble;
+    
+    // memory and registers
+    uint8_t ddram[80];
+    uint8_t cgram[64];
+    uint8_t ac;
+    uint8_t _cgram_selected;
+    uint8_t _increment;
+    uint8_t _autoshift;
+    uint8_t display_on;
+    uint8_t cursor_on;
+    uint8_t blink_on;
+    uint8_t two_lines;
+    uint8_t shift;
+    
+    // timing
+    uint64_t _busy_until;
+    
+    // statistics
+    uint32_t instructions;
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t violations;
+    uint64_t busy_ns;
+    uint64_t first_transfer;
+    uint64_t last_transfer;
+    
+    HALhostDevice _device;
+    
+} HD44780sim;
+
+
+// ------------------------------------------------------------ //
+// creation
+//
+// data_port/data_bit: pins wired to DB0-DB7 (4-bit wiring uses
+// only DB4-DB7, the others are HD44780_SIM_NC)
+
+void HD44780simInit(HD44780sim * sim, uint8_t rows, uint8_t cols,
+                    uint8_t rs_port, uint8_t rs_bit,
+                    uint8_t en_port, uint8_t en_bit,
+                    const uint8_t * data_port, const uint8_t * data_bit);
+void HD44780simSetRW(HD44780sim * sim, uint8_t rw_port, uint8_t rw_bit);
+void HD44780simResetStatistics(HD44780sim * sim);
+
+
+// ------------------------------------------------------------ //
+// faults
+//
+// Corrupt changes a DDRAM cell (e.g. noise on the bus), PowerOn
+// puts the controller back into its power on state as after a
+// brown-out (8-bit interface, 1 line, display off, DDRAM cleared)
+
+void HD44780simCorrupt(HD44780sim * sim, uint8_t address, uint8_t value);
+void HD44780simPowerOn(HD44780sim * sim);
+
+
+// ------------------------------------------------------------ //
+// visible contents
+//
+// CharAt returns the character code at a visible position,
+// Render writes the rows separated by newlines (rows * (cols + 1)
+// bytes incl. terminator), custom characters are shown as '#'
+
+uint8_t HD44780simCharAt(HD44780sim * sim, uint8_t row, uint8_t col);
+void HD44780simRender(HD44780sim * sim, char * out);
+
+# endif
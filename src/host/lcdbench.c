@@ -0,0 +1,653 @@
+// -------------------------------------------------- //
+// display path benchmark
+//
+// drives lcd.c against the simulated HD44780 and checks
+// the visible contents after LCDinit, LCDprint and the
+// display shift, then measures how many full 16x2 frames
+// per second the driver can push (in virtual time)
+//
+// then text is printed across all rows of 16x2, 16x4, 20x4
+// and 40x2 panels, which has to wrap in the order of the rows
+// on the panel, not in the order of the DDRAM addresses
+//
+// with the rw pin wired, the screen is read back while cells
+// are corrupted and the controller is reset behind its back
+//
+// the same frame goes through a PCF8574 I2C backpack, streamed
+// by the TWI in the background, with the I2C bytes per character
+// and the time the cpu spent waiting for the queue, then full
+// redraws through SCREENupdate, which leaves the queue to drain
+// between the passes instead of waiting
+//
+// finally 1-4 panels share RS and the data lines (separate
+// enable pins) and get a full frame each, once panel after
+// panel and once interleaved through LCDbus
+//
+// prints one "key value" line per result, exits with 1 if
+// the contents are wrong or the timing is violated
+//
+// usage: lcdbench [frames]
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "../hal.h"
+# include "../lcd.h"
+# include "../screen.h"
+# include "../twi.h"
+# include "hd44780_sim.h"
+# include "pcf8574_sim.h"
+
+
+// -------------------------------------------------- //
+// compares the visible contents with the expected text
+
+static int expect(HD44780sim * sim, const char * name, const char * expected) {
+    
+    char screen[LCD_MAX_ROWS * 41];
+    
+    HD44780simRender(sim, screen);
+    
+    if (strcmp(screen, expected) != 0) {
+        
+        printf("%s_ok 0\n", name);
+        fprintf(stderr, "%s: expected\n%s\ngot\n%s\n", name, expected, screen);
+        return 1;
+        
+    }
+    
+    printf("%s_ok 1\n", name);
+    return 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// panels on a shared bus, the enable pins are PB2, PC0, PC1
+// and PC2
+
+# define BENCH_PANELS       4
+
+static const uint8_t panel_en_port[BENCH_PANELS] = {HAL_PORTB, HAL_PORTC, HAL_PORTC, HAL_PORTC};
+static const uint8_t panel_en_bit[BENCH_PANELS]  = {PB2, PC0, PC1, PC2};
+
+
+// -------------------------------------------------- //
+// writes a full frame to the panel (queued if it is on a bus)
+
+static void frame(LCD * lcd, int index) {
+    
+    char line[17];
+    
+    snprintf(line, sizeof(line), "PANEL %d 12:34:56", index);
+    LCDsetCursorPosition(lcd, 0, 0);
+    LCDprint(lcd, line);
+    LCDsetCursorPosition(lcd, 1, 0);
+    LCDprint(lcd, "MON 01.01.2024  ");
+    
+}
+
+
+// -------------------------------------------------- //
+// fills a panel of the given size with one LCDprint from the
+// first cell, then overwrites the last cell of every row and
+// the first cell of the next one, returns 1 if the panel shows
+// the wrong text or the timing was violated
+
+static int benchGeometry(const uint8_t * data_port, const uint8_t * data_bit, uint8_t rows, uint8_t cols) {
+    
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    HD44780sim sim;
+    LCD lcd;
+    char text[LCD_MAX_ROWS * 40 + 1];
+    char expected[LCD_MAX_ROWS * 41];
+    char name[32];
+    char * out = expected;
+    uint8_t cells = rows * cols;
+    uint32_t commands;
+    int failed = 0;
+    
+    HALhostReset();
+    hal_port_init(HAL_PORTD, (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6), 0);
+    hal_port_init(HAL_PORTB, (1 << PB1) | (1 << PB2), 0);
+    HD44780simInit(&sim, rows, cols, HAL_PORTB, PB1, HAL_PORTB, PB2, data_port, data_bit);
+    LCDconfig(&lcd, PB1, 0xFF, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
+    LCDinit(&lcd, 4, rows, cols, 0);
+    
+    for (uint8_t i = 0; i < cells; i++) {
+        
+        text[i] = alphabet[i % (sizeof(alphabet) - 1)];
+        
+    }
+    
+    text[cells] = '\0';
+    
+    // one pass over the whole panel
+    HD44780simResetStatistics(&sim);
+    LCDsetCursorPosition(&lcd, 0, 0);
+    LCDprint(&lcd, text);
+    commands = sim.instructions;
+    
+    // two characters around every row end (the last one wraps to the first cell)
+    for (uint8_t row = 0; row < rows; row++) {
+        
+        text[(row * cols + cols - 1) % cells] = '*';
+        text[(row * cols + cols) % cells]     = '+';
+        LCDsetCursorPosition(&lcd, row, cols - 1);
+        LCDprint(&lcd, "*+");
+        
+    }
+    
+    for (uint8_t row = 0; row < rows; row++) {
+        
+        memcpy(out, text + row * cols, cols);
+        out += cols;
+        *out++ = (row + 1 < rows) ? '\n' : '\0';
+        
+    }
+    
+    snprintf(name, sizeof(name), "wrap_%ux%u", cols, rows);
+    failed |= expect(&sim, name, expected);
+    failed |= (sim.violations != 0);
+    
+    // one address command per row that the controller does not continue by itself
+    printf("wrap_%ux%u_commands %u\n", cols, rows, commands);
+    
+    return failed;
+    
+}
+
+
+// -------------------------------------------------- //
+// fixed screen for the read-back
+
+static uint16_t scrubKey(const void * data) {
+    
+    return 0;
+    
+}
+
+static void scrubTop(char * buffer, const void * data) {
+    
+    strcpy(buffer, "12:34:56");
+    
+}
+
+static void scrubBottom(char * buffer, const void * data) {
+    
+    strcpy(buffer, "MON 01.01.2024");
+    
+}
+
+static const screenField scrub_fields[] PROGMEM = {
+    {0, 4, 8,  scrubKey, scrubTop},
+    {1, 1, 14, scrubKey, scrubBottom}
+};
+
+static const screenLayout scrub_layout PROGMEM = {scrub_fields, 2, 0};
+
+
+// -------------------------------------------------- //
+// one SCREENscrub call per cell group until the whole panel
+// was read, returns the number of cells written again (or
+// SCREEN_SCRUB_LOST)
+
+static unsigned scrubPass(Screen * screen, LCD * lcd, unsigned * calls) {
+    
+    unsigned repaired = 0;
+    uint8_t result;
+    
+    for (uint8_t row = 0; row < lcd->_rows; row++) {
+        
+        for (uint8_t col = 0; col < lcd->_cols; col += SCREEN_SCRUB_CELLS) {
+            
+            result = SCREENscrub(screen, lcd);
+            (*calls)++;
+            
+            if (result == SCREEN_SCRUB_LOST) {
+                
+                return SCREEN_SCRUB_LOST;
+                
+            }
+            
+            repaired += result;
+            
+        }
+        
+    }
+    
+    return repaired;
+    
+}
+
+
+// -------------------------------------------------- //
+// reads back a 16x2 screen, repairs corrupted cells and
+// initializes the LCD again after a lost controller state,
+// returns 1 if anything went wrong
+
+static int benchScrub(const uint8_t * data_port, const uint8_t * data_bit) {
+    
+    static const char * drawn = "    12:34:56    \n MON 01.01.2024 ";
+    HD44780sim sim;
+    LCD lcd;
+    Screen screen;
+    unsigned calls = 0;
+    unsigned clean;
+    unsigned repaired;
+    unsigned lost;
+    uint32_t violations;
+    int failed = 0;
+    
+    HALhostReset();
+    hal_port_init(HAL_PORTD, (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6), 0);
+    hal_port_init(HAL_PORTB, (1 << PB0) | (1 << PB1) | (1 << PB2), 0);
+    HD44780simInit(&sim, 2, 16, HAL_PORTB, PB1, HAL_PORTB, PB2, data_port, data_bit);
+    HD44780simSetRW(&sim, HAL_PORTB, PB0);
+    LCDconfig(&lcd, PB1, PB0, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
+    LCDinit(&lcd, 4, 2, 16, 0);
+    
+    SCREENinit(&screen);
+    SCREENshow(&screen, &scrub_layout);
+    SCREENupdate(&screen, &lcd, 0);
+    failed |= expect(&sim, "scrub_drawn", drawn);
+    
+    // nothing to repair
+    clean = scrubPass(&screen, &lcd, &calls);
+    
+    // noise on three cells, two of them next to each other
+    HD44780simCorrupt(&sim, 0x05, 'X');
+    HD44780simCorrupt(&sim, 0x06, 'Y');
+    HD44780simCorrupt(&sim, 0x4A, 0xFF);
+    repaired = scrubPass(&screen, &lcd, &calls);
+    failed |= expect(&sim, "scrub_repaired", drawn);
+    
+    // brown-out of the controller, noticed at the next read (what the
+    // controller does with the bytes until then does not count)
+    violations = sim.violations;
+    HD44780simPowerOn(&sim);
+    lost = SCREENscrub(&screen, &lcd);
+    calls++;
+    
+    if (lost == SCREEN_SCRUB_LOST) {
+        
+        HD44780simResetStatistics(&sim);
+        LCDinit(&lcd, 4, 2, 16, 0);
+        SCREENinvalidate(&screen);
+        SCREENupdate(&screen, &lcd, 0);
+        
+    }
+    
+    failed |= expect(&sim, "scrub_restored", drawn);
+    violations += sim.violations;
+    failed |= (clean != 0 || repaired != 3 || lost != SCREEN_SCRUB_LOST || violations != 0);
+    
+    printf("scrub_clean_repairs %u\n", clean);
+    printf("scrub_repairs %u\n", repaired);
+    printf("scrub_lost %u\n", lost == SCREEN_SCRUB_LOST);
+    printf("scrub_reads %lu\n", (unsigned long) screen.scrub_reads);
+    printf("scrub_us_per_call %.1f\n", (double) screen.scrub_us / calls);
+    printf("scrub_violations %u\n", violations);
+    
+    return failed;
+    
+}
+
+
+// -------------------------------------------------- //
+// screen whose every cell changes from frame to frame (data
+// = frame number), redrawn once per pass of a main loop that
+// takes BENCH_LOOP_US besides it
+
+# define BENCH_LOOP_US      100
+
+static uint16_t flipKey(const void * data) {
+    
+    return *(const int *) data;
+    
+}
+
+static void flipFormat(char * buffer, const void * data) {
+    
+    memset(buffer, 'A' + *(const int *) data % 26, 16);
+    buffer[16] = '\0';
+    
+}
+
+static const screenField flip_fields[] PROGMEM = {
+    {0, 0, 16, flipKey, flipFormat},
+    {1, 0, 16, flipKey, flipFormat}
+};
+
+static const screenLayout flip_layout PROGMEM = {flip_fields, 2, 0};
+
+
+// -------------------------------------------------- //
+// full frames through the I2C backpack, returns 1 if the
+// panel shows the wrong text or the timing was violated
+
+static int benchI2C(int frames) {
+    
+    static const uint8_t data_port[8] = {
+        HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC,
+        HAL_HOST_PORTX, HAL_HOST_PORTX, HAL_HOST_PORTX, HAL_HOST_PORTX
+    };
+    static const uint8_t data_bit[8] = {0, 0, 0, 0, 4, 5, 6, 7};
+    HD44780sim sim;
+    PCF8574sim backpack;
+    LCD lcd;
+    Screen screen;
+    const twiStats * stats;
+    char flip[16];
+    char expected[40];
+    int index = 0;
+    uint16_t waits;
+    uint32_t passes;
+    uint64_t start;
+    uint64_t cpu;
+    uint64_t begin;
+    uint32_t bytes;
+    uint32_t transfers;
+    double frame_us;
+    int failed = 0;
+    
+    HALhostReset();
+    TWIinit();
+    HD44780simInit(&sim, 2, 16, HAL_HOST_PORTX, LCD_I2C_RS, HAL_HOST_PORTX, LCD_I2C_EN, data_port, data_bit);
+    HD44780simSetRW(&sim, HAL_HOST_PORTX, LCD_I2C_RW);
+    PCF8574simInit(&backpack, LCD_I2C_ADDRESS);
+    
+    LCDconfigI2C(&lcd, LCD_I2C_ADDRESS);
+    LCDinit(&lcd, 4, 2, 16, 0);
+    TWIflush();
+    
+    printf("i2c_init_ns %llu\n", (unsigned long long) HALhostTime());
+    failed |= expect(&sim, "i2c_init", "                \n                ");
+    
+    stats     = TWIstats();
+    bytes     = stats->bytes;
+    transfers = stats->transfers;
+    HD44780simResetStatistics(&sim);
+    start = HALhostTime();
+    
+    for (int i = 0; i < frames; i++) {
+        
+        frame(&lcd, 0);
+        
+    }
+    
+    TWIflush();
+    frame_us = (double) (HALhostTime() - start) / frames / 1000;
+    bytes     = stats->bytes - bytes;
+    transfers = stats->transfers - transfers;
+    
+    failed |= expect(&sim, "i2c_frame", "PANEL 0 12:34:56\nMON 01.01.2024  ");
+    failed |= (sim.violations != 0 || stats->errors != 0);
+    
+    // characters and commands both cost a byte on the panel
+    printf("i2c_frame_us %.1f\n", frame_us);
+    printf("i2c_fps %.1f\n", 1e6 / frame_us);
+    printf("i2c_bytes_per_frame %.1f\n", (double) (bytes + transfers) / frames);
+    printf("i2c_bytes_per_char %.2f\n", (double) (bytes + transfers) / (sim.writes + sim.instructions));
+    printf("i2c_transfers_per_frame %.2f\n", (double) transfers / frames);
+    printf("i2c_queue_waits_per_frame %.1f\n", (double) stats->waits / frames);
+    
+    // the cpu only waits while the queue is full, a whole frame does not fit
+    begin = HALhostTime();
+    frame(&lcd, 1);
+    cpu = HALhostTime() - begin;
+    TWIflush();
+    printf("i2c_cpu_us_single_frame %.1f\n", (double) cpu / 1000);
+    
+    // a new time (cursor and 8 characters) does
+    begin = HALhostTime();
+    LCDsetCursorPosition(&lcd, 0, 8);
+    LCDprint(&lcd, "12:34:57");
+    cpu = HALhostTime() - begin;
+    TWIflush();
+    printf("i2c_cpu_us_time_update %.1f\n", (double) cpu / 1000);
+    
+    failed |= expect(&sim, "i2c_update", "PANEL 1 12:34:57\nMON 01.01.2024  ");
+    
+    // full redraws through SCREENupdate, which stops while the queue is
+    // full, with the rest of a main loop pass between the calls
+    SCREENinit(&screen);
+    SCREENshow(&screen, &flip_layout);
+    SCREENupdate(&screen, &lcd, &index);
+    TWIflush();
+    
+    waits = stats->waits;
+    bytes = stats->bytes;
+    passes = 0;
+    start = HALhostTime();
+    
+    for (index = 1; index <= frames; index++) {
+        
+        do {
+            
+            SCREENupdate(&screen, &lcd, &index);
+            passes++;
+            hal_delay_us(BENCH_LOOP_US);
+            
+        } while (screen._valid != 3);
+        
+    }
+    
+    TWIflush();
+    frame_us = (double) (HALhostTime() - start) / frames / 1000;
+    bytes    = stats->bytes - bytes;
+    
+    memset(flip, 'A' + frames % 26, 16);
+    snprintf(expected, sizeof(expected), "%.16s\n%.16s", flip, flip);
+    failed |= expect(&sim, "i2c_screen", expected);
+    failed |= (stats->waits != waits);
+    
+    printf("i2c_screen_frame_us %.1f\n", frame_us);
+    printf("i2c_screen_bytes_per_frame %.1f\n", (double) bytes / frames);
+    printf("i2c_screen_passes_per_frame %.1f\n", (double) passes / frames);
+    printf("i2c_screen_queue_waits %u\n", stats->waits - waits);
+    
+    failed |= (sim.violations != 0);
+    printf("i2c_violations %u\n", sim.violations);
+    
+    return failed;
+    
+}
+
+
+// -------------------------------------------------- //
+// time of one frame on each of n panels, sequential or
+// interleaved, returns 1 if a panel shows the wrong text
+// or the timing was violated
+
+static int benchBus(const uint8_t * data_port, const uint8_t * data_bit, int n, int frames) {
+    
+    HD44780sim sims[BENCH_PANELS];
+    LCD lcds[BENCH_PANELS];
+    LCDbus bus;
+    char expected[2 * 17];
+    char name[32];
+    uint64_t start;
+    double sequential_us;
+    double interleaved_us;
+    int failed = 0;
+    
+    HALhostReset();
+    hal_port_init(HAL_PORTD, (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6), 0);
+    hal_port_init(HAL_PORTB, (1 << PB1) | (1 << PB2), 0);
+    hal_port_init(HAL_PORTC, (1 << PC0) | (1 << PC1) | (1 << PC2), 0);
+    LCDbusInit(&bus);
+    
+    for (int i = 0; i < n; i++) {
+        
+        HD44780simInit(&sims[i], 2, 16, HAL_PORTB, PB1, panel_en_port[i], panel_en_bit[i], data_port, data_bit);
+        LCDconfig(&lcds[i], PB1, 0xFF, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
+        LCDsetEnablePin(&lcds[i], panel_en_port[i], panel_en_bit[i]);
+        LCDinit(&lcds[i], 4, 2, 16, 0);
+        
+    }
+    
+    // one panel after the other, every byte waits for the busy window
+    start = HALhostTime();
+    
+    for (int f = 0; f < frames; f++) {
+        
+        for (int i = 0; i < n; i++) {
+            
+            frame(&lcds[i], i);
+            
+        }
+        
+    }
+    
+    sequential_us = (double) (HALhostTime() - start) / frames / 1000;
+    
+    // interleaved, the bytes of the other panels fill the busy windows
+    for (int i = 0; i < n; i++) {
+        
+        LCDbusAttach(&bus, &lcds[i]);
+        
+    }
+    
+    start = HALhostTime();
+    
+    for (int f = 0; f < frames; f++) {
+        
+        for (int i = 0; i < n; i++) {
+            
+            frame(&lcds[i], i);
+            
+        }
+        
+        LCDbusFlush(&bus);
+        
+    }
+    
+    interleaved_us = (double) (HALhostTime() - start) / frames / 1000;
+    
+    for (int i = 0; i < n; i++) {
+        
+        snprintf(expected, sizeof(expected), "PANEL %d 12:34:56\nMON 01.01.2024  ", i);
+        snprintf(name, sizeof(name), "bus%d_panel%d", n, i);
+        failed |= expect(&sims[i], name, expected);
+        failed |= (sims[i].violations != 0);
+        
+    }
+    
+    printf("bus%d_sequential_us %.1f\n", n, sequential_us);
+    printf("bus%d_interleaved_us %.1f\n", n, interleaved_us);
+    
+    return failed;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    static const uint8_t data_port[8] = {
+        HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC,
+        HAL_PORTD, HAL_PORTD, HAL_PORTD, HAL_PORTD
+    };
+    static const uint8_t data_bit[8] = {0, 0, 0, 0, PD3, PD4, PD5, PD6};
+    const char * text = "this is some auto-scrolling text!";
+    char expected[2 * 17];
+    int frames = (argc > 1) ? atoi(argv[1]) : 1000;
+    int failed = 0;
+    HD44780sim sim;
+    LCD lcd;
+    uint64_t start;
+    double frame_ns;
+    
+    HALhostReset();
+    HD44780simInit(&sim, 2, 16, HAL_PORTB, PB1, HAL_PORTB, PB2, data_port, data_bit);
+    hal_port_init(HAL_PORTD, (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6), 0);
+    hal_port_init(HAL_PORTB, (1 << PB1) | (1 << PB2), 0);
+    
+    // initialization (wiring as on the board)
+    LCDconfig(&lcd, PB1, 0xFF, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
+    LCDinit(&lcd, 4, 2, 16, 0);
+    
+    printf("init_ns %llu\n", (unsigned long long) HALhostTime());
+    failed |= expect(&sim, "init", "                \n                ");
+    failed |= (sim.two_lines != 1 || sim.display_on != 1);
+    
+    // print both lines
+    LCDreturnHome(&lcd);
+    LCDprint(&lcd, "12:34:56        ");
+    LCDsetCursorPosition(&lcd, 1, 0);
+    LCDprint(&lcd, "MON 01.01.2024  ");
+    failed |= expect(&sim, "print", "12:34:56        \nMON 01.01.2024  ");
+    
+    // display shift over a line longer than the visible area
+    LCDclearDisplay(&lcd);
+    LCDwrapOff(&lcd);
+    LCDprint(&lcd, (char *) text);
+    LCDwrapOn(&lcd);
+    
+    for (int i = 0; i < 5; i++) {
+        
+        LCDshiftDisplayLeft(&lcd);
+        
+    }
+    
+    snprintf(expected, sizeof(expected), "%.16s\n                ", text + 5);
+    failed |= expect(&sim, "shift", expected);
+    
+    LCDshiftDisplayRight(&lcd);
+    snprintf(expected, sizeof(expected), "%.16s\n                ", text + 4);
+    failed |= expect(&sim, "shift_right", expected);
+    
+    // full frame throughput, as in the clock loop
+    LCDclearDisplay(&lcd);
+    HD44780simResetStatistics(&sim);
+    start = HALhostTime();
+    
+    for (int i = 0; i < frames; i++) {
+        
+        LCDreturnHome(&lcd);
+        LCDprint(&lcd, "12:34:56        ");
+        LCDsetCursorPosition(&lcd, 1, 0);
+        LCDprint(&lcd, "MON 01.01.2024  ");
+        
+    }
+    
+    frame_ns = (double) (HALhostTime() - start) / frames;
+    failed |= expect(&sim, "frame", "12:34:56        \nMON 01.01.2024  ");
+    
+    printf("frames %d\n", frames);
+    printf("frame_us %.1f\n", frame_ns / 1000);
+    printf("fps %.1f\n", 1e9 / frame_ns);
+    printf("bus_busy_us_per_frame %.1f\n", (double) sim.busy_ns / frames / 1000);
+    printf("instructions_per_frame %.1f\n", (double) sim.instructions / frames);
+    printf("writes_per_frame %.1f\n", (double) sim.writes / frames);
+    printf("violations %u\n", sim.violations);
+    
+    failed |= (sim.violations != 0);
+    
+    // text across the rows of other geometries
+    failed |= benchGeometry(data_port, data_bit, 2, 16);
+    failed |= benchGeometry(data_port, data_bit, 4, 16);
+    failed |= benchGeometry(data_port, data_bit, 4, 20);
+    failed |= benchGeometry(data_port, data_bit, 2, 40);
+    
+    // read-back of the screen
+    failed |= benchScrub(data_port, data_bit);
+    
+    // the same frame through the I2C backpack
+    failed |= benchI2C(frames < 100 ? frames : 100);
+    
+    // several panels on one bus
+    for (int n = 1; n <= BENCH_PANELS; n++) {
+        
+        failed |= benchBus(data_port, data_bit, n, 10);
+        
+    }
+    
+    return failed;
+    
+}
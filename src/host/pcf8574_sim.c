@@ -0,0 +1,37 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+# include "pcf8574_sim.h"
+
+
+// -------------------------------------------------- //
+// called by the TWI for every byte of a write transfer
+
+static void PCF8574simReceive(void * ctx, uint64_t time, uint8_t value) {
+    
+    PCF8574sim * sim = ctx;
+    
+    sim->output = value;
+    sim->writes++;
+    
+    HALhostSetPort(time, HAL_HOST_PORTX, 0xFF, value);
+    
+}
+
+
+// -------------------------------------------------- //
+// creates the expander in its power on state
+
+void PCF8574simInit(PCF8574sim * sim, uint8_t address) {
+    
+    sim->address = address;
+    sim->output  = 0xFF;
+    sim->writes  = 0;
+    
+    HALhostSetPort(HALhostTime(), HAL_HOST_PORTX, 0xFF, 0xFF);
+    TWIhostAttach(address, PCF8574simReceive, sim);
+    
+}
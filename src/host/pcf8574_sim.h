@@ -0,0 +1,38 @@
+# ifndef PCF8574_SIM_H
+# define PCF8574_SIM_H
+
+// ------------------------------------------------------------ //
+// simulated PCF8574 I/O expander on the host
+//
+// every byte written to the slave address appears on P0-P7 at
+// the time its transfer ended, the pins are the port
+// HAL_HOST_PORTX of the hal, so e.g. a simulated HD44780 can be
+// wired to them (as on the common LCD backpack)
+
+# include <stdint.h>
+
+# include "hal_host.h"
+
+
+// ------------------------------------------------------------ //
+// struct for storing the state of the simulated expander
+
+typedef struct PCF8574sim {
+    
+    uint8_t address;
+    
+    // level of P0-P7 (all high after power on)
+    uint8_t output;
+    
+    // bytes received
+    uint32_t writes;
+    
+} PCF8574sim;
+
+
+// ------------------------------------------------------------ //
+// creation (attaches the expander to the TWI of the host)
+
+void PCF8574simInit(PCF8574sim * sim, uint8_t address);
+
+# endif
@@ -0,0 +1,263 @@
+// -------------------------------------------------- //
+// gpio trace record/replay harness for the bit-banged
+// protocols of ds1302.c and dht11.c
+//
+// record: runs the driver against the simulated device and
+//         writes the gpio trace incl. the golden decoding
+// play:   feeds the device side of a capture (recorded or from
+//         a logic analyzer) back into the driver, checks every
+//         decoding against the golden result and reports the
+//         decode throughput
+//
+// usage: replay record dht11|ds1302 <file>
+//        replay play dht11|ds1302 <file> [iterations]
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <string.h>
+# include <setjmp.h>
+# include <time.h>
+
+# include "../hal.h"
+# include "../ds1302.h"
+# include "../dht11.h"
+# include "ds1302_sim.h"
+# include "dht11_sim.h"
+# include "trace.h"
+
+
+// -------------------------------------------------- //
+// virtual time one decoding may take before it counts as
+// hanging (capture exhausted or broken)
+
+# define DECODE_TIMEOUT_NS   100000000ULL
+
+
+// -------------------------------------------------- //
+// escape from a hanging driver
+
+static jmp_buf timeout;
+
+static void expired(void) {
+    
+    longjmp(timeout, 1);
+    
+}
+
+
+// -------------------------------------------------- //
+// pins as on the board
+
+static void setupPins(void) {
+    
+    hal_port_init(HAL_PORTD, (1 << PD7), 0);
+    hal_port_init(HAL_PORTB, (1 << PB0) | (1 << PB4) | (1 << PB5), 0);
+    
+}
+
+
+// -------------------------------------------------- //
+// runs one decoding and formats the result like the
+// expect line, returns 0 on timeout
+
+static int decode(int is_dht, DHT11 * dht11, DS1302 * ds1302, char * result, size_t size) {
+    
+    DHT11Data humi_temp;
+    timeData time;
+    
+    HALhostSetDeadline(HALhostTime() + DECODE_TIMEOUT_NS, expired);
+    
+    if (setjmp(timeout) != 0) {
+        
+        HALhostSetDeadline(UINT64_MAX, NULL);
+        return 0;
+        
+    }
+    
+    if (is_dht) {
+        
+        DHT11readData(dht11, &humi_temp);
+        snprintf(result, size, "%u %u %u %u %u", humi_temp.humi_integral, humi_temp.humi_decimal,
+                 humi_temp.temp_integral, humi_temp.temp_decimal, humi_temp.checksum);
+        
+    } else {
+        
+        DS1302readTimeData(ds1302, &time);
+        snprintf(result, size, "%02x %02x %02x %02x %02x %02x %02x", time.second, time.minute,
+                 time.hour, time.day, time.month, time.dayofweek, time.year);
+        
+    }
+    
+    HALhostSetDeadline(UINT64_MAX, NULL);
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// records a capture from the simulated device
+
+static int record(int is_dht, const char * path) {
+    
+    FILE * file = fopen(path, "w");
+    DHT11sim dht_sim;
+    DS1302sim rtc_sim;
+    DHT11 dht11;
+    DS1302 ds1302;
+    char result[64];
+    
+    if (file == NULL) {
+        
+        perror(path);
+        return 1;
+        
+    }
+    
+    HALhostReset();
+    setupPins();
+    
+    if (is_dht) {
+        
+        DHT11simInit(&dht_sim, HAL_PORTB, PB0);
+        dht_sim.humi_integral = 38;
+        dht_sim.temp_integral = 23;
+        dht_sim.temp_decimal  = 7;
+        DHT11init(&dht11, HAL_PORTB, PB0);
+        
+    } else {
+        
+        DS1302simInit(&rtc_sim, HAL_PORTB, PB4, HAL_PORTD, PD7, HAL_PORTB, PB5);
+        DS1302simSetTime(&rtc_sim, 24, 12, 31, 23, 59, 58);
+        DS1302init(&ds1302, PB4, PD7, PB5);
+        
+    }
+    
+    fprintf(file, "# gpio trace of one %s transfer (time_ns port mask value)\n", is_dht ? "DHT11" : "DS1302");
+    TRACErecord(file);
+    
+    if (!decode(is_dht, &dht11, &ds1302, result, sizeof(result))) {
+        
+        fprintf(stderr, "recording timed out\n");
+        return 1;
+        
+    }
+    
+    TRACErecord(NULL);
+    fprintf(file, "# expect %s\n", result);
+    fclose(file);
+    
+    printf("recorded %s\n", result);
+    
+    return 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// replays a capture into the driver
+
+static int play(int is_dht, const char * path, int iterations) {
+    
+    trace t;
+    TRACEreplay replay;
+    DHT11 dht11;
+    DS1302 ds1302;
+    char result[64];
+    int errors = 0;
+    clock_t start;
+    uint64_t virtual_start;
+    double wall;
+    
+    if (TRACEload(&t, path) != 0 || t.count == 0) {
+        
+        fprintf(stderr, "%s: no trace\n", path);
+        return 1;
+        
+    }
+    
+    HALhostReset();
+    setupPins();
+    
+    if (is_dht) {
+        
+        // the start signal release aligns the capture
+        TRACEreplayInit(&replay, &t, HAL_PORTB, PB0, 1, 18000000ULL, HAL_PORTB, PB0);
+        DHT11init(&dht11, HAL_PORTB, PB0);
+        
+    } else {
+        
+        // every falling clock edge aligns the capture
+        TRACEreplayInit(&replay, &t, HAL_PORTB, PB5, 0, 0, HAL_PORTD, PD7);
+        DS1302init(&ds1302, PB4, PD7, PB5);
+        
+    }
+    
+    start = clock();
+    virtual_start = HALhostTime();
+    
+    for (int i = 0; i < iterations; i++) {
+        
+        TRACEreplayRewind(&replay);
+        
+        if (!decode(is_dht, &dht11, &ds1302, result, sizeof(result))) {
+            
+            strcpy(result, "timeout");
+            
+        }
+        
+        if (t.expect[0] != '\0' && strcmp(result, t.expect) != 0) {
+            
+            if (errors++ == 0) {
+                
+                fprintf(stderr, "decoded \"%s\", expected \"%s\"\n", result, t.expect);
+                
+            }
+            
+        }
+        
+    }
+    
+    wall = (double) (clock() - start) / CLOCKS_PER_SEC;
+    
+    printf("events %u\n", t.count);
+    printf("decoded %s\n", result);
+    printf("expected %s\n", t.expect[0] ? t.expect : "-");
+    printf("iterations %d\n", iterations);
+    printf("errors %d\n", errors);
+    printf("virtual_us_per_decode %.1f\n", (double) (HALhostTime() - virtual_start) / iterations / 1000);
+    printf("decodes_per_s %.0f\n", wall > 0 ? iterations / wall : 0);
+    
+    TRACEfree(&t);
+    
+    return errors != 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    int is_dht;
+    
+    if (argc < 4 || (strcmp(argv[2], "dht11") != 0 && strcmp(argv[2], "ds1302") != 0)) {
+        
+        fprintf(stderr, "usage: %s record|play dht11|ds1302 <file> [iterations]\n", argv[0]);
+        return 1;
+        
+    }
+    
+    is_dht = (strcmp(argv[2], "dht11") == 0);
+    
+    if (strcmp(argv[1], "record") == 0) {
+        
+        return record(is_dht, argv[3]);
+        
+    }
+    
+    return play(is_dht, argv[3], (argc > 4) ? atoi(argv[4]) : 1000);
+    
+}
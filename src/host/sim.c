@@ -0,0 +1,406 @@
+// -------------------------------------------------- //
+// host-native build of the firmware
+//
+// runs the unmodified main() of the firmware against the
+// simulated peripherals for a given amount of virtual time
+//
+// usage: clock_host [-s seconds] [-b button_interval_ms] [-p button_press_ms]
+//                   [-t telemetry_file] [-e eeprom_file] [-c commands]
+//                   [-r reference_offset_s] [-y sync_interval_s] [-d rtc_drift_ppm]
+//
+// the EEPROM image is loaded from and saved to eeprom_file, so
+// the settings survive between runs
+//
+// commands are typed into the serial console one byte per ms,
+// ';' separates the lines (e.g. -c "alarm 1 daily 12:01;alarm")
+//
+// sync requests of the clock (see timesync.h) are answered by a
+// stand-in of the daemon, its reference clock is reference_offset_s
+// ahead of the simulated RTC, both directions take the USB latency
+// plus the bytes at the baud rate ("sync;" starts a synchronization,
+// rtc_error_ms is the difference that is left at the end), with -y
+// the stand-in starts one every sync_interval_s like the daemon
+//
+// the button (PD2) is held down for button_press_ms (100 ms by
+// default), both edges raise INT0
+//
+// -d lets the crystal of the RTC run fast (or slow if negative)
+//
+// the boot timeline (see boot.h) is printed with the statistics
+//
+// built with LCD_I2C (make host LCDI2C=1) the display sits on a
+// PCF8574 backpack at LCD_I2C_ADDRESS instead of the parallel pins
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <setjmp.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "../hal.h"
+# include "ds1302_sim.h"
+# include "dht11_sim.h"
+# include "hd44780_sim.h"
+# include "pcf8574_sim.h"
+# include "sync_host.h"
+# include "../lcd.h"
+# include "../boot.h"
+# include "../uart.h"
+
+
+// -------------------------------------------------- //
+// firmware entry point and interrupt handlers
+// (main.c is built with -Dmain=firmwareMain)
+
+int firmwareMain(void);
+void INT0_vect(void);
+
+
+// -------------------------------------------------- //
+// serial link to the daemon stand-in (ns)
+
+# define SIM_UART_BYTE_NS    (10 * 1000000000ULL / UART_BAUD)
+# define SIM_USB_LATENCY_NS  1000000ULL
+
+// start of the simulated RTC (2024-01-01 12:00:00, ns since 2000)
+# define SIM_RTC_START_NS    ((8766ULL * 86400 + 12 * 3600) * 1000000000ULL)
+
+
+// -------------------------------------------------- //
+// state of the simulation
+
+static jmp_buf sim_exit;
+static uint64_t button_interval = 0;
+static uint64_t next_press = 0;
+static uint32_t button_presses = 0;
+static uint64_t button_press = 100000000ULL;
+static uint8_t button_down = 0;
+static FILE * telemetry = NULL;
+static uint32_t uart_bytes = 0;
+static const char * console_input = NULL;
+static uint64_t next_input = 0;
+static SyncHost sync_host;
+static int64_t reference_offset = 0;
+static char sync_answer[40];
+static const char * sync_next = NULL;
+static uint64_t sync_next_at = 0;
+static uint64_t sync_interval = 0;
+static uint64_t sync_start = 0;
+
+
+// -------------------------------------------------- //
+// hooks called by the hal
+
+static void expired(void) {
+    
+    longjmp(sim_exit, 1);
+    
+}
+
+static void tick(uint64_t time) {
+    
+    if (button_interval != 0 && !button_down && time >= next_press) {
+        
+        button_down = 1;
+        button_presses++;
+        INT0_vect();
+        
+    }
+    
+    if (button_down && time >= next_press + button_press) {
+        
+        button_down = 0;
+        next_press += button_interval;
+        INT0_vect();
+        
+    }
+    
+    // the receive buffer may be full, then the byte is sent again
+    if (console_input && *console_input && time >= next_input) {
+        
+        next_input = time + 1000000;
+        
+        if (UARThostReceive(*console_input == ';' ? '\n' : *console_input)) {
+            
+            console_input++;
+            
+        }
+        
+    }
+    
+    // the daemon stand-in starts a synchronization
+    if (sync_interval != 0 && time >= sync_start && (!sync_next || !*sync_next)) {
+        
+        sync_start  += sync_interval;
+        sync_next    = "sync\n";
+        sync_next_at = time + SIM_USB_LATENCY_NS;
+        
+    }
+    
+    // answer of the daemon stand-in, one byte per byte time
+    if (sync_next && *sync_next && time >= sync_next_at) {
+        
+        if (UARThostReceive(*sync_next)) {
+            
+            sync_next++;
+            
+        }
+        
+        sync_next_at += SIM_UART_BYTE_NS;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// the button pulls PD2 low while it is down
+
+static int buttonDrive(void * ctx, uint64_t time, uint8_t port, uint8_t bit) {
+    
+    return (port == HAL_PORTD && bit == PD2 && button_down) ? 0 : -1;
+    
+}
+
+
+// -------------------------------------------------- //
+// time of the reference clock at a simulation time (ns since 2000)
+
+static uint64_t referenceTime(uint64_t time) {
+    
+    return SIM_RTC_START_NS + reference_offset + time;
+    
+}
+
+static void uartSink(uint8_t c) {
+    
+    uint64_t arrival;
+    
+    uart_bytes++;
+    
+    // the request arrives after its bytes and the latency, the answer leaves at once
+    if (SYNChostFeed(&sync_host, c)) {
+        
+        arrival = HALhostTime() + (TEL_PAYLOAD_SYNC + TEL_OVERHEAD + 2) * SIM_UART_BYTE_NS + SIM_USB_LATENCY_NS;
+        SYNChostAnswer(&sync_host, sync_answer, sizeof(sync_answer), referenceTime(arrival) / 1000000,
+                       referenceTime(arrival) / 1000000);
+        sync_next    = sync_answer;
+        sync_next_at = arrival + SIM_USB_LATENCY_NS;
+        
+    }
+    
+    if (telemetry) {
+        
+        fputc(c, telemetry);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    static HALhostDevice button = {NULL, NULL, buttonDrive, NULL, 0};
+    DS1302sim rtc;
+    DHT11sim dht;
+    DHT11sim outdoor;
+    HD44780sim lcd;
+# ifdef LCD_I2C
+    static const uint8_t backpack_data_port[8] = {
+        HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC,
+        HAL_HOST_PORTX, HAL_HOST_PORTX, HAL_HOST_PORTX, HAL_HOST_PORTX
+    };
+    static const uint8_t backpack_data_bit[8] = {0, 0, 0, 0, 4, 5, 6, 7};
+    PCF8574sim backpack;
+# else
+    static const uint8_t lcd_data_port[8] = {
+        HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC, HD44780_SIM_NC,
+        HAL_PORTD, HAL_PORTD, HAL_PORTD, HAL_PORTD
+    };
+    static const uint8_t lcd_data_bit[8] = {0, 0, 0, 0, PD3, PD4, PD5, PD6};
+# endif
+    char screen[2 * 17];
+    double seconds = 10;
+    double drift = 0;
+    clock_t start;
+    double wall;
+    const char * eeprom_path = NULL;
+    FILE * eeprom;
+    uint32_t eeprom_max_writes = 0;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "s:b:p:t:e:c:r:y:d:")) != -1) {
+        
+        switch (opt) {
+            
+            case 's':
+                
+                seconds = atof(optarg);
+                break;
+            
+            case 'b':
+                
+                button_interval = (uint64_t) (atof(optarg) * 1e6);
+                next_press = button_interval;
+                break;
+            
+            case 'p':
+                
+                button_press = (uint64_t) (atof(optarg) * 1e6);
+                break;
+            
+            case 't':
+                
+                if ((telemetry = fopen(optarg, "wb")) == NULL) {
+                    
+                    perror(optarg);
+                    return 1;
+                    
+                }
+                
+                break;
+            
+            case 'e':
+                
+                eeprom_path = optarg;
+                break;
+            
+            case 'c':
+                
+                console_input = optarg;
+                break;
+            
+            case 'r':
+                
+                reference_offset = (int64_t) (atof(optarg) * 1e9);
+                break;
+            
+            case 'y':
+                
+                sync_interval = (uint64_t) (atof(optarg) * 1e9);
+                sync_start    = sync_interval;
+                break;
+            
+            case 'd':
+                
+                drift = atof(optarg);
+                break;
+            
+            default:
+                
+                fprintf(stderr, "usage: %s [-s seconds] [-b button_interval_ms] [-p button_press_ms] [-t telemetry_file] [-e eeprom_file] [-c commands] [-r reference_offset_s] [-y sync_interval_s] [-d rtc_drift_ppm]\n", argv[0]);
+                return 1;
+            
+        }
+        
+    }
+    
+    // peripherals wired like on the board
+    HALhostReset();
+    HALhostEepromErase();
+    
+    if (eeprom_path && (eeprom = fopen(eeprom_path, "rb")) != NULL) {
+        
+        if (fread(HALhostEeprom, 1, HAL_HOST_EEPROM_SIZE, eeprom) != HAL_HOST_EEPROM_SIZE) {
+            
+            HALhostEepromErase();
+            
+        }
+        
+        fclose(eeprom);
+        
+    }
+    
+    DS1302simInit(&rtc, HAL_PORTB, PB4, HAL_PORTD, PD7, HAL_PORTB, PB5);
+    DS1302simSetTime(&rtc, 24, 1, 1, 12, 0, 0);
+    DS1302simSetDrift(&rtc, (int32_t) (drift * 1000));
+    DHT11simInit(&dht, HAL_PORTB, PB0);
+    DHT11simInit(&outdoor, HAL_PORTC, PC0);
+    outdoor.humi_integral = 80;
+    outdoor.temp_integral = 7;
+    outdoor.temp_decimal  = 0;
+# ifdef LCD_I2C
+    HD44780simInit(&lcd, 2, 16, HAL_HOST_PORTX, LCD_I2C_RS, HAL_HOST_PORTX, LCD_I2C_EN, backpack_data_port, backpack_data_bit);
+    HD44780simSetRW(&lcd, HAL_HOST_PORTX, LCD_I2C_RW);
+    PCF8574simInit(&backpack, LCD_I2C_ADDRESS);
+# else
+    HD44780simInit(&lcd, 2, 16, HAL_PORTB, PB1, HAL_PORTB, PB2, lcd_data_port, lcd_data_bit);
+# endif
+    HALhostAttach(&button);
+    UARThostSetSink(uartSink);
+    SYNChostInit(&sync_host);
+    
+    HALhostSetTickHook(tick);
+    HALhostSetDeadline((uint64_t) (seconds * 1e9), expired);
+    
+    start = clock();
+    
+    if (setjmp(sim_exit) == 0) {
+        
+        firmwareMain();
+        
+    }
+    
+    wall = (double) (clock() - start) / CLOCKS_PER_SEC;
+    
+    printf("simulated_s %.3f\n", HALhostTime() / 1e9);
+    printf("wall_s %.3f\n", wall);
+    printf("button_presses %u\n", button_presses);
+    printf("rtc_commands %u\n", rtc.commands);
+    printf("rtc_bytes_read %u\n", rtc.bytes_read);
+    printf("dht_frames %u\n", dht.frames);
+    printf("dht_outdoor_frames %u\n", outdoor.frames);
+    printf("uart_bytes %u\n", uart_bytes);
+    printf("sync_requests %u\n", sync_host.requests);
+    printf("rtc_error_ms %.3f\n", ((int64_t) DS1302simTime(&rtc) - (int64_t) referenceTime(HALhostTime())) / 1e6);
+    printf("lcd_instructions %u\n", lcd.instructions);
+    printf("lcd_writes %u\n", lcd.writes);
+    printf("lcd_busy_ms %.3f\n", lcd.busy_ns / 1e6);
+    printf("lcd_violations %u\n", lcd.violations);
+    
+    // boot timeline of the firmware (phases not reached are left out)
+    for (int i = 0; i < BOOT_PHASES; i++) {
+        
+        if (BOOTreached(i)) {
+            
+            printf("boot_%s_us %lu\n", BOOTname(i), (unsigned long) BOOTtime(i));
+            
+        }
+        
+    }
+    
+    for (int i = 0; i < HAL_HOST_EEPROM_SIZE; i++) {
+        
+        if (HALhostEepromWrites[i] > eeprom_max_writes) {
+            
+            eeprom_max_writes = HALhostEepromWrites[i];
+            
+        }
+        
+    }
+    
+    printf("eeprom_max_cell_writes %u\n", eeprom_max_writes);
+    
+    if (eeprom_path && (eeprom = fopen(eeprom_path, "wb")) != NULL) {
+        
+        fwrite(HALhostEeprom, 1, HAL_HOST_EEPROM_SIZE, eeprom);
+        fclose(eeprom);
+        
+    }
+    
+    HD44780simRender(&lcd, screen);
+    printf("%s\n", screen);
+    
+    if (telemetry) {
+        
+        fclose(telemetry);
+        
+    }
+    
+    return 0;
+    
+}
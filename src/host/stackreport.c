@@ -0,0 +1,491 @@
+// -------------------------------------------------- //
+// worst-case stack depth of the firmware per call path
+//
+// the frames come from the .su files of -fstack-usage, the
+// calls from the disassembly of the image (avr-objdump -d),
+// every call adds the frame of the callee and its return
+// address:
+//
+//   depth(f) = frame(f) + return address + max depth(callee)
+//
+// the deepest interrupt is added to main (interrupts do not
+// nest), indirect calls (icall, function pointers) are taken
+// as the deepest function that is never called directly,
+// library functions without a .su file count as 0 and are
+// listed, so the result is an estimate, not a bound
+//
+// usage: stackreport [-a return_bytes] [-b budget_bytes] listing file.su ...
+//
+// exits with 1 if the worst case does not fit in the budget
+// (the SRAM between the static variables and RAMEND)
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+
+
+// -------------------------------------------------- //
+// limits
+
+# define REPORT_FUNCTIONS   1024
+# define REPORT_CALLS       16384
+# define REPORT_NAME        64
+
+// frame not known (no .su entry)
+# define REPORT_UNKNOWN     -1
+
+
+// -------------------------------------------------- //
+// functions and calls
+
+typedef struct reportFunction {
+    
+    char name[REPORT_NAME];
+    int frame;
+    int dynamic;
+    int indirect;
+    int called;
+    
+    // result of the search, deepest callee and state (0 = not
+    // visited, 1 = on the path, 2 = done)
+    int depth;
+    int worst;
+    int state;
+    
+} reportFunction;
+
+typedef struct reportCall {
+    
+    int from;
+    int to;
+    
+} reportCall;
+
+static reportFunction functions[REPORT_FUNCTIONS];
+static int function_count = 0;
+static reportCall calls[REPORT_CALLS];
+static int call_count = 0;
+static int return_bytes = 2;
+static int indirect_depth = 0;
+static int indirect_worst = -1;
+static int recursion = 0;
+
+
+// -------------------------------------------------- //
+// index of a function, added if it is new
+
+static int reportFind(const char * name) {
+    
+    for (int i = 0; i < function_count; i++) {
+        
+        if (strcmp(functions[i].name, name) == 0) {
+            
+            return i;
+            
+        }
+        
+    }
+    
+    if (function_count == REPORT_FUNCTIONS) {
+        
+        fprintf(stderr, "stackreport: too many functions\n");
+        exit(2);
+        
+    }
+    
+    memset(&functions[function_count], 0, sizeof(reportFunction));
+    snprintf(functions[function_count].name, REPORT_NAME, "%s", name);
+    functions[function_count].frame = REPORT_UNKNOWN;
+    functions[function_count].worst = -1;
+    
+    return function_count++;
+    
+}
+
+
+// -------------------------------------------------- //
+// entry points: main and the interrupt vectors
+
+static int reportIsEntry(const char * name) {
+    
+    return strcmp(name, "main") == 0 || strncmp(name, "__vector_", 9) == 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// reads a .su file (file:line:column:function bytes qualifier),
+// functions that occur twice (static ones of the same name)
+// keep the larger frame
+
+static void reportReadUsage(const char * path) {
+    
+    FILE * file = fopen(path, "r");
+    char line[256];
+    char * name;
+    char * tab;
+    int index;
+    int frame;
+    
+    if (!file) {
+        
+        fprintf(stderr, "stackreport: cannot open %s\n", path);
+        exit(2);
+        
+    }
+    
+    while (fgets(line, sizeof(line), file)) {
+        
+        if ((tab = strchr(line, '\t')) == NULL) {
+            
+            continue;
+            
+        }
+        
+        *tab = '\0';
+        name = strrchr(line, ':');
+        name = name ? name + 1 : line;
+        frame = atoi(tab + 1);
+        
+        index = reportFind(name);
+        
+        if (frame > functions[index].frame) {
+            
+            functions[index].frame = frame;
+            
+        }
+        
+        if (strstr(tab + 1, "dynamic")) {
+            
+            functions[index].dynamic = 1;
+            
+        }
+        
+    }
+    
+    fclose(file);
+    
+}
+
+
+// -------------------------------------------------- //
+// reads the disassembly, a function starts with
+// "address <name>:", calls and jumps to "<name>" (without an
+// offset) are calls, icall/eicall are indirect ones
+
+static void reportReadListing(const char * path) {
+    
+    FILE * file = fopen(path, "r");
+    char line[512];
+    char mnemonic[16];
+    char name[REPORT_NAME];
+    char * field;
+    char * start;
+    char * end;
+    int current = -1;
+    int target;
+    
+    if (!file) {
+        
+        fprintf(stderr, "stackreport: cannot open %s\n", path);
+        exit(2);
+        
+    }
+    
+    while (fgets(line, sizeof(line), file)) {
+        
+        // function header
+        if (line[0] != ' ' && (start = strchr(line, '<')) != NULL && (end = strstr(start, ">:")) != NULL) {
+            
+            *end = '\0';
+            current = reportFind(start + 1);
+            continue;
+            
+        }
+        
+        // instruction: address, bytes, mnemonic and operands separated by tabs
+        if (current < 0 || (field = strchr(line, '\t')) == NULL || (field = strchr(field + 1, '\t')) == NULL ||
+            sscanf(field + 1, "%15s", mnemonic) != 1) {
+            
+            continue;
+            
+        }
+        
+        if (strcmp(mnemonic, "icall") == 0 || strcmp(mnemonic, "eicall") == 0 ||
+            (strncmp(mnemonic, "call", 4) == 0 && strchr(field, '*'))) {
+            
+            functions[current].indirect = 1;
+            continue;
+            
+        }
+        
+        if (strcmp(mnemonic, "call") != 0 && strcmp(mnemonic, "rcall") != 0 && strcmp(mnemonic, "callq") != 0 &&
+            strcmp(mnemonic, "jmp") != 0 && strcmp(mnemonic, "rjmp") != 0 && strcmp(mnemonic, "jmpq") != 0) {
+            
+            continue;
+            
+        }
+        
+        // target "<name>", branches inside a function are "<name+0x..>"
+        if ((start = strrchr(field, '<')) == NULL || (end = strchr(start, '>')) == NULL ||
+            end - start - 1 >= REPORT_NAME || memchr(start, '+', end - start) != NULL) {
+            
+            continue;
+            
+        }
+        
+        memcpy(name, start + 1, end - start - 1);
+        name[end - start - 1] = '\0';
+        
+        if ((start = strstr(name, "@plt")) != NULL) {
+            
+            *start = '\0';
+            
+        }
+        
+        target = reportFind(name);
+        
+        if (target == current) {
+            
+            continue;
+            
+        }
+        
+        if (call_count == REPORT_CALLS) {
+            
+            fprintf(stderr, "stackreport: too many calls\n");
+            exit(2);
+            
+        }
+        
+        calls[call_count].from = current;
+        calls[call_count].to   = target;
+        call_count++;
+        functions[target].called = 1;
+        
+    }
+    
+    fclose(file);
+    
+}
+
+
+// -------------------------------------------------- //
+// deepest path below a function (recursion is cut at the
+// call that closes the cycle and reported)
+
+static int reportDepth(int index) {
+    
+    reportFunction * function = &functions[index];
+    int depth;
+    
+    if (function->state == 2) {
+        
+        return function->depth;
+        
+    }
+    
+    if (function->state == 1) {
+        
+        recursion = 1;
+        return 0;
+        
+    }
+    
+    function->state = 1;
+    function->depth = 0;
+    
+    for (int i = 0; i < call_count; i++) {
+        
+        if (calls[i].from == index && (depth = reportDepth(calls[i].to)) > function->depth) {
+            
+            function->depth = depth;
+            function->worst = calls[i].to;
+            
+        }
+        
+    }
+    
+    if (function->indirect && indirect_depth > function->depth) {
+        
+        function->depth = indirect_depth;
+        function->worst = indirect_worst;
+        
+    }
+    
+    function->depth += ((function->frame == REPORT_UNKNOWN) ? 0 : function->frame) + return_bytes;
+    function->state = 2;
+    
+    return function->depth;
+    
+}
+
+
+// -------------------------------------------------- //
+// prints the deepest path from an entry point
+
+static void reportPath(int index) {
+    
+    for (; index >= 0; index = functions[index].worst) {
+        
+        if (functions[index].frame == REPORT_UNKNOWN) {
+            
+            printf("  %-32s ?\n", functions[index].name);
+            
+        } else {
+            
+            printf("  %-32s %d%s\n", functions[index].name, functions[index].frame,
+                   functions[index].dynamic ? " (dynamic)" : "");
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    int budget = -1;
+    int opt;
+    int depth;
+    int main_depth = 0;
+    int isr_depth = 0;
+    int isr_index = -1;
+    int worst;
+    int count;
+    
+    while ((opt = getopt(argc, argv, "a:b:")) != -1) {
+        
+        switch (opt) {
+            
+            case 'a':
+                
+                return_bytes = atoi(optarg);
+                break;
+            
+            case 'b':
+                
+                budget = atoi(optarg);
+                break;
+            
+            default:
+                
+                fprintf(stderr, "usage: %s [-a return_bytes] [-b budget_bytes] listing file.su ...\n", argv[0]);
+                return 2;
+            
+        }
+        
+    }
+    
+    if (optind + 2 > argc) {
+        
+        fprintf(stderr, "usage: %s [-a return_bytes] [-b budget_bytes] listing file.su ...\n", argv[0]);
+        return 2;
+        
+    }
+    
+    for (int i = optind + 1; i < argc; i++) {
+        
+        reportReadUsage(argv[i]);
+        
+    }
+    
+    reportReadListing(argv[optind]);
+    
+    // targets of indirect calls: own functions (with a frame) that are never called directly
+    for (int i = 0; i < function_count; i++) {
+        
+        if (!functions[i].called && !reportIsEntry(functions[i].name) && functions[i].frame != REPORT_UNKNOWN &&
+            (depth = reportDepth(i)) > indirect_depth) {
+            
+            indirect_depth = depth;
+            indirect_worst = i;
+            
+        }
+        
+    }
+    
+    printf("# worst-case stack per entry point (bytes, frames + %d byte return addresses)\n", return_bytes);
+    
+    for (int i = 0; i < function_count; i++) {
+        
+        if (!reportIsEntry(functions[i].name)) {
+            
+            continue;
+            
+        }
+        
+        depth = reportDepth(i);
+        printf("%s %d\n", functions[i].name, depth);
+        reportPath(i);
+        
+        if (strcmp(functions[i].name, "main") == 0) {
+            
+            main_depth = depth;
+            
+        } else if (depth > isr_depth) {
+            
+            isr_depth = depth;
+            isr_index = i;
+            
+        }
+        
+    }
+    
+    worst = main_depth + isr_depth;
+    printf("worst_case %d (main + %s)\n", worst, (isr_index >= 0) ? functions[isr_index].name : "no interrupt");
+    
+    if (budget >= 0) {
+        
+        printf("budget %d\n", budget);
+        printf("margin %d\n", budget - worst);
+        
+    }
+    
+    // what the estimate could not see
+    printf("no_frame_data");
+    count = 0;
+    
+    for (int i = 0; i < function_count; i++) {
+        
+        if (functions[i].frame == REPORT_UNKNOWN && functions[i].called && count++ < 16) {
+            
+            printf(" %s", functions[i].name);
+            
+        }
+        
+    }
+    
+    printf("\nindirect_calls");
+    
+    for (int i = 0; i < function_count; i++) {
+        
+        if (functions[i].indirect && functions[i].frame != REPORT_UNKNOWN) {
+            
+            printf(" %s", functions[i].name);
+            
+        }
+        
+    }
+    
+    printf("\nindirect_target %s %d\n", (indirect_worst >= 0) ? functions[indirect_worst].name : "-", indirect_depth);
+    
+    count = 0;
+    
+    for (int i = 0; i < function_count; i++) {
+        
+        count += functions[i].dynamic;
+        
+    }
+    
+    printf("dynamic_frames %d\n", count);
+    printf("recursion %s\n", recursion ? "yes" : "no");
+    
+    return (budget >= 0 && worst > budget) ? 1 : 0;
+    
+}
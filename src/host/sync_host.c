@@ -0,0 +1,86 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+
+# include "sync_host.h"
+
+
+// -------------------------------------------------- //
+// initialize
+
+void SYNChostInit(SyncHost * host) {
+    
+    host->_length   = 0;
+    host->_overflow = 0;
+    host->requests  = 0;
+    host->corrupt   = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// takes one byte of the serial stream, returns 1 when it
+// completed a sync request (id, seconds and ms are set),
+// other frames and text are skipped
+
+int SYNChostFeed(SyncHost * host, uint8_t c) {
+    
+    uint8_t record[TEL_PAYLOAD_MAX + TEL_OVERHEAD];
+    uint8_t length;
+    
+    if (c != 0x00) {
+        
+        if (host->_length < (int) sizeof(host->_frame)) {
+            
+            host->_frame[host->_length++] = c;
+            
+        } else {
+            
+            host->_overflow = 1;
+            
+        }
+        
+        return 0;
+        
+    }
+    
+    // frames that ran over (e.g. behind a console reply) are dropped
+    length = host->_overflow ? 0 : TELdecodeFrame(host->_frame, host->_length, record);
+    
+    host->_length   = 0;
+    host->_overflow = 0;
+    
+    if (length == 0 || record[0] != TEL_RECORD_SYNC) {
+        
+        return 0;
+        
+    }
+    
+    if (length != 2 + TEL_PAYLOAD_SYNC) {
+        
+        host->corrupt++;
+        return 0;
+        
+    }
+    
+    host->seconds = record[2] | (record[3] << 8) | ((uint32_t) record[4] << 16) | ((uint32_t) record[5] << 24);
+    host->ms      = record[6] | (record[7] << 8);
+    host->id      = record[8];
+    host->requests++;
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// formats the answer to the last request, returns its length
+
+int SYNChostAnswer(const SyncHost * host, char * line, int size, uint64_t t2, uint64_t t3) {
+    
+    return snprintf(line, size, "sync %u %lu.%03u %u\n", host->id, (unsigned long) (t2 / 1000),
+                    (unsigned) (t2 % 1000), (unsigned) (t3 - t2));
+    
+}
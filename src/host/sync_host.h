@@ -0,0 +1,50 @@
+# ifndef SYNC_HOST_H
+# define SYNC_HOST_H
+
+// ------------------------------------------------------------ //
+// host side of the time synchronization (see timesync.h)
+//
+// collects the telemetry frames of the clock, a sync request
+// is answered with the time it arrived (t2) and the ms until
+// the answer leaves (t3 - t2):
+//
+//   sync <id> <t2 seconds>.<t2 ms> <t3 - t2 ms>\n
+//
+// used by the daemon (timesyncd) and the simulation, which
+// pass the bytes and their own reference clock
+
+# include <stdint.h>
+
+# include "../telemetry.h"
+
+
+// ------------------------------------------------------------ //
+// struct for storing the frame being received
+
+typedef struct SyncHost {
+    
+    uint8_t _frame[TEL_FRAME_MAX];
+    int _length;
+    int _overflow;
+    
+    // last request (id and clock time t1)
+    uint8_t id;
+    uint32_t seconds;
+    uint16_t ms;
+    
+    // statistics
+    uint32_t requests;
+    uint32_t corrupt;
+    
+} SyncHost;
+
+
+// ------------------------------------------------------------ //
+// receiving requests and answering them (times in ms since
+// 2000-01-01 00:00:00 UTC)
+
+void SYNChostInit(SyncHost * host);
+int SYNChostFeed(SyncHost * host, uint8_t c);
+int SYNChostAnswer(const SyncHost * host, char * line, int size, uint64_t t2, uint64_t t3);
+
+# endif
@@ -0,0 +1,210 @@
+// -------------------------------------------------- //
+// host-side decoder for the binary telemetry stream
+//
+// reads the raw serial stream from a file or stdin and
+// writes one CSV line per valid record to stdout
+//
+// console replies and the profiler dump are text between the
+// frame delimiters, blocks that do not decode but are text are
+// passed to stderr instead of counting as corrupt frames
+//
+// usage: teldecode [file]
+//        stty -F /dev/ttyACM0 115200 raw && teldecode /dev/ttyACM0
+
+# include <stdio.h>
+# include <stdint.h>
+# include <time.h>
+
+# include "../telemetry.h"
+
+
+// -------------------------------------------------- //
+// seconds between 1970-01-01 and 2000-01-01
+
+# define EPOCH_2000 946684800L
+
+
+// -------------------------------------------------- //
+// longest block between two delimiters (text can be longer
+// than a frame)
+
+# define BLOCK_MAX 1024
+
+
+// -------------------------------------------------- //
+// counters printed to stderr at the end of the stream
+
+static unsigned long frames_ok      = 0;
+static unsigned long frames_corrupt = 0;
+static unsigned long frames_lost    = 0;
+static unsigned long text_blocks    = 0;
+
+
+// -------------------------------------------------- //
+// 1 if a block is text (printable characters and line ends)
+
+static int isText(const uint8_t * block, int length) {
+    
+    for (int i = 0; i < length; i++) {
+        
+        if ((block[i] < 0x20 || block[i] > 0x7E) && block[i] != '\r' && block[i] != '\n') {
+            
+            return 0;
+            
+        }
+        
+    }
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// prints one decoded record as a CSV line
+
+static void printRecord(const uint8_t * record, uint8_t length) {
+    
+    static int last_sequence = -1;
+    uint32_t timestamp;
+    time_t unixtime;
+    char datetime[32];
+    
+    // count gaps in the sequence numbers
+    if (last_sequence >= 0) {
+        
+        frames_lost += (uint8_t) (record[1] - last_sequence - 1);
+        
+    }
+    
+    last_sequence = record[1];
+    
+    timestamp = record[2] | (record[3] << 8) | ((uint32_t) record[4] << 16) | ((uint32_t) record[5] << 24);
+    unixtime  = (time_t) timestamp + EPOCH_2000;
+    strftime(datetime, sizeof(datetime), "%Y-%m-%dT%H:%M:%S", gmtime(&unixtime));
+    
+    switch (record[0]) {
+        
+        case TEL_RECORD_TIME:
+            
+            if (length != 2 + TEL_PAYLOAD_TIME) {
+                
+                frames_corrupt++;
+                return;
+                
+            }
+            
+            printf("%u,time,%lu,%s,,\n", record[1], (unsigned long) timestamp, datetime);
+            break;
+        
+        case TEL_RECORD_DHT11:
+            
+            if (length != 2 + TEL_PAYLOAD_DHT11) {
+                
+                frames_corrupt++;
+                return;
+                
+            }
+            
+            printf("%u,dht11,%lu,%s,%u.%u,%u.%u\n", record[1], (unsigned long) timestamp, datetime,
+                   record[6], record[7], record[8], record[9]);
+            break;
+        
+        case TEL_RECORD_SYNC:
+            
+            if (length != 2 + TEL_PAYLOAD_SYNC) {
+                
+                frames_corrupt++;
+                return;
+                
+            }
+            
+            // request of the time synchronization, the datetime with ms
+            printf("%u,sync,%lu,%s.%03u,,\n", record[1], (unsigned long) timestamp, datetime,
+                   record[6] | (record[7] << 8));
+            break;
+        
+        default:
+            
+            frames_corrupt++;
+            return;
+        
+    }
+    
+    frames_ok++;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    FILE * in = stdin;
+    uint8_t frame[BLOCK_MAX];
+    uint8_t record[TEL_PAYLOAD_MAX + TEL_OVERHEAD];
+    int length = 0;
+    int overflow = 0;
+    int c;
+    
+    if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+        
+        perror(argv[1]);
+        return 1;
+        
+    }
+    
+    printf("sequence,record,timestamp,datetime,humidity,temperature\n");
+    
+    while ((c = fgetc(in)) != EOF) {
+        
+        // collect bytes until the delimiter
+        if (c != 0x00) {
+            
+            if (length < (int) sizeof(frame)) {
+                
+                frame[length++] = c;
+                
+            } else {
+                
+                overflow = 1;
+                
+            }
+            
+            continue;
+            
+        }
+        
+        // empty frames happen when joining the stream mid-frame
+        if (length > 0) {
+            
+            uint8_t record_length = (overflow || length >= TEL_FRAME_MAX) ? 0 : TELdecodeFrame(frame, length, record);
+            
+            if (record_length == 0 && !overflow && isText(frame, length)) {
+                
+                text_blocks++;
+                fwrite(frame, 1, length, stderr);
+                
+            } else if (record_length == 0) {
+                
+                frames_corrupt++;
+                
+            } else {
+                
+                printRecord(record, record_length);
+                
+            }
+            
+        }
+        
+        length = 0;
+        overflow = 0;
+        
+    }
+    
+    fprintf(stderr, "frames: %lu ok, %lu corrupt, %lu lost, %lu text\n", frames_ok, frames_corrupt, frames_lost, text_blocks);
+    
+    return 0;
+    
+}
@@ -0,0 +1,155 @@
+// -------------------------------------------------- //
+// time synchronization daemon for the clock (see timesync.h)
+//
+// starts a synchronization ("sync") and answers the requests
+// of the clock with the system time, which should itself be
+// kept by NTP
+//
+// usage: timesyncd [-i interval_s] port
+//        stty -F /dev/ttyACM0 115200 raw && timesyncd -i 3600 /dev/ttyACM0
+//
+// without -i the clock is synchronized once, the daemon keeps
+// answering requests (e.g. "sync" typed on the console) until
+// it is stopped
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <string.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "sync_host.h"
+
+
+// -------------------------------------------------- //
+// seconds between 1970-01-01 and 2000-01-01
+
+# define EPOCH_2000 946684800ULL
+
+
+// -------------------------------------------------- //
+// system time in ms since 2000
+
+static uint64_t nowMs(void) {
+    
+    struct timespec now;
+    
+    clock_gettime(CLOCK_REALTIME, &now);
+    
+    return ((uint64_t) now.tv_sec - EPOCH_2000) * 1000 + now.tv_nsec / 1000000;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    SyncHost host;
+    struct pollfd port;
+    char line[40];
+    uint8_t buffer[64];
+    uint64_t interval = 0;
+    uint64_t next_start;
+    uint64_t t2;
+    int opt;
+    int timeout;
+    ssize_t count;
+    
+    while ((opt = getopt(argc, argv, "i:")) != -1) {
+        
+        switch (opt) {
+            
+            case 'i':
+                
+                interval = (uint64_t) atol(optarg) * 1000;
+                break;
+            
+            default:
+                
+                fprintf(stderr, "usage: %s [-i interval_s] port\n", argv[0]);
+                return 2;
+            
+        }
+        
+    }
+    
+    if (optind + 1 != argc) {
+        
+        fprintf(stderr, "usage: %s [-i interval_s] port\n", argv[0]);
+        return 2;
+        
+    }
+    
+    if ((port.fd = open(argv[optind], O_RDWR | O_NOCTTY)) < 0) {
+        
+        perror(argv[optind]);
+        return 1;
+        
+    }
+    
+    port.events = POLLIN;
+    SYNChostInit(&host);
+    next_start = nowMs();
+    
+    while (1) {
+        
+        // start a synchronization when it is due
+        if (next_start != 0 && nowMs() >= next_start) {
+            
+            if (write(port.fd, "sync\n", 5) != 5) {
+                
+                perror("write");
+                return 1;
+                
+            }
+            
+            next_start = interval ? next_start + interval : 0;
+            
+        }
+        
+        timeout = (next_start == 0) ? -1 : (int) ((next_start > nowMs()) ? next_start - nowMs() : 0);
+        
+        if (poll(&port, 1, timeout) <= 0) {
+            
+            continue;
+            
+        }
+        
+        if ((count = read(port.fd, buffer, sizeof(buffer))) <= 0) {
+            
+            perror("read");
+            return 1;
+            
+        }
+        
+        // the arrival is the time the block was read, the answer leaves right away
+        t2 = nowMs();
+        
+        for (ssize_t i = 0; i < count; i++) {
+            
+            if (SYNChostFeed(&host, buffer[i])) {
+                
+                int length = SYNChostAnswer(&host, line, sizeof(line), t2, nowMs());
+                
+                if (write(port.fd, line, length) != length) {
+                    
+                    perror("write");
+                    return 1;
+                    
+                }
+                
+                printf("request %u clock %lu.%03u answer %s", host.id, (unsigned long) host.seconds, host.ms, line);
+                fflush(stdout);
+                
+            }
+            
+        }
+        
+    }
+    
+}
@@ -0,0 +1,301 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "../hal.h"
+# include "trace.h"
+
+
+// -------------------------------------------------- //
+// file the hal trace is recorded to
+
+static FILE * record_file = NULL;
+
+
+// -------------------------------------------------- //
+// reads a capture, returns 0 on success
+
+int TRACEload(trace * t, const char * path) {
+    
+    FILE * file = fopen(path, "r");
+    char line[256];
+    
+    t->events   = NULL;
+    t->count    = 0;
+    t->capacity = 0;
+    t->expect[0] = '\0';
+    
+    if (file == NULL) {
+        
+        return -1;
+        
+    }
+    
+    while (fgets(line, sizeof(line), file) != NULL) {
+        
+        unsigned long long time;
+        char port;
+        unsigned int mask, value;
+        
+        if (line[0] == '#') {
+            
+            if (strncmp(line, "# expect ", 9) == 0) {
+                
+                snprintf(t->expect, sizeof(t->expect), "%.127s", line + 9);
+                t->expect[strcspn(t->expect, "\r\n")] = '\0';
+                
+            }
+            
+            continue;
+            
+        }
+        
+        if (sscanf(line, "%llu %c %x %x", &time, &port, &mask, &value) != 4 || port < 'B' || port > 'D') {
+            
+            continue;
+            
+        }
+        
+        if (t->count == t->capacity) {
+            
+            t->capacity = t->capacity ? 2 * t->capacity : 1024;
+            t->events = realloc(t->events, t->capacity * sizeof(*t->events));
+            
+        }
+        
+        t->events[t->count].time  = time;
+        t->events[t->count].port  = port - 'B';
+        t->events[t->count].mask  = mask;
+        t->events[t->count].value = value;
+        t->count++;
+        
+    }
+    
+    fclose(file);
+    
+    return 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// releases a capture
+
+void TRACEfree(trace * t) {
+    
+    free(t->events);
+    t->events = NULL;
+    t->count  = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// writes the hal's gpio trace
+
+static void TRACErecordHook(uint64_t time, uint8_t port, uint8_t mask, uint8_t value) {
+    
+    fprintf(record_file, "%llu %c %02x %02x\n", (unsigned long long) time, 'B' + port, mask, value);
+    
+}
+
+void TRACErecord(FILE * file) {
+    
+    record_file = file;
+    HALhostSetTraceHook(file ? TRACErecordHook : NULL);
+    
+}
+
+
+// -------------------------------------------------- //
+// finds the next sync edge in the capture after _sync_pos
+// returns its index or the number of events if there is none
+
+static uint32_t TRACEreplayNextSync(TRACEreplay * replay) {
+    
+    trace * t = replay->_trace;
+    
+    for (uint32_t i = replay->_sync_pos; i < t->count; i++) {
+        
+        traceEvent * e = &t->events[i];
+        uint8_t previous = replay->_capture_sync;
+        uint8_t level;
+        
+        if (e->port != replay->_sync_port || !(e->mask & (1 << replay->_sync_bit))) {
+            
+            continue;
+            
+        }
+        
+        level = (e->value >> replay->_sync_bit) & 1;
+        replay->_capture_sync = level;
+        
+        // the initial state is not an edge
+        if (previous == 0xFF || previous == level) {
+            
+            continue;
+            
+        }
+        
+        if (level == 0) {
+            
+            replay->_capture_low_since = e->time;
+            
+        }
+        
+        if (level != replay->_sync_edge) {
+            
+            continue;
+            
+        }
+        
+        // rising edges need a long enough low phase before them
+        if (level == 1 && e->time - replay->_capture_low_since < replay->_min_low) {
+            
+            continue;
+            
+        }
+        
+        return i;
+        
+    }
+    
+    return t->count;
+    
+}
+
+
+// -------------------------------------------------- //
+// moves the replay position up to a capture time and
+// tracks the level of the data pin
+
+static void TRACEreplaySeek(TRACEreplay * replay, uint64_t time) {
+    
+    trace * t = replay->_trace;
+    
+    while (replay->_pos < t->count && t->events[replay->_pos].time <= time) {
+        
+        traceEvent * e = &t->events[replay->_pos];
+        
+        if (e->port == replay->_data_port && (e->mask & (1 << replay->_data_bit))) {
+            
+            replay->_level = (e->value >> replay->_data_bit) & 1;
+            
+        }
+        
+        replay->_pos++;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu changes a pin
+
+static void TRACEreplayChanged(void * ctx, uint64_t time, uint8_t port, uint8_t mask, uint8_t value) {
+    
+    TRACEreplay * replay = ctx;
+    uint32_t sync;
+    uint8_t level;
+    
+    if (port != replay->_sync_port || !(mask & (1 << replay->_sync_bit))) {
+        
+        return;
+        
+    }
+    
+    level = (value >> replay->_sync_bit) & 1;
+    
+    if (level != replay->_sync_edge) {
+        
+        return;
+        
+    }
+    
+    sync = TRACEreplayNextSync(replay);
+    
+    if (sync == replay->_trace->count) {
+        
+        // capture exhausted, release the line
+        replay->misses++;
+        replay->_active = 0;
+        return;
+        
+    }
+    
+    replay->syncs++;
+    replay->_active   = 1;
+    replay->_sync_pos = sync + 1;
+    replay->_offset   = time - replay->_trace->events[sync].time;
+    TRACEreplaySeek(replay, replay->_trace->events[sync].time);
+    
+}
+
+
+// -------------------------------------------------- //
+// called by the hal when the mcu reads a pin
+
+static int TRACEreplayDrive(void * ctx, uint64_t time, uint8_t port, uint8_t bit) {
+    
+    TRACEreplay * replay = ctx;
+    
+    if (!replay->_active || port != replay->_data_port || bit != replay->_data_bit) {
+        
+        return -1;
+        
+    }
+    
+    TRACEreplaySeek(replay, time - replay->_offset);
+    
+    return replay->_level;
+    
+}
+
+
+// -------------------------------------------------- //
+// creates the replay and attaches it to the hal
+
+void TRACEreplayInit(TRACEreplay * replay, trace * t,
+                     uint8_t sync_port, uint8_t sync_bit, uint8_t sync_edge, uint64_t min_low,
+                     uint8_t data_port, uint8_t data_bit) {
+    
+    replay->_trace     = t;
+    replay->_sync_port = sync_port;
+    replay->_sync_bit  = sync_bit;
+    replay->_sync_edge = sync_edge;
+    replay->_min_low   = min_low;
+    replay->_data_port = data_port;
+    replay->_data_bit  = data_bit;
+    
+    TRACEreplayRewind(replay);
+    
+    replay->_device.ctx     = replay;
+    replay->_device.changed = TRACEreplayChanged;
+    replay->_device.drive   = TRACEreplayDrive;
+    replay->_device.tick    = 0;
+    HALhostAttach(&replay->_device);
+    
+}
+
+
+// -------------------------------------------------- //
+// starts again at the beginning of the capture
+
+void TRACEreplayRewind(TRACEreplay * replay) {
+    
+    replay->_active   = 0;
+    replay->_offset   = 0;
+    replay->_sync_pos = 0;
+    replay->_pos      = 0;
+    replay->_level    = 1;
+    replay->_capture_sync      = 0xFF;
+    replay->_capture_low_since = 0;
+    replay->syncs     = 0;
+    replay->misses    = 0;
+    
+}
@@ -0,0 +1,107 @@
+# ifndef TRACE_H
+# define TRACE_H
+
+// ------------------------------------------------------------ //
+// gpio trace capture format
+//
+// plain text, one line per change of the line levels of a port:
+//
+//   <time_ns> <port> <mask> <value>
+//
+//   time_ns  time since the start of the capture in ns
+//   port     B, C or D
+//   mask     changed pins (hex)
+//   value    levels of all pins of the port after the change (hex)
+//
+// the first line of every port holds its initial levels (mask ff)
+// lines starting with '#' are comments, a comment of the form
+// "# expect <values...>" holds the golden decoding of the capture
+//
+// captures of a logic analyzer can be converted by writing one
+// line per edge (e.g. from a sigrok CSV export), only the pins the
+// replay uses have to be present
+
+# include <stdio.h>
+# include <stdint.h>
+
+# include "hal_host.h"
+
+
+// ------------------------------------------------------------ //
+// struct for one change and a whole capture
+
+typedef struct traceEvent {
+    
+    uint64_t time;
+    uint8_t port;
+    uint8_t mask;
+    uint8_t value;
+    
+} traceEvent;
+
+typedef struct trace {
+    
+    traceEvent * events;
+    uint32_t count;
+    uint32_t capacity;
+    char expect[128];
+    
+} trace;
+
+
+// ------------------------------------------------------------ //
+// loading and recording
+//
+// TRACErecord writes the hal's gpio trace to file (NULL stops)
+
+int TRACEload(trace * t, const char * path);
+void TRACEfree(trace * t);
+void TRACErecord(FILE * file);
+
+
+// ------------------------------------------------------------ //
+// replay of a device driven pin
+//
+// the capture is aligned to the mcu at every sync edge: when the
+// mcu produces an edge on the sync pin, the replay jumps to the
+// next edge of the same direction in the capture and from then on
+// drives the data pin with the captured levels (relative to it)
+//
+// clocked protocols (DS1302) sync on every clock edge, timed ones
+// (DHT11) sync on the release of the start signal, min_low skips
+// edges that follow a low phase shorter than that
+
+typedef struct TRACEreplay {
+    
+    trace * _trace;
+    
+    // sync pin (mcu driven), edge (1 = rising, 0 = falling)
+    uint8_t _sync_port, _sync_bit, _sync_edge;
+    uint64_t _min_low;
+    
+    // data pin (device driven)
+    uint8_t _data_port, _data_bit;
+    
+    // replay state
+    uint8_t _active;
+    uint64_t _offset;
+    uint32_t _sync_pos;
+    uint32_t _pos;
+    uint8_t _level;
+    uint8_t _capture_sync;
+    uint64_t _capture_low_since;
+    
+    // statistics
+    uint32_t syncs;
+    uint32_t misses;
+    
+    HALhostDevice _device;
+    
+} TRACEreplay;
+
+void TRACEreplayInit(TRACEreplay * replay, trace * t,
+                     uint8_t sync_port, uint8_t sync_bit, uint8_t sync_edge, uint64_t min_low,
+                     uint8_t data_port, uint8_t data_bit);
+void TRACEreplayRewind(TRACEreplay * replay);
+
+# endif
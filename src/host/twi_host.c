@@ -0,0 +1,269 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+# include "../twi.h"
+
+
+// -------------------------------------------------- //
+// duration of one bit on the bus (ns)
+
+# define TWI_HOST_BIT_NS    (1000000000ULL / TWI_FREQ)
+
+// phase of the running transfer
+enum twiHostPhases {
+    TWI_HOST_ADDRESS,
+    TWI_HOST_DATA,
+    TWI_HOST_STOP
+};
+
+
+// -------------------------------------------------- //
+// slaves on the bus
+
+typedef struct twiHostSlave {
+    
+    uint8_t address;
+    void (*receive)(void * ctx, uint64_t time, uint8_t value);
+    void * ctx;
+    
+} twiHostSlave;
+
+static twiHostSlave twi_slaves[TWI_HOST_SLAVES];
+static uint8_t twi_slave_count = 0;
+
+
+// -------------------------------------------------- //
+// queue and the transfer, which runs in the background as
+// a device of the hal (see twiHostTick)
+
+static uint8_t twi_queue[TWI_QUEUE_SIZE];
+static uint8_t twi_head = 0;
+static uint8_t twi_tail = 0;
+static uint8_t twi_address = 0;
+static uint8_t twi_running = 0;
+static uint8_t twi_phase;
+static uint8_t twi_byte;
+static twiHostSlave * twi_slave;
+
+static twiStats twi_stats;
+static HALhostDevice twi_device;
+
+
+// -------------------------------------------------- //
+// attaches a slave (replaces one with the same address)
+
+void TWIhostAttach(uint8_t address, void (*receive)(void * ctx, uint64_t time, uint8_t value), void * ctx) {
+    
+    uint8_t i;
+    
+    for (i = 0; i < twi_slave_count && twi_slaves[i].address != address; i++);
+    
+    if (i == TWI_HOST_SLAVES) {
+        
+        return;
+        
+    }
+    
+    if (i == twi_slave_count) {
+        
+        twi_slave_count++;
+        
+    }
+    
+    twi_slaves[i].address = address;
+    twi_slaves[i].receive = receive;
+    twi_slaves[i].ctx     = ctx;
+    
+}
+
+
+// -------------------------------------------------- //
+// sends the next queued byte, or the stop condition once
+// the queue is empty
+
+static void twiHostNext(uint64_t time) {
+    
+    if (twi_tail != twi_head) {
+        
+        twi_byte  = twi_queue[twi_tail];
+        twi_tail  = (twi_tail + 1) & (TWI_QUEUE_SIZE - 1);
+        twi_phase = TWI_HOST_DATA;
+        twi_device.next = time + 9 * TWI_HOST_BIT_NS;
+        
+    } else {
+        
+        twi_phase = TWI_HOST_STOP;
+        twi_device.next = time + TWI_HOST_BIT_NS;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// end of the current phase of the transfer (the work the
+// interrupt does on the target)
+
+static void twiHostTick(void * ctx, uint64_t time) {
+    
+    switch (twi_phase) {
+        
+        case TWI_HOST_ADDRESS:
+            
+            twi_slave = 0;
+            
+            for (uint8_t i = 0; i < twi_slave_count; i++) {
+                
+                if (twi_slaves[i].address == twi_address) {
+                    
+                    twi_slave = &twi_slaves[i];
+                    
+                }
+                
+            }
+            
+            // not acknowledged, the transfer is dropped
+            if (!twi_slave) {
+                
+                twi_tail = twi_head;
+                twi_stats.errors++;
+                
+            }
+            
+            twiHostNext(time);
+            
+            break;
+        
+        case TWI_HOST_DATA:
+            
+            twi_slave->receive(twi_slave->ctx, time, twi_byte);
+            twi_stats.bytes++;
+            twiHostNext(time);
+            
+            break;
+        
+        default:
+            
+            // only acknowledged transfers count
+            if (twi_slave) {
+                
+                twi_stats.transfers++;
+                
+            }
+            
+            twi_running = 0;
+            
+            break;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// resets the queue and puts the TWI on the bus of the hal
+// (HALhostReset removes it)
+
+void TWIinit(void) {
+    
+    twi_head    = 0;
+    twi_tail    = 0;
+    twi_address = 0;
+    twi_running = 0;
+    
+    twi_stats.bytes     = 0;
+    twi_stats.transfers = 0;
+    twi_stats.waits     = 0;
+    twi_stats.errors    = 0;
+    
+    twi_device.ctx     = 0;
+    twi_device.changed = 0;
+    twi_device.drive   = 0;
+    twi_device.tick    = twiHostTick;
+    twi_device.next    = 0;
+    HALhostAttach(&twi_device);
+    
+}
+
+
+// -------------------------------------------------- //
+// queues bytes for a slave, waits in virtual time while
+// the queue is full or holds bytes of another slave
+
+void TWIwrite(uint8_t address, const uint8_t * data, uint8_t length) {
+    
+    uint8_t next;
+    
+    if (address != twi_address) {
+        
+        TWIflush();
+        twi_address = address;
+        
+    }
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        next = (twi_head + 1) & (TWI_QUEUE_SIZE - 1);
+        
+        if (next == twi_tail) {
+            
+            twi_stats.waits++;
+            
+            while (next == twi_tail) {
+                
+                hal_delay_us(1);
+                
+            }
+            
+        }
+        
+        twi_queue[twi_head] = data[i];
+        twi_head = next;
+        
+    }
+    
+    // start condition and address
+    if (!twi_running) {
+        
+        twi_running = 1;
+        twi_phase   = TWI_HOST_ADDRESS;
+        twi_device.next = HALhostTime() + 10 * TWI_HOST_BIT_NS;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// queue and transfer state and counters
+
+uint8_t TWIroom(void) {
+    
+    return (twi_tail - twi_head - 1) & (TWI_QUEUE_SIZE - 1);
+    
+}
+
+uint8_t TWIbusy(void) {
+    
+    return twi_running;
+    
+}
+
+void TWIflush(void) {
+    
+    while (twi_running) {
+        
+        hal_delay_us(1);
+        
+    }
+    
+}
+
+const twiStats * TWIstats(void) {
+    
+    return &twi_stats;
+    
+}
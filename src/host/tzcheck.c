@@ -0,0 +1,261 @@
+// -------------------------------------------------- //
+// checks the time zone engine (timezone.c) and the date
+// conversions of ds1302.c against a reference table
+//
+// every line of the table is converted from UTC to local
+// time and back, the times skipped by the transitions are
+// converted to UTC, then every zone runs through a whole year
+// second by second to count the rule evaluations
+//
+// usage: tzcheck [reference]   (default host/tz/reference.txt)
+
+# include <stdio.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "../hal.h"
+# include "../ds1302.h"
+# include "../timezone.h"
+
+
+// -------------------------------------------------- //
+// zone names as used in the reference table
+
+static const char * zone_names[TZ_ZONES] = {
+    "UTC", "WET", "CET", "EET", "EST", "CST", "MST", "PST", "IST", "JST", "AEST"
+};
+
+
+// -------------------------------------------------- //
+// parses "YYYY-MM-DDTHH:MM:SS" into seconds since 2000
+
+static int parseTime(const char * text, uint32_t * seconds) {
+    
+    int year, month, day, hour, minute, second;
+    timeData data;
+    
+    if (sscanf(text, "%d-%d-%dT%d:%d:%d", &year, &month, &day, &hour, &minute, &second) != 6 ||
+        year < 2000 || year > 2099) {
+        
+        return 0;
+        
+    }
+    
+    data.year   = year - 2000;
+    data.month  = month;
+    data.day    = day;
+    data.hour   = hour;
+    data.minute = minute;
+    data.second = second;
+    
+    *seconds = DS1302timeDataToSeconds(&data);
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// formats seconds since 2000 like the reference table
+
+static void formatTime(uint32_t seconds, char * text) {
+    
+    timeData data;
+    
+    DS1302timeDataFromSeconds(&data, seconds);
+    sprintf(text, "%04d-%02d-%02dT%02d:%02d:%02d", 2000 + data.year, data.month, data.day,
+            data.hour, data.minute, data.second);
+    
+}
+
+
+// -------------------------------------------------- //
+// every day of 2000-2099 converted to seconds and back
+
+static unsigned long checkDates(void) {
+    
+    unsigned long failures = 0;
+    timeData data;
+    uint32_t seconds;
+    
+    for (uint32_t day = 0; day < 36525; day++) {
+        
+        seconds = day * 86400UL + 86399UL;
+        DS1302timeDataFromSeconds(&data, seconds);
+        
+        if (DS1302timeDataToSeconds(&data) != seconds ||
+            data.dayofweek != DS1302dayOfWeekFromDate(data.day, data.month, 2000 + data.year)) {
+            
+            failures++;
+            
+        }
+        
+    }
+    
+    return failures;
+    
+}
+
+
+// -------------------------------------------------- //
+// every local time in the middle of a gap (the hour skipped
+// when the clocks go forward, 2015-2040) has to be taken as
+// standard time by TZutc
+
+static unsigned long checkSkipped(unsigned long * checked) {
+    
+    unsigned long failures = 0;
+    Timezone tz;
+    uint32_t start;
+    uint32_t end;
+    uint32_t at;
+    int32_t before;
+    int32_t after;
+    uint32_t local;
+    char text[32];
+    
+    parseTime("2015-01-01T00:00:00", &start);
+    parseTime("2041-01-01T00:00:00", &end);
+    
+    for (uint8_t index = 0; index < TZ_ZONES; index++) {
+        
+        TZinit(&tz, index);
+        TZlocal(&tz, start);
+        
+        while (TZnextTransition(&tz) < end) {
+            
+            // offsets on both sides, the conversions leave the period after the transition
+            at     = TZnextTransition(&tz);
+            before = TZlocal(&tz, at - 1) - (at - 1);
+            after  = TZlocal(&tz, at) - at;
+            
+            if (after <= before) {
+                
+                continue;
+                
+            }
+            
+            local = at + before + (after - before) / 2;
+            (*checked)++;
+            
+            if (TZutc(&tz, local) != local - before || TZisDST(&tz) != 1) {
+                
+                formatTime(local, text);
+                printf("mismatch %s: skipped local %s not taken as standard time\n", zone_names[index], text);
+                failures++;
+                
+            }
+            
+        }
+        
+    }
+    
+    return failures;
+    
+}
+
+
+// -------------------------------------------------- //
+// main
+
+int main(int argc, char ** argv) {
+    
+    const char * path = (argc > 1) ? argv[1] : "host/tz/reference.txt";
+    FILE * file;
+    char line[128];
+    char zone[8];
+    char utc_text[32];
+    char local_text[32];
+    char text[32];
+    int dst;
+    unsigned long checked = 0;
+    unsigned long failures = 0;
+    unsigned long date_failures;
+    Timezone tz;
+    uint32_t utc;
+    uint32_t local;
+    uint32_t start;
+    uint8_t index;
+    
+    // date conversions
+    date_failures = checkDates();
+    printf("dates_checked 36525\n");
+    printf("date_failures %lu\n", date_failures);
+    
+    file = fopen(path, "r");
+    
+    if (!file) {
+        
+        fprintf(stderr, "tzcheck: cannot open %s\n", path);
+        return 1;
+        
+    }
+    
+    while (fgets(line, sizeof(line), file)) {
+        
+        if (line[0] == '#' || sscanf(line, "%7s %31s %31s %d", zone, utc_text, local_text, &dst) != 4) {
+            
+            continue;
+            
+        }
+        
+        for (index = 0; index < TZ_ZONES && strcmp(zone_names[index], zone) != 0; index++);
+        
+        if (index == TZ_ZONES || !parseTime(utc_text, &utc)) {
+            
+            fprintf(stderr, "tzcheck: bad line: %s", line);
+            failures++;
+            continue;
+            
+        }
+        
+        // a fresh zone per line, so every conversion evaluates the rule
+        TZinit(&tz, index);
+        local = TZlocal(&tz, utc);
+        formatTime(local, text);
+        checked++;
+        
+        if (strcmp(text, local_text) != 0 || TZisDST(&tz) != dst) {
+            
+            printf("mismatch %s %s: %s dst %d, expected %s dst %d\n", zone, utc_text, text, TZisDST(&tz), local_text, dst);
+            failures++;
+            
+        }
+        
+        // back to UTC has to give the same local time (twice occurring times resolve to one of them)
+        if (TZlocal(&tz, TZutc(&tz, local)) != local) {
+            
+            printf("mismatch %s %s: local %s does not convert back\n", zone, utc_text, text);
+            failures++;
+            
+        }
+        
+    }
+    
+    fclose(file);
+    
+    failures += checkSkipped(&checked);
+    
+    printf("conversions_checked %lu\n", checked);
+    printf("conversion_failures %lu\n", failures);
+    
+    // one conversion per second through 2024, as the clock does
+    parseTime("2024-01-01T00:00:00", &start);
+    
+    for (index = 0; index < TZ_ZONES; index++) {
+        
+        TZinit(&tz, index);
+        
+        for (utc = start; utc < start + 366 * 86400UL; utc++) {
+            
+            TZlocal(&tz, utc);
+            
+        }
+        
+        printf("evaluations_2024 %s %u\n", zone_names[index], tz.evaluations);
+        
+    }
+    
+    return (failures || date_failures || checked == 0) ? 1 : 0;
+    
+}
@@ -0,0 +1,174 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include "../hal.h"
+# include "../uart.h"
+
+
+// -------------------------------------------------- //
+// receiver of the sent bytes
+
+static void (*uart_sink)(uint8_t c) = 0;
+
+
+// -------------------------------------------------- //
+// bytes waiting for the firmware
+
+static uint8_t rx_buffer[UART_RX_BUFFER_SIZE];
+static uint8_t rx_head = 0;
+static uint8_t rx_tail = 0;
+
+
+// -------------------------------------------------- //
+// 1 while text was sent since the last delimiter
+
+static uint8_t tx_text = 0;
+
+
+// -------------------------------------------------- //
+// sets the receiver of the sent bytes
+
+void UARThostSetSink(void (*sink)(uint8_t c)) {
+    
+    uart_sink = sink;
+    
+}
+
+
+// -------------------------------------------------- //
+// passes one byte to the firmware as if it was received,
+// returns 0 if the buffer is full
+
+int UARThostReceive(uint8_t c) {
+    
+    uint8_t next = (rx_head + 1) & (UART_RX_BUFFER_SIZE - 1);
+    
+    if (next == rx_tail) {
+        
+        return 0;
+        
+    }
+    
+    rx_buffer[rx_head] = c;
+    rx_head = next;
+    
+    return 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// the serial port needs no setup on the host
+
+void UARTinit(void) {
+    
+}
+
+
+// -------------------------------------------------- //
+// passes one byte to the sink (without virtual time, the
+// target sends in the background as well)
+
+void UARTputc(uint8_t c) {
+    
+    if (uart_sink) {
+        
+        uart_sink(c);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// delimits text from frames (see uart.h)
+
+static void UARTbeginText(void) {
+    
+    if (!tx_text) {
+        
+        UARTputc(0x00);
+        tx_text = 1;
+        
+    }
+    
+}
+
+void UARTendText(void) {
+    
+    if (tx_text) {
+        
+        UARTputc(0x00);
+        tx_text = 0;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// sends a block of bytes
+
+void UARTwrite(const uint8_t * data, uint8_t length) {
+    
+    UARTendText();
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        UARTputc(data[i]);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// sends a string
+
+void UARTprint(const char * data) {
+    
+    UARTbeginText();
+    
+    for (int i = 0; data[i] != '\0'; i++) {
+        
+        UARTputc(data[i]);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// sends a string from flash (ordinary memory on the host)
+
+void UARTprint_P(const char * data) {
+    
+    UARTprint(data);
+    
+}
+
+
+// -------------------------------------------------- //
+// number of received bytes waiting
+
+uint8_t UARTavailable(void) {
+    
+    return (rx_head - rx_tail) & (UART_RX_BUFFER_SIZE - 1);
+    
+}
+
+
+// -------------------------------------------------- //
+// takes the next received byte
+
+uint8_t UARTgetc(void) {
+    
+    uint8_t c = rx_buffer[rx_tail];
+    
+    rx_tail = (rx_tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+    
+    return c;
+    
+}
\ No newline at end of file
@@ -2,15 +2,52 @@
 // dependencies
 
 # include <stdint.h>
+# include <string.h>
 
-# include <avr/io.h>
-# include <avr/interrupt.h>
-# include <util/delay.h>
+# include "hal.h"
 
 # include "lcd.h"
+# include "twi.h"
+# include "profile.h"
 # include "macros.h"
 
 
+// -------------------------------------------------- //
+// row addresses of the common layouts (other sizes are
+// taken as cols wide halves of a 2-line controller)
+
+typedef struct lcdGeometry {
+    
+    uint8_t rows;
+    uint8_t cols;
+    uint8_t row_offset[LCD_MAX_ROWS];
+    
+} lcdGeometry;
+
+static const lcdGeometry lcd_geometries[] PROGMEM = {
+    {1,  8, {0x00}},
+    {1, 16, {0x00}},
+    {1, 20, {0x00}},
+    {1, 40, {0x00}},
+    {2,  8, {0x00, 0x40}},
+    {2, 16, {0x00, 0x40}},
+    {2, 20, {0x00, 0x40}},
+    {2, 24, {0x00, 0x40}},
+    {2, 40, {0x00, 0x40}},
+    {4, 16, {0x00, 0x40, 0x10, 0x50}},
+    {4, 20, {0x00, 0x40, 0x14, 0x54}}
+};
+
+# define LCD_GEOMETRIES (sizeof(lcd_geometries) / sizeof(lcd_geometries[0]))
+
+
+// -------------------------------------------------- //
+// transports
+
+static const lcdTransport lcd_parallel = {LCDparallelReset, LCDparallelWrite, 0, 0};
+static const lcdTransport lcd_i2c      = {LCDi2cReset, LCDi2cWrite, LCDi2cFlush, LCDi2cRoom};
+
+
 // -------------------------------------------------- //
 // configure the LCD pins
 // 
@@ -32,6 +69,13 @@ void LCDconfig(LCD * lcd, uint8_t rs, uint8_t rw, uint8_t en,
     // timer2 pwm pin
     lcd->_v0_pin = PB4;
     
+    // parallel pins, enable pin on the same port as rs, no instruction
+    // pending, not on a bus
+    lcd->_transport = &lcd_parallel;
+    lcd->_en_port = HAL_PORTB;
+    lcd->_ready   = 0;
+    lcd->_bus     = 0;
+    
     // data bus pins
     lcd->_data_bus[0] = d0;
     lcd->_data_bus[1] = d1;
@@ -45,6 +89,45 @@ void LCDconfig(LCD * lcd, uint8_t rs, uint8_t rw, uint8_t en,
 }
 
 
+// -------------------------------------------------- //
+// configure an LCD on a PCF8574 I2C backpack (7-bit
+// address, see LCD_I2C_ADDRESS) instead of parallel pins
+//
+// TWIinit has to be called first, LCDinit needs 4 bits
+// and no pwm contrast (the backpack has a potentiometer),
+// the rw pin is not used, so the display is not read back
+
+void LCDconfigI2C(LCD * lcd, uint8_t address) {
+    
+    LCDconfig(lcd, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0, 0);
+    
+    lcd->_transport     = &lcd_i2c;
+    lcd->_i2c_address   = address;
+    lcd->_i2c_backlight = (1 << LCD_I2C_BACKLIGHT);
+    lcd->_i2c_output    = 0xFF;
+    
+}
+
+
+// -------------------------------------------------- //
+// sends bits during the initialization, the wait before
+// the next step starts once they reached the panel
+
+static void LCDinitTransfer(LCD * lcd, uint8_t bits, uint8_t width, uint16_t wait) {
+    
+    lcd->_transport->write(lcd, bits, 0, width);
+    
+    if (lcd->_transport->flush) {
+        
+        lcd->_transport->flush(lcd);
+        
+    }
+    
+    lcd->_ready = HALmicros() + wait;
+    
+}
+
+
 // -------------------------------------------------- //
 // initialize the LCD
 // 
@@ -55,15 +138,35 @@ void LCDconfig(LCD * lcd, uint8_t rs, uint8_t rw, uint8_t en,
 // standard text direction (left to right)
 // no display shift
 // small characters (5x8dot)
+//
+// the busy windows are timed with HALmicros, so the timer
+// has to run (HALtimerInit)
 
 void LCDinit(LCD * lcd, uint8_t data_bus_length, uint8_t rows, 
              uint8_t cols, uint8_t pwm_contrast) {
     
+    LCDinitBegin(lcd, data_bus_length, rows, cols, pwm_contrast);
+    
+    while (!LCDinitService(lcd)) {
+        
+        hal_delay_us(1);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// starts the initialization without waiting, the power on
+// wait (LCD_POWERON_US) is counted from here and the
+// instructions are sent by LCDinitService, so other
+// peripherals can be set up in the meantime
+
+void LCDinitBegin(LCD * lcd, uint8_t data_bus_length, uint8_t rows, 
+                  uint8_t cols, uint8_t pwm_contrast) {
+    
     // number of lines and columns, and addresses of the first column in each row
-    lcd->_rows = rows;
-    lcd->_cols = cols;
-    lcd->_row_offset[0] = 0x00;
-    lcd->_row_offset[1] = 0x40;
+    LCDsetGeometry(lcd, rows, cols);
     
     // commands without parameters
     lcd->_entrymode       = MASK_ENTRYMODESET;
@@ -73,6 +176,7 @@ void LCDinit(LCD * lcd, uint8_t data_bus_length, uint8_t rows,
     // displaymode default settings
     lcd->_entrymode |= FLAG_ENTRY_SHIFTCURSORRIGHT;
     lcd->_entrymode &= FLAG_ENTRY_NOAUTOSHIFT;
+    lcd->_wrap = 1;
     
     // displaycontrol default settings
     lcd->_displaycontrol |= FLAG_DISPLAYCONTROL_DISPLAYON;
@@ -115,61 +219,198 @@ void LCDinit(LCD * lcd, uint8_t data_bus_length, uint8_t rows,
     
     // initialize according to the datasheet (page 45-46)
     // first wait for more than 40ms
-    _delay_ms(50);
+    lcd->_init_step = 0;
+    lcd->_ready     = HALmicros() + LCD_POWERON_US;
     
-    // pull rs and en pins low, also rw pin if applicable
-    clear_io_bit(PORTB, lcd->_en_pin);
-    clear_io_bit(PORTB, lcd->_rs_pin);
-    if (lcd->_rw_pin != 0xFF) {clear_io_bit(PORTB, lcd->_rw_pin);}
+    // send pwm signal via timer2 to control contrast if flag is set (pin 11 / B4)
+    if (pwm_contrast == 1) {
+        
+        // initialize timer2 in non-inverting fast pwm mode
+        hal_gpio_dir(HAL_PORTB, PB3, 1);
+        TCCR2A = (1 << COM2A1) | (1 << WGM21) | (1 << WGM20);
+        TCCR2B = (1 << CS20);
+        OCR2A  = LCD_DEFAULT_CONTRAST;
+        
+    }
     
-    // enter 4- or 8-bit mode
-    switch (data_bus_length) {
+}
+
+
+// -------------------------------------------------- //
+// sends the next instruction of the initialization once
+// the wait before it passed, returns 1 when the LCD is
+// ready for use
+//
+// in 4-bit mode only the 4 msb of the function sets that
+// enter 8-bit mode are sent, then the one for 4-bit mode
+
+uint8_t LCDinitService(LCD * lcd) {
+    
+    uint8_t eightbit = (lcd->_displayfunction & FLAG_FUNCTIONSET_8BITBUS) != 0;
+    uint8_t bits     = eightbit ? (MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS) : ((MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS) >> 4);
+    uint8_t width    = eightbit ? 8 : 4;
+    
+    if (lcd->_init_step == LCD_INIT_DONE) {
+        
+        return 1;
+        
+    }
+    
+    if (!LCDready(lcd)) {
+        
+        return 0;
+        
+    }
     
+    switch (lcd->_init_step) {
+        
+        // pull rs and en pins low, also rw pin if applicable, then
+        // enter 8-bit mode 3 times
+        case 0:
+            
+            lcd->_transport->reset(lcd);
+            LCDinitTransfer(lcd, bits, width, LCD_INIT_US);
+            break;
+            
+        case 1:
+            
+            LCDinitTransfer(lcd, bits, width, eightbit ? LCD_INIT_SHORT_US : LCD_INIT_US);
+            break;
+            
+        case 2:
+            
+            LCDinitTransfer(lcd, bits, width, eightbit ? LCD_BUSY_US : LCD_INIT_SHORT_US);
+            break;
+            
+        // then enter 4-bit mode
+        case 3:
+            
+            if (!eightbit) {
+                
+                LCDinitTransfer(lcd, ((MASK_FUNCTIONSET & FLAG_FUNCTIONSET_4BITBUS) >> 4), 4, LCD_BUSY_US);
+                
+            }
+            
+            break;
+            
+        // 4- or 8-bit mode cannot be changed anymore, set the remaining settings
         case 4:
             
-            // for 4-bit mode, send the 4 msb of the command to enter 8-bit mode 3 times
-            LCDsend4bit(lcd, ((MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS) >> 4));
-            _delay_ms(5);
-            LCDsend4bit(lcd, ((MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS) >> 4));
-            _delay_ms(5);
-            LCDsend4bit(lcd, ((MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS) >> 4));
-            _delay_us(200);
+            LCDcommand(lcd, lcd->_displayfunction);
+            break;
             
-            // then send the command to enter 4-bit mode
-            LCDsend4bit(lcd, ((MASK_FUNCTIONSET & FLAG_FUNCTIONSET_4BITBUS) >> 4));
+        case 5:
             
+            LCDcommand(lcd, lcd->_displaycontrol);
+            break;
+            
+        case 6:
+            
+            LCDclearDisplay(lcd);
             break;
             
         default:
             
-            // for 8-bit mode, send the command to enter 8-bit mode 3 times
-            LCDsend8bit(lcd, (MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS));
-            _delay_ms(5);
-            LCDsend8bit(lcd, (MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS));
-            _delay_us(200);
-            LCDsend8bit(lcd, (MASK_FUNCTIONSET | FLAG_FUNCTIONSET_8BITBUS));
+            LCDcommand(lcd, lcd->_entrymode);
+            break;
+            
+    }
+    
+    lcd->_init_step++;
+    
+    return lcd->_init_step == LCD_INIT_DONE;
+    
+}
+
+
+// -------------------------------------------------- //
+// looks up the address of each row and which rows the
+// controller continues by itself (rows = 1-4)
+//
+// the address counter steps from 0x27 to 0x40 and from 0x67
+// to 0x00 in 2-line mode, and from 0x4F to 0x00 in 1-line
+// mode, so e.g. the rows of a 40x2 panel continue each
+// other while the first row of a 20x4 panel continues in the
+// third one
+
+void LCDsetGeometry(LCD * lcd, uint8_t rows, uint8_t cols) {
+    
+    lcdGeometry geometry;
+    uint8_t last;
+    uint8_t next;
+    uint8_t i;
+    
+    if (rows > LCD_MAX_ROWS) {
+        
+        rows = LCD_MAX_ROWS;
+        
+    }
+    
+    for (i = 0; i < LCD_GEOMETRIES; i++) {
+        
+        memcpy_P(&geometry, &lcd_geometries[i], sizeof(geometry));
+        
+        if (geometry.rows == rows && geometry.cols == cols) {
             
             break;
             
+        }
+        
     }
     
-    // 4- or 8-bit mode cannot be changed anymore, set the remaining settings
-    LCDcommand(lcd, lcd->_displayfunction);
-    LCDcommand(lcd, lcd->_displaycontrol);
-    LCDclearDisplay(lcd);
-    LCDcommand(lcd, lcd->_entrymode);
+    if (i == LCD_GEOMETRIES) {
+        
+        geometry.row_offset[0] = 0x00;
+        geometry.row_offset[1] = 0x40;
+        geometry.row_offset[2] = cols;
+        geometry.row_offset[3] = 0x40 + cols;
+        
+    }
     
-    // send pwm signal via timer2 to control contrast if flag is set (pin 11 / B4)
-    if (pwm_contrast == 1) {
+    lcd->_rows          = rows;
+    lcd->_cols          = cols;
+    lcd->_row_continues = 0;
+    
+    for (i = 0; i < rows; i++) {
         
-        // initialize timer2 in non-inverting fast pwm mode
-        set_io_bit(DDRB, PB3);
-        TCCR2A = (1 << COM2A1) | (1 << WGM21) | (1 << WGM20);
-        TCCR2B = (1 << CS20);
-        OCR2A  = 85;
+        lcd->_row_address[i] = MASK_SETDDRAMADDR | geometry.row_offset[i];
+        
+        // address after the last column, as the controller steps it
+        last = geometry.row_offset[i] + cols - 1;
+        
+        if (rows == 1) {
+            
+            next = (last == 0x4F) ? 0x00 : last + 1;
+            
+        } else {
+            
+            next = (last == 0x27) ? 0x40 : (last == 0x67) ? 0x00 : last + 1;
+            
+        }
+        
+        if (next == geometry.row_offset[(i + 1) % rows]) {
+            
+            lcd->_row_continues |= (1 << i);
+            
+        }
         
     }
     
+    lcd->_cursor_row = 0;
+    lcd->_cursor_col = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// moves the enable pin to another port, e.g. for a second
+// panel on the same bus (call after LCDconfig)
+
+void LCDsetEnablePin(LCD * lcd, uint8_t port, uint8_t en) {
+    
+    lcd->_en_port = port;
+    lcd->_en_pin  = en;
+    
 }
 
 
@@ -189,7 +430,7 @@ void LCDpwmSetContrast(LCD * lcd, uint8_t contrast) {
 void LCDclearDisplay(LCD * lcd) {
     
     LCDcommand(lcd, MASK_CLEARDISPLAY);
-    _delay_ms(2);
+    LCDtrackCursor(lcd, 0, 0);
     
 }
 
@@ -200,7 +441,7 @@ void LCDclearDisplay(LCD * lcd) {
 void LCDreturnHome(LCD * lcd) {
     
     LCDcommand(lcd, MASK_RETURNHOME);
-    _delay_ms(2);
+    LCDtrackCursor(lcd, 0, 0);
     
 }
 
@@ -223,6 +464,7 @@ void LCDtextRightToLeft(LCD * lcd) {
     
     lcd->_entrymode &= FLAG_ENTRY_SHIFTCURSORLEFT;
     LCDcommand(lcd, lcd->_entrymode);
+    lcd->_cursor_col = LCD_COL_UNKNOWN;
     
 }
 
@@ -235,6 +477,7 @@ void LCDautoShiftOn(LCD * lcd) {
     
     lcd->_entrymode |= FLAG_ENTRY_AUTOSHIFT;
     LCDcommand(lcd, lcd->_entrymode);
+    lcd->_cursor_col = LCD_COL_UNKNOWN;
     
 }
 
@@ -250,6 +493,32 @@ void LCDautoShiftOff(LCD * lcd) {
 }
 
 
+// -------------------------------------------------- //
+// text that reaches the end of a row continues at the
+// start of the next row on the panel (default)
+//
+// only while the text goes from left to right without
+// auto shift, and only for LCDcharacter/LCDprint after the
+// cursor was placed (LCDsetCursorPosition, clear or home)
+
+void LCDwrapOn(LCD * lcd) {
+    
+    lcd->_wrap = 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// text continues at the next DDRAM address, e.g. for
+// writing past the visible area and shifting the display
+
+void LCDwrapOff(LCD * lcd) {
+    
+    lcd->_wrap = 0;
+    
+}
+
+
 // -------------------------------------------------- //
 // turn display on
 
@@ -360,8 +629,26 @@ void LCDshiftDisplayRight(LCD * lcd) {
 
 // -------------------------------------------------- //
 // create a custom character
+//
+// location = 0-7 (shown with character code 0-7 or 8-15),
+// pattern  = 8 rows of 5 pixels, top row first
+//
+// the address counter is left in CGRAM, so set the cursor
+// position before writing text again
 
-void LCDcustomCharacter(); // TBD
+void LCDcustomCharacter(LCD * lcd, uint8_t location, const uint8_t * pattern) {
+    
+    LCDcommand(lcd, MASK_SETCGRAMADDR | ((location & 0x07) << 3));
+    
+    for (uint8_t i = 0; i < 8; i++) {
+        
+        LCDsend(lcd, pattern[i] & 0x1F, 1);
+        
+    }
+    
+    lcd->_cursor_col = LCD_COL_UNKNOWN;
+    
+}
 
 
 // -------------------------------------------------- //
@@ -390,7 +677,26 @@ void LCDsetCursorPosition(LCD * lcd, uint8_t target_row, uint8_t target_col) {
         
     }
     
-    LCDcommand(lcd, MASK_SETDDRAMADDR | (lcd->_row_offset[target_row] + target_col));
+    LCDcommand(lcd, lcd->_row_address[target_row] + target_col);
+    LCDtrackCursor(lcd, target_row, target_col);
+    
+}
+
+
+// -------------------------------------------------- //
+// remembers where the next character goes, as long as the
+// address counter moves to the right one cell per character
+
+void LCDtrackCursor(LCD * lcd, uint8_t row, uint8_t col) {
+    
+    lcd->_cursor_row = row;
+    lcd->_cursor_col = col;
+    
+    if ((lcd->_entrymode & (FLAG_ENTRY_SHIFTCURSORRIGHT | FLAG_ENTRY_AUTOSHIFT)) != FLAG_ENTRY_SHIFTCURSORRIGHT) {
+        
+        lcd->_cursor_col = LCD_COL_UNKNOWN;
+        
+    }
     
 }
 
@@ -407,11 +713,50 @@ void LCDcommand(LCD * lcd, uint8_t command) {
 
 // -------------------------------------------------- //
 // sends a character to the LCD
+//
+// after the last column the cursor is moved to the next row
+// (only when the next character follows, so text that ends
+// at the edge costs nothing), unless the controller gets
+// there by itself
 
 void LCDcharacter(LCD * lcd, uint8_t data) {
     
+    uint8_t row;
+    
+    if (lcd->_cursor_col == lcd->_cols) {
+        
+        row = lcd->_cursor_row + 1;
+        
+        if (row == lcd->_rows) {
+            
+            row = 0;
+            
+        }
+        
+        if (!lcd->_wrap) {
+            
+            lcd->_cursor_col = LCD_COL_UNKNOWN;
+            
+        } else if (lcd->_row_continues & (1 << lcd->_cursor_row)) {
+            
+            LCDtrackCursor(lcd, row, 0);
+            
+        } else {
+            
+            LCDsetCursorPosition(lcd, row, 0);
+            
+        }
+        
+    }
+    
     LCDsend(lcd, data, 1);
     
+    if (lcd->_cursor_col < lcd->_cols) {
+        
+        lcd->_cursor_col++;
+        
+    }
+    
 }
 
 
@@ -429,59 +774,360 @@ void LCDprint(LCD * lcd, char * data) {
 }
 
 
+// -------------------------------------------------- //
+// prints a string from flash (PSTR or PROGMEM)
+
+void LCDprint_P(LCD * lcd, const char * data) {
+    
+    char c;
+    
+    while ((c = pgm_read_byte(data++)) != '\0') {
+        
+        LCDcharacter(lcd, c);
+        
+    }
+    
+}
+
+
 // -------------------------------------------------- //
 // sends a 1 byte message of type (command/data) to 
-// the LCD and automatically picks the right mode (4-
-// or 8-bit)
+// the LCD, or queues it if the LCD is on a shared bus
 
 void LCDsend(LCD * lcd, uint8_t message, uint8_t type) {
     
-    // set the rs pin 
-    switch (type) {
+    PROFILE_BEGIN(PROF_LCDSEND);
+    
+    LCDbus * bus = lcd->_bus;
+    uint8_t slot = lcd->_slot;
+    uint8_t head;
+    uint8_t next;
+    
+    if (bus) {
         
-        // command
-        case 0:
-            
-            clear_io_bit(PORTB, lcd->_rs_pin);
-            
-            break;
+        head = bus->_head[slot];
+        next = (head + 1) & (LCD_QUEUE_SIZE - 1);
         
-        // data
-        case 1:
+        // queue full, let the bus send until there is room
+        while (next == bus->_tail[slot]) {
             
-            set_io_bit(PORTB, lcd->_rs_pin);
-            
-            break;
+            LCDbusService(bus);
             
+        }
+        
+        bus->_queue[slot][head] = message;
+        bus->_queue_rs[slot] = (bus->_queue_rs[slot] & ~(1UL << head)) | ((uint32_t) (type & 1) << head);
+        bus->_head[slot] = next;
+        
+    } else {
+        
+        LCDtransmit(lcd, message, type);
+        
     }
     
-    // pull the rw pin low if applicable
-    if (lcd->_rw_pin != 0xFF) {
+    PROFILE_END(PROF_LCDSEND);
+    
+}
+
+
+// -------------------------------------------------- //
+// bytes that can be sent before a queue is full and the
+// sender has to wait: the queue of the shared bus or of
+// the transport (0xFF if the bytes go out right away)
+
+uint8_t LCDroom(LCD * lcd) {
     
-        clear_io_bit(PORTB, lcd->_rw_pin);
+    LCDbus * bus = lcd->_bus;
     
+    if (bus) {
+        
+        return (bus->_tail[lcd->_slot] - bus->_head[lcd->_slot] - 1) & (LCD_QUEUE_SIZE - 1);
+        
+    }
+    
+    return lcd->_transport->room ? lcd->_transport->room(lcd) : 0xFF;
+    
+}
+
+
+// -------------------------------------------------- //
+// returns 1 if the busy window of the last instruction
+// has passed
+
+uint8_t LCDready(LCD * lcd) {
+    
+    return (int32_t) (HALmicros() - lcd->_ready) >= 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// waits for the busy window of the last instruction,
+// then puts the byte on the bus and automatically picks
+// the right mode (4- or 8-bit)
+
+void LCDtransmit(LCD * lcd, uint8_t message, uint8_t type) {
+    
+    // only this panel has to be idle, the bus is free
+    while (!LCDready(lcd)) {
+        
+        hal_delay_us(1);
+        
     }
     
     // send the data depending on bus width
     switch (lcd->_displayfunction & FLAG_FUNCTIONSET_8BITBUS) {
         
-        // 4 bit bus
+        // 4 bit bus, 4 msb first
         case 0:
             
-            // send 4 msb first
-            LCDsend4bit(lcd, (message >> 4));
-            // send 4 lsb last
-            LCDsend4bit(lcd, message);
+            lcd->_transport->write(lcd, (message >> 4), type, 4);
+            lcd->_transport->write(lcd, (message & 0x0F), type, 4);
             break;
         
         // 8 bit bus
         default:
             
-            LCDsend8bit(lcd, message);
+            lcd->_transport->write(lcd, message, type, 8);
             break;
             
     }
     
+    // clear display and return home take much longer
+    // (counted from when the instruction reached the panel)
+    if (type == 0 && (message == MASK_CLEARDISPLAY || (message & ~1) == MASK_RETURNHOME)) {
+        
+        if (lcd->_transport->flush) {
+            
+            lcd->_transport->flush(lcd);
+            
+        }
+        
+        lcd->_ready = HALmicros() + LCD_HOME_US;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// reads the address counter (busy flag masked), only
+// with the rw pin wired
+
+uint8_t LCDreadAddress(LCD * lcd) {
+    
+    return LCDreceive(lcd, 0) & 0x7F;
+    
+}
+
+
+// -------------------------------------------------- //
+// reads the character at the address counter, which then
+// moves on like after a write (set the address first)
+
+uint8_t LCDreadCharacter(LCD * lcd) {
+    
+    uint8_t data = LCDreceive(lcd, 1);
+    
+    if (lcd->_cursor_col < lcd->_cols) {
+        
+        lcd->_cursor_col++;
+        
+    }
+    
+    return data;
+    
+}
+
+
+// -------------------------------------------------- //
+// reads one byte of type (0 = busy flag and address,
+// 1 = data), returns 0 if the rw pin is not wired
+//
+// queued bytes of a shared bus are sent first, then the
+// data pins are released for the time of the read
+
+uint8_t LCDreceive(LCD * lcd, uint8_t type) {
+    
+    uint8_t width = (lcd->_displayfunction & FLAG_FUNCTIONSET_8BITBUS) ? 8 : 4;
+    uint8_t data = 0;
+    uint8_t nibble;
+    
+    if (lcd->_rw_pin == 0xFF) {
+        
+        return 0;
+        
+    }
+    
+    if (lcd->_bus) {
+        
+        LCDbusFlush(lcd->_bus);
+        
+    }
+    
+    while (!LCDready(lcd)) {
+        
+        hal_delay_us(1);
+        
+    }
+    
+    // data pins as inputs without pull-ups
+    for (uint8_t i = 0; i < width; i++) {
+        
+        hal_gpio_dir(HAL_PORTD, lcd->_data_bus[i], 0);
+        hal_gpio_clear(HAL_PORTD, lcd->_data_bus[i]);
+        
+    }
+    
+    hal_gpio_write(HAL_PORTB, lcd->_rs_pin, type);
+    hal_gpio_set(HAL_PORTB, lcd->_rw_pin);
+    
+    // one byte, or the high and then the low nibble
+    for (uint8_t part = 0; part < 8 / width; part++) {
+        
+        // the data is valid 360 ns after enable goes high
+        hal_gpio_set(lcd->_en_port, lcd->_en_pin);
+        hal_delay_us(1);
+        
+        nibble = 0;
+        
+        for (uint8_t i = 0; i < width; i++) {
+            
+            nibble |= hal_gpio_read(HAL_PORTD, lcd->_data_bus[i]) << i;
+            
+        }
+        
+        hal_gpio_clear(lcd->_en_port, lcd->_en_pin);
+        hal_delay_us(1);
+        
+        data = (width == 8) ? nibble : (data << 4) | nibble;
+        
+    }
+    
+    hal_gpio_clear(HAL_PORTB, lcd->_rw_pin);
+    
+    for (uint8_t i = 0; i < width; i++) {
+        
+        hal_gpio_dir(HAL_PORTD, lcd->_data_bus[i], 1);
+        
+    }
+    
+    // a data read moves the address counter, which takes as long as a write
+    if (type == 1) {
+        
+        lcd->_ready = HALmicros() + LCD_BUSY_US;
+        
+    }
+    
+    return data;
+    
+}
+
+
+// -------------------------------------------------- //
+// parallel pins: rs, rw and enable low
+
+void LCDparallelReset(LCD * lcd) {
+    
+    hal_gpio_clear(lcd->_en_port, lcd->_en_pin);
+    hal_gpio_clear(HAL_PORTB, lcd->_rs_pin);
+    if (lcd->_rw_pin != 0xFF) {hal_gpio_clear(HAL_PORTB, lcd->_rw_pin);}
+    
+}
+
+
+// -------------------------------------------------- //
+// parallel pins: sets rs (and rw low), then the data pins
+// and pulses enable
+
+void LCDparallelWrite(LCD * lcd, uint8_t bits, uint8_t rs, uint8_t width) {
+    
+    hal_gpio_write(HAL_PORTB, lcd->_rs_pin, rs);
+    
+    // pull the rw pin low if applicable
+    if (lcd->_rw_pin != 0xFF) {
+    
+        hal_gpio_clear(HAL_PORTB, lcd->_rw_pin);
+    
+    }
+    
+    if (width == 4) {
+        
+        LCDsend4bit(lcd, bits);
+        
+    } else {
+        
+        LCDsend8bit(lcd, bits);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// I2C backpack: everything low but the backlight
+
+void LCDi2cReset(LCD * lcd) {
+    
+    lcd->_i2c_output = lcd->_i2c_backlight;
+    TWIwrite(lcd->_i2c_address, &lcd->_i2c_output, 1);
+    
+}
+
+
+// -------------------------------------------------- //
+// I2C backpack: queues the nibble with enable high and low
+// (only 4-bit, the expander has 4 data lines), a changed rs
+// goes out first with enable low
+//
+// the panel is not waited for (_ready), the bus spaces the
+// instructions: the first nibble of the next one latches at
+// least two bytes (18 clocks) after the last one, which has to
+// cover LCD_BUSY_US
+
+# if 18000000UL / TWI_FREQ < LCD_BUSY_US
+# error "TWI_FREQ is too fast for the busy window of the LCD on the I2C backpack"
+# endif
+
+void LCDi2cWrite(LCD * lcd, uint8_t bits, uint8_t rs, uint8_t width) {
+    
+    uint8_t data[3];
+    uint8_t length = 0;
+    uint8_t output = ((bits & 0x0F) << 4) | (rs << LCD_I2C_RS) | lcd->_i2c_backlight;
+    
+    if ((lcd->_i2c_output ^ output) & (1 << LCD_I2C_RS)) {
+        
+        data[length++] = (lcd->_i2c_output & 0xF0) | (rs << LCD_I2C_RS) | lcd->_i2c_backlight;
+        
+    }
+    
+    data[length++] = output | (1 << LCD_I2C_EN);
+    data[length++] = output;
+    
+    TWIwrite(lcd->_i2c_address, data, length);
+    lcd->_i2c_output = output;
+    
+}
+
+
+// -------------------------------------------------- //
+// I2C backpack: waits for the TWI queue
+
+void LCDi2cFlush(LCD * lcd) {
+    
+    TWIflush();
+    
+}
+
+
+// -------------------------------------------------- //
+// I2C backpack: LCD bytes that fit in the TWI queue (two
+// nibbles of two expander bytes, one more for rs)
+
+uint8_t LCDi2cRoom(LCD * lcd) {
+    
+    return TWIroom() / 5;
+    
 }
 
 
@@ -494,7 +1140,7 @@ void LCDsend8bit(LCD * lcd, uint8_t message) {
     // the right i times and then & with 1 (0b00000001)
     for (int i = 0; i < 8; i++) {
                 
-                change_io_bit(PORTD, lcd->_data_bus[i], ((message >> i) & 1));
+                hal_gpio_write(HAL_PORTD, lcd->_data_bus[i], ((message >> i) & 1));
                 
     }
 
@@ -511,7 +1157,7 @@ void LCDsend4bit(LCD * lcd, uint8_t message) {
     // see LCDsend8bit for explanation
     for (int i = 0; i < 4; i++) {
                 
-                change_io_bit(PORTD, lcd->_data_bus[i], ((message >> i) & 1));
+                hal_gpio_write(HAL_PORTD, lcd->_data_bus[i], ((message >> i) & 1));
                 
     }
 
@@ -525,16 +1171,123 @@ void LCDsend4bit(LCD * lcd, uint8_t message) {
 
 void LCDbeginTransfer(LCD * lcd) {
     
+    PROFILE_BEGIN(PROF_LCDBEGINTRANSFER);
+    
     // 1. pull the pin low and wait for the LCD
-    clear_io_bit(PORTB, lcd->_en_pin);
-    _delay_us(1);
+    hal_gpio_clear(lcd->_en_port, lcd->_en_pin);
+    hal_delay_us(1);
     
     // 2. pull it high, the enable pulse needs to be >450ns
-    set_io_bit(PORTB, lcd->_en_pin);
-    _delay_us(1);
+    hal_gpio_set(lcd->_en_port, lcd->_en_pin);
+    hal_delay_us(1);
+    
+    // 3. pull it low again, the LCD is busy for >37 us (waited for
+    // before the next byte, see LCDtransmit, the second nibble of a
+    // byte can follow right away)
+    hal_gpio_clear(lcd->_en_port, lcd->_en_pin);
+    lcd->_ready = HALmicros() + LCD_BUSY_US;
+    
+    PROFILE_END(PROF_LCDBEGINTRANSFER);
+    
+}
+
+
+// -------------------------------------------------- //
+// initialize a bus without panels
+
+void LCDbusInit(LCDbus * bus) {
+    
+    bus->_count    = 0;
+    bus->_next     = 0;
+    bus->transfers = 0;
+    bus->waits     = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// adds an initialized panel, from now on its bytes are
+// queued until LCDbusService sends them
+
+void LCDbusAttach(LCDbus * bus, LCD * lcd) {
+    
+    if (bus->_count == LCD_BUS_PANELS) {
+        
+        return;
+        
+    }
+    
+    bus->_head[bus->_count] = 0;
+    bus->_tail[bus->_count] = 0;
+    lcd->_slot = bus->_count;
+    lcd->_bus  = bus;
+    bus->_panels[bus->_count++] = lcd;
+    
+}
+
+
+// -------------------------------------------------- //
+// sends the next queued byte of every panel that is not
+// busy (starting with a different panel on every call),
+// returns the number of bytes still queued
+
+uint8_t LCDbusService(LCDbus * bus) {
+    
+    uint8_t slot;
+    uint8_t tail;
+    uint8_t pending = 0;
+    uint8_t sent = 0;
+    
+    if (bus->_count == 0) {
+        
+        return 0;
+        
+    }
+    
+    for (uint8_t i = 0; i < bus->_count; i++) {
+        
+        slot = (bus->_next + i) % bus->_count;
+        tail = bus->_tail[slot];
+        
+        if (bus->_head[slot] == tail) {
+            
+            continue;
+            
+        }
+        
+        if (LCDready(bus->_panels[slot])) {
+            
+            LCDtransmit(bus->_panels[slot], bus->_queue[slot][tail], (bus->_queue_rs[slot] >> tail) & 1);
+            bus->_tail[slot] = (tail + 1) & (LCD_QUEUE_SIZE - 1);
+            bus->transfers++;
+            sent++;
+            
+        }
+        
+        pending += (bus->_head[slot] - bus->_tail[slot]) & (LCD_QUEUE_SIZE - 1);
+        
+    }
+    
+    bus->_next = (bus->_next + 1) % bus->_count;
+    
+    // every panel is busy, wait a bit before polling again
+    if (pending && !sent) {
+        
+        bus->waits++;
+        hal_delay_us(1);
+        
+    }
+    
+    return pending;
+    
+}
+
+
+// -------------------------------------------------- //
+// sends everything that is queued
+
+void LCDbusFlush(LCDbus * bus) {
     
-    // 3. pull it low again and wait for the LCD (>37 us)
-    clear_io_bit(PORTB, lcd->_en_pin);
-    _delay_us(100);
+    while (LCDbusService(bus));
     
 }
\ No newline at end of file
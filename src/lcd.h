@@ -14,6 +14,97 @@
 # define DB7 7
 
 
+// ------------------------------------------------------------ //
+// contrast set by LCDinit (timer2 pwm duty cycle)
+
+# define LCD_DEFAULT_CONTRAST 85
+
+
+// ------------------------------------------------------------ //
+// display geometry
+//
+// one controller addresses 80 DDRAM cells, in 2-line mode as
+// 0x00-0x27 and 0x40-0x67, and 4-line panels are 2-line panels
+// cut in half: the third row continues the first one and the
+// fourth row the second one
+//
+//   16x2  0x00 0x40
+//   16x4  0x00 0x40 0x10 0x50
+//   20x4  0x00 0x40 0x14 0x54
+//   40x2  0x00 0x40
+//
+// the address of every row is looked up once by LCDinit (see
+// lcd_geometries in lcd.c), text that runs past the end of a row
+// continues in the next row on the panel, not at the next DDRAM
+// address (see LCDwrapOn)
+
+# define LCD_MAX_ROWS         4
+
+// column of a cursor that is not tracked (CGRAM selected, text
+// right to left or auto shift)
+# define LCD_COL_UNKNOWN      0xFF
+
+
+// ------------------------------------------------------------ //
+// busy windows (us) after an instruction, nothing is sent to the
+// same panel before they passed (37 us / 1.52 ms at 270 kHz, with
+// margin for slower oscillators and the 4 us timer resolution)
+
+# define LCD_BUSY_US          60
+# define LCD_HOME_US          2000
+
+
+// ------------------------------------------------------------ //
+// waits of the initialization by instruction (datasheet page 46):
+// power on (>40 ms after Vcc reached 4.5 V, counted from
+// LCDinitBegin, boards whose fuses already delay the reset long
+// enough may lower it), then >4.1 ms and >100 us between the first
+// function sets
+
+# ifndef LCD_POWERON_US
+# define LCD_POWERON_US       50000UL
+# endif
+
+# define LCD_INIT_US          5000
+# define LCD_INIT_SHORT_US    200
+
+// step of the initialization once it is complete
+# define LCD_INIT_DONE        8
+
+
+// ------------------------------------------------------------ //
+// panels sharing RS, RW and the data lines (each has its own
+// enable pin)
+//
+// panels attached to a bus queue their transfers instead of
+// sending them, LCDbusService then sends one byte to every panel
+// that is not busy, so while one panel executes an instruction
+// the bytes of the others are already on the bus
+
+// number of panels and queued transfers per panel (power of 2, <= 32)
+# define LCD_BUS_PANELS       4
+# define LCD_QUEUE_SIZE       32
+
+
+// ------------------------------------------------------------ //
+// PCF8574 I2C backpack (LCDconfigI2C), bits of the expander and
+// its default address (0x3F for the PCF8574A)
+//
+// a nibble takes two I2C bytes, the data with enable high and
+// then with enable low, the controller latches it on the falling
+// edge (one more byte when rs changes, so it is set up before
+// enable rises), the bytes are streamed by the TWI interrupt and
+// the two bytes of the next nibble have to cover LCD_BUSY_US, at
+// the 100 kHz the PCF8574 is rated for they take 180 us (lcd.c
+// does not build with a TWI_FREQ above 300 kHz)
+
+# define LCD_I2C_ADDRESS      0x27
+# define LCD_I2C_RS           0
+# define LCD_I2C_RW           1
+# define LCD_I2C_EN           2
+# define LCD_I2C_BACKLIGHT    3
+
+
 // ------------------------------------------------------------ //
 // masks and flags for the LCD commands (DB7-0)
 
@@ -56,6 +147,29 @@
 # define FLAG_FUNCTIONSET_5x8DOT    ~(1 << DB2)
 
 
+// ------------------------------------------------------------ //
+// transport that carries the nibbles or bytes to the panel
+//
+// reset: pulls rs, rw and enable low before the initialization
+// write: puts width (4 or 8) bits and rs on the bus and pulses
+//        enable
+// flush: returns once everything written reached the panel
+//        (0 if write does not return before)
+// room:  number of LCD bytes write takes without waiting
+//        (0 if it does not queue them)
+
+struct LCD;
+
+typedef struct lcdTransport {
+    
+    void (*reset)(struct LCD * lcd);
+    void (*write)(struct LCD * lcd, uint8_t bits, uint8_t rs, uint8_t width);
+    void (*flush)(struct LCD * lcd);
+    uint8_t (*room)(struct LCD * lcd);
+    
+} lcdTransport;
+
+
 // ------------------------------------------------------------ //
 // struct for storing information about the pins and settings
 
@@ -68,19 +182,71 @@ typedef struct LCD {
     uint8_t _v0_pin;
     uint8_t _data_bus[8];
     
+    // parallel pins or I2C backpack (address, backlight bit and the
+    // last byte written to the expander)
+    const lcdTransport * _transport;
+    uint8_t _i2c_address;
+    uint8_t _i2c_backlight;
+    uint8_t _i2c_output;
+    
     // commands to send upon initializing
     uint8_t _entrymode;
     uint8_t _displaycontrol;
     uint8_t _displayfunction;
     
-    // display dimensions
+    // display dimensions, set DDRAM address command of the first
+    // column of each row, and bit per row if the controller moves
+    // on to the next row by itself after the last column
     uint8_t _rows;
     uint8_t _cols;
-    uint8_t _row_offset[8];
+    uint8_t _row_address[LCD_MAX_ROWS];
+    uint8_t _row_continues;
+    
+    // cursor position and line wrapping
+    uint8_t _cursor_row;
+    uint8_t _cursor_col;
+    uint8_t _wrap;
+    
+    // port of the enable pin (HAL_PORTB unless set by LCDsetEnablePin)
+    uint8_t _en_port;
+    
+    // end of the busy window of the last instruction (HALmicros), and
+    // the next step of the initialization
+    uint32_t _ready;
+    uint8_t _init_step;
+    
+    // shared bus (0 = bytes are sent right away) and the index of the
+    // queue of the panel in it
+    struct LCDbus * _bus;
+    uint8_t _slot;
     
 } LCD;
 
 
+// ------------------------------------------------------------ //
+// struct for storing the panels of a shared bus and their queued
+// bytes (kept here so a panel that is not on a bus does not pay
+// for them)
+
+typedef struct LCDbus {
+    
+    LCD * _panels[LCD_BUS_PANELS];
+    uint8_t _count;
+    uint8_t _next;
+    
+    // queued bytes of every panel (with one rs bit per entry)
+    uint8_t _queue[LCD_BUS_PANELS][LCD_QUEUE_SIZE];
+    uint32_t _queue_rs[LCD_BUS_PANELS];
+    uint8_t _head[LCD_BUS_PANELS];
+    uint8_t _tail[LCD_BUS_PANELS];
+    
+    // bytes sent and passes in which every panel with queued bytes was busy
+    uint32_t transfers;
+    uint32_t waits;
+    
+} LCDbus;
+
+
 // ------------------------------------------------------------ //
 // initialization and configuration of the LCD
 
@@ -89,6 +255,21 @@ void LCDconfig(LCD * lcd, uint8_t rs, uint8_t rw, uint8_t en,
                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7);
 void LCDinit(LCD * lcd, uint8_t data_bus_length, uint8_t rows, 
              uint8_t cols, uint8_t pwm_contrast);
+void LCDinitBegin(LCD * lcd, uint8_t data_bus_length, uint8_t rows, 
+                  uint8_t cols, uint8_t pwm_contrast);
+uint8_t LCDinitService(LCD * lcd);
+void LCDconfigI2C(LCD * lcd, uint8_t address);
+void LCDsetGeometry(LCD * lcd, uint8_t rows, uint8_t cols);
+void LCDsetEnablePin(LCD * lcd, uint8_t port, uint8_t en);
+
+
+// ------------------------------------------------------------ //
+// several panels on one bus (attach after LCDinit)
+
+void LCDbusInit(LCDbus * bus);
+void LCDbusAttach(LCDbus * bus, LCD * lcd);
+uint8_t LCDbusService(LCDbus * bus);
+void LCDbusFlush(LCDbus * bus);
 
 
 // ------------------------------------------------------------ //
@@ -121,21 +302,48 @@ void LCDshiftCursorRight(LCD * lcd);
 void LCDshiftDisplayLeft(LCD * lcd);
 void LCDshiftDisplayRight(LCD * lcd);
 
+// line wrap (text that reaches the end of a row continues in the next row)
+void LCDwrapOn(LCD * lcd);
+void LCDwrapOff(LCD * lcd);
+
 // cursor position & custom characters
-void LCDcustomCharacter();
+void LCDcustomCharacter(LCD * lcd, uint8_t location, const uint8_t * pattern);
 void LCDsetCursorPosition(LCD * lcd, uint8_t target_row, uint8_t target_col);
+void LCDtrackCursor(LCD * lcd, uint8_t row, uint8_t col);
 
 // send commands or data to the LCD
 void LCDcommand(LCD * lcd, uint8_t command);
 void LCDcharacter(LCD * lcd, uint8_t data);
 void LCDprint(LCD * lcd, char * data);
+void LCDprint_P(LCD * lcd, const char * data);
+
+// commands or characters that can be sent without waiting for a full queue
+uint8_t LCDroom(LCD * lcd);
+
+// read back the address counter or DDRAM/CGRAM (only with the rw pin wired)
+uint8_t LCDreadAddress(LCD * lcd);
+uint8_t LCDreadCharacter(LCD * lcd);
 
 // ------------------------------------------------------------ //
 // functions for communicating via the data bus
 
 void LCDsend(LCD * lcd, uint8_t message, uint8_t type);
+void LCDtransmit(LCD * lcd, uint8_t message, uint8_t type);
+uint8_t LCDready(LCD * lcd);
+uint8_t LCDreceive(LCD * lcd, uint8_t type);
 void LCDsend4bit(LCD * lcd, uint8_t message);
 void LCDsend8bit(LCD * lcd, uint8_t message);
 void LCDbeginTransfer(LCD * lcd);
 
+
+// ------------------------------------------------------------ //
+// transports
+
+void LCDparallelReset(LCD * lcd);
+void LCDparallelWrite(LCD * lcd, uint8_t bits, uint8_t rs, uint8_t width);
+void LCDi2cReset(LCD * lcd);
+void LCDi2cWrite(LCD * lcd, uint8_t bits, uint8_t rs, uint8_t width);
+void LCDi2cFlush(LCD * lcd);
+uint8_t LCDi2cRoom(LCD * lcd);
+
 # endif
\ No newline at end of file
@@ -6,13 +6,28 @@
 # include <stdint.h>
 # include <string.h>
 
-# include <avr/io.h>
-# include <avr/interrupt.h>
-# include <util/delay.h>
-
+# include "hal.h"
 # include "lcd.h"
 # include "ds1302.h"
 # include "dht11.h"
+# include "uart.h"
+# include "twi.h"
+# include "telemetry.h"
+# include "profile.h"
+# include "settings.h"
+# include "screen.h"
+# include "marquee.h"
+# include "timezone.h"
+# include "console.h"
+# include "alarm.h"
+# include "history.h"
+# include "sparkline.h"
+# include "comfort.h"
+# include "boot.h"
+# include "sram.h"
+# include "timesync.h"
+# include "drift.h"
+# include "stopwatch.h"
 # include "macros.h"
 
 
@@ -25,86 +40,788 @@
 
 
 // ------------------------------------------------------------ //
-// function that formats the time into a string
+// data shown on the screens (local time, decimal)
+
+typedef struct screenData {
+    
+    timeData time;
+    DHT11Data climate;
+    DHT11Data outdoor;
+    uint8_t outdoor_valid;
+    const History * history;
+    
+    // derived from the last valid reading (0.1 C)
+    int16_t dewpoint;
+    int16_t heatindex;
+    Marquee marquee;
+    
+    // alarm that is ringing (number and record)
+    uint8_t alarm;
+    alarmEntry ringing;
+    
+    // 1 = 12h, 0 = 24h
+    uint8_t clockmode;
+    
+    // stopwatch and the ms it shows
+    const Stopwatch * stopwatch;
+    uint32_t watch;
+    
+} screenData;
+
+// data sources refreshed by the screen loop
+# define SOURCE_TIME        (1 << 0)
+# define SOURCE_CLIMATE     (1 << 1)
+# define SOURCE_MARQUEE     (1 << 2)
+# define SOURCE_WATCH       (1 << 3)
+
+// DHT11 sensors, taking turns while one is on the screen or the
+// history needs a sample: indoor (PB0) every 2 s, outdoor (PC0)
+// every 10 s
+# define SENSOR_INDOOR      0
+# define SENSOR_OUTDOOR     1
+# define CLIMATE_INTERVAL   2000
+# define OUTDOOR_INTERVAL   10000
+
+// ms per character of the scrolling text
+# define SCROLL_INTERVAL    300
+
+// an alarm that is not dismissed with the button stops by itself
+# define ALARM_RING_TIME    60000
+
+// button on the stopwatch screen (ms held): start/stop below
+// BUTTON_LONG_MS, lap/reset up to BUTTON_LEAVE_MS, beyond that the
+// next mode, edges closer than BUTTON_DEBOUNCE_MS are bounces
+# define BUTTON_DEBOUNCE_MS 20
+# define BUTTON_LONG_MS     600
+# define BUTTON_LEAVE_MS    2000
+
+// events of the button for the main loop
+# define BUTTON_NONE        0
+# define BUTTON_SHORT       1
+# define BUTTON_LONG        2
+
+// LCD on the parallel pins with the contrast from timer2, or on a
+// PCF8574 I2C backpack (build with LCDI2C=1, SDA/SCL on PC4/PC5)
+// which has a potentiometer for it
+# ifdef LCD_I2C
+# define LCD_PWM_CONTRAST   0
+# else
+# define LCD_PWM_CONTRAST   1
+# endif
+
+// the display is read back (rw pin wired) every 50 ms in passes
+// that drew nothing, SCREEN_SCRUB_CELLS cells each, so a 16x2
+// panel is checked every 400 ms
+# define SCRUB_INTERVAL     50
+
+static const char days[7][4] PROGMEM = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+
+// any length, only the visible window is written to the display
+static const char scrolling_text[] PROGMEM = "this is some auto-scrolling text!";
+
+
+// ------------------------------------------------------------ //
+// field that shows hours and minutes
+
+uint16_t keyTime(const void * data) {
+    
+    const screenData * screen = data;
+    
+    return (screen->clockmode << 15) | (screen->time.hour << 8) | screen->time.minute;
+    
+}
+
+void formatTime(char * buffer, const void * data) {
+    
+    PROFILE_BEGIN(PROF_FORMATTIME);
+    
+    const screenData * screen = data;
+    uint8_t hour = screen->time.hour;
+    
+    // 12h mode: 12, 1, ..., 11
+    if (screen->clockmode) {
+        
+        hour = (hour % 12) ? hour % 12 : 12;
+        
+    }
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("%02d:%02d"), hour, screen->time.minute);
+    
+    PROFILE_END(PROF_FORMATTIME);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows AM/PM in 12h mode
+
+uint16_t keyMeridiem(const void * data) {
+    
+    const screenData * screen = data;
+    
+    return (screen->clockmode << 1) | (screen->time.hour >= 12);
+    
+}
+
+void formatMeridiem(char * buffer, const void * data) {
+    
+    const screenData * screen = data;
+    
+    if (screen->clockmode) {
+        
+        strcpy_P(buffer, (screen->time.hour >= 12) ? PSTR("PM") : PSTR("AM"));
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows the seconds
+
+uint16_t keySeconds(const void * data) {
+    
+    return ((const screenData *) data)->time.second;
+    
+}
+
+void formatSeconds(char * buffer, const void * data) {
+    
+    PROFILE_BEGIN(PROF_FORMATTIME);
+    
+    const timeData * time = &((const screenData *) data)->time;
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR(":%02d"), time->second);
+    
+    PROFILE_END(PROF_FORMATTIME);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows day of the week and date
+
+uint16_t keyDate(const void * data) {
+    
+    const timeData * time = &((const screenData *) data)->time;
+    
+    // unique for 2000-2099
+    return ((time->year * 12 + time->month) << 5) + time->day;
+    
+}
+
+void formatDate(char * buffer, const void * data) {
+    
+    PROFILE_BEGIN(PROF_FORMATDATE);
+    
+    const timeData * time = &((const screenData *) data)->time;
+    
+    // day of the week from flash, then the date behind it (the
+    // year of the DS1302 has two digits)
+    memcpy_P(buffer, days[time->dayofweek % 7], 3);
+    snprintf_P(buffer + 3, SCREEN_MAX_WIDTH - 2, PSTR(" %02d.%02d.20%02d"),
+               time->day, time->month, time->year % 100);
+    
+    PROFILE_END(PROF_FORMATDATE);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows the humidity
+
+uint16_t keyHumidity(const void * data) {
+    
+    const DHT11Data * climate = &((const screenData *) data)->climate;
+    
+    return (climate->humi_integral << 8) | climate->humi_decimal;
+    
+}
+
+void formatHumidity(char * buffer, const void * data) {
+    
+    PROFILE_BEGIN(PROF_FORMATHUMIDITY);
+    
+    const DHT11Data * climate = &((const screenData *) data)->climate;
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Humi: %d.%d%%"), climate->humi_integral, climate->humi_decimal);
+    
+    PROFILE_END(PROF_FORMATHUMIDITY);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows the temperature
+
+uint16_t keyTemperature(const void * data) {
+    
+    const DHT11Data * climate = &((const screenData *) data)->climate;
+    
+    return (climate->temp_integral << 8) | climate->temp_decimal;
+    
+}
+
+void formatTemperature(char * buffer, const void * data) {
+    
+    PROFILE_BEGIN(PROF_FORMATTEMPERATURE);
+    
+    const DHT11Data * climate = &((const screenData *) data)->climate;
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Temp: %d.%dC"), climate->temp_integral, climate->temp_decimal);
+    
+    PROFILE_END(PROF_FORMATTEMPERATURE);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// fields that show the outdoor sensor (dashes until it answered)
 
-char * formatTime(timeData * data) {
+uint16_t keyOutdoorHumidity(const void * data) {
+    
+    const screenData * screen = data;
     
-    char * time = malloc(17 * sizeof(*time));
+    return (screen->outdoor_valid << 15) | (screen->outdoor.humi_integral << 8) | screen->outdoor.humi_decimal;
+    
+}
+
+void formatOutdoorHumidity(char * buffer, const void * data) {
     
-    sprintf(time, "%02d:%02d:%02d        ", bcd_to_dec(data->hour), bcd_to_dec(data->minute), bcd_to_dec(data->second));
+    const screenData * screen = data;
     
-    return time;
+    if (!screen->outdoor_valid) {
+        
+        strcpy_P(buffer, PSTR("Out humi: --"));
+        return;
+        
+    }
+    
+    // the decimal byte of the DHT11 is a single digit (tenths)
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Out humi: %d.%d%%"), screen->outdoor.humi_integral, screen->outdoor.humi_decimal % 10);
+    
+}
+
+uint16_t keyOutdoorTemperature(const void * data) {
+    
+    const screenData * screen = data;
+    
+    return (screen->outdoor_valid << 15) | (screen->outdoor.temp_integral << 8) | screen->outdoor.temp_decimal;
+    
+}
+
+void formatOutdoorTemperature(char * buffer, const void * data) {
+    
+    const screenData * screen = data;
+    
+    if (!screen->outdoor_valid) {
+        
+        strcpy_P(buffer, PSTR("Out temp: --"));
+        return;
+        
+    }
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Out temp: %d.%dC"), screen->outdoor.temp_integral, screen->outdoor.temp_decimal % 10);
     
 }
 
 
 // ------------------------------------------------------------ //
-// function that formats the date into a string
-
-char * formatDate(timeData * data) {
-    
-    char * date = malloc(17 * sizeof(*date));
-    char day[4];
-    
-    switch (data->dayofweek) {
-        case 0:
-            strcpy(day, "SUN");
-            break;
-        case 1:
-            strcpy(day, "MON");
-            break;
-        case 2:
-            strcpy(day, "TUE");
-            break;
-        case 3:
-            strcpy(day, "WED");
-            break;
-        case 4:
-            strcpy(day, "THU");
-            break;
-        case 5:
-            strcpy(day, "FRI");
-            break;
-        case 6:
-            strcpy(day, "SAT");
-            break;
+// fields that show mean, minimum and maximum of the last 24 h
+
+// value in tenths, clamped to -99.9 .. 999.9 (none of the sensors
+// or the values derived from them get there) so it fits in
+// TENTHS_SIZE characters
+# define TENTHS_SIZE 6
+
+void formatTenths(char * buffer, int16_t value) {
+    
+    if (value < 0) {
+        
+        value = (value < -999) ? 999 : -value;
+        snprintf_P(buffer, TENTHS_SIZE, PSTR("-%d.%d"), value / 10, value % 10);
+        
+    } else {
+        
+        value = (value > 9999) ? 9999 : value;
+        snprintf_P(buffer, TENTHS_SIZE, PSTR("%d.%d"), value / 10, value % 10);
+        
     }
     
-    sprintf(date, "%s %02d.%02d.20%02d  ", day, bcd_to_dec(data->day), bcd_to_dec(data->month), bcd_to_dec(data->year));
+}
+
+uint16_t keyStats(const void * data) {
     
-    return date;
+    return ((const screenData *) data)->history->samples;
+    
+}
+
+// label, mean, minimum and maximum (no scan, see history.h)
+void formatHistoryStats(char * buffer, const History * history, uint8_t value, char label) {
+    
+    const historyStats * stats = HISTORYstats(history, value);
+    char mean[TENTHS_SIZE];
+    char min[TENTHS_SIZE];
+    char max[TENTHS_SIZE];
+    char line[3 * TENTHS_SIZE + 2];
+    
+    if (HISTORYcount(history) == 0) {
+        
+        snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("%c --"), label);
+        return;
+        
+    }
+    
+    formatTenths(mean, HISTORYmean(history, value));
+    formatTenths(min, stats->min);
+    formatTenths(max, stats->max);
+    
+    // three values of 5 characters do not fit next to each other,
+    // the line is cut at the width of the screen like the others
+    snprintf_P(line, sizeof(line), PSTR("%c %s %s %s"), label, mean, min, max);
+    strncpy(buffer, line, SCREEN_MAX_WIDTH);
+    buffer[SCREEN_MAX_WIDTH] = '\0';
+    
+}
+
+void formatTemperatureStats(char * buffer, const void * data) {
+    
+    const History * history = ((const screenData *) data)->history;
+    
+    formatHistoryStats(buffer, history, HISTORY_TEMPERATURE, 'T');
+    
+}
+
+void formatHumidityStats(char * buffer, const void * data) {
+    
+    const History * history = ((const screenData *) data)->history;
+    
+    formatHistoryStats(buffer, history, HISTORY_HUMIDITY, 'H');
     
 }
 
 
 // ------------------------------------------------------------ //
-// function that formats humidity into a string
+// fields that show dew point and heat index
 
-char * formatHumidity(DHT11Data * data) {
+uint16_t keyDewPoint(const void * data) {
+    
+    return ((const screenData *) data)->dewpoint;
     
-    char * humidity = malloc(17 * sizeof(*humidity));
+}
+
+void formatDewPoint(char * buffer, const void * data) {
     
-    sprintf(humidity, "Humi: %d.%d%%     ", data->humi_integral, data->humi_decimal);
+    char value[TENTHS_SIZE];
     
-    return humidity;
+    formatTenths(value, ((const screenData *) data)->dewpoint);
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Dew pt: %sC"), value);
+    
+}
+
+uint16_t keyHeatIndex(const void * data) {
+    
+    return ((const screenData *) data)->heatindex;
+    
+}
+
+void formatHeatIndex(char * buffer, const void * data) {
+    
+    int16_t heat = ((const screenData *) data)->heatindex;
+    char value[TENTHS_SIZE];
+    
+    // hotter than the table of the regression
+    if (heat == COMFORT_HEAT_NONE) {
+        
+        strcpy_P(buffer, PSTR("Heat idx: --"));
+        return;
+        
+    }
+    
+    formatTenths(value, heat);
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("Heat idx: %sC"), value);
     
 }
 
 
 // ------------------------------------------------------------ //
-// function that formats temperature into a string
+// fields that show the trend of the last samples as bars
 
-char * formatTemperature(DHT11Data * data) {
+void formatTemperatureTrend(char * buffer, const void * data) {
     
-    char * temperature = malloc(17 * sizeof(*temperature));
+    SPARKLINEformat(buffer, ((const screenData *) data)->history, HISTORY_TEMPERATURE, SCREEN_MAX_WIDTH);
     
-    sprintf(temperature, "Temp: %d.%dC     ", data->temp_integral, data->temp_decimal);
+}
+
+void formatHumidityTrend(char * buffer, const void * data) {
     
-    return temperature;
+    SPARKLINEformat(buffer, ((const screenData *) data)->history, HISTORY_HUMIDITY, SCREEN_MAX_WIDTH);
     
 }
 
 
+// ------------------------------------------------------------ //
+// field that shows the window of the scrolling text
+
+uint16_t keyMarquee(const void * data) {
+    
+    return MARQUEEstep(&((const screenData *) data)->marquee);
+    
+}
+
+void formatMarquee(char * buffer, const void * data) {
+    
+    MARQUEEwindow(&((const screenData *) data)->marquee, buffer);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows the alarm that is ringing
+
+uint16_t keyAlarm(const void * data) {
+    
+    return ((const screenData *) data)->alarm;
+    
+}
+
+void formatAlarm(char * buffer, const void * data) {
+    
+    const screenData * screen = data;
+    
+    // the entries are checked when set, the modulos only bound the
+    // line for the compiler
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("ALARM %u   %02u:%02u"),
+               screen->alarm % ALARMS_MAX + 1, screen->ringing.hour % 24, screen->ringing.minute % 60);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// fields that show the stopwatch, split at the digits that change
+// at different rates so a pass only redraws the hundredths (and
+// the seconds once per second, ...)
+
+uint16_t keyWatchLabel(const void * data) {
+    
+    return ((const screenData *) data)->stopwatch->duration != 0;
+    
+}
+
+void formatWatchLabel(char * buffer, const void * data) {
+    
+    strcpy_P(buffer, keyWatchLabel(data) ? PSTR("CD") : PSTR("SW"));
+    
+}
+
+uint16_t keyWatchMinutes(const void * data) {
+    
+    return ((const screenData *) data)->watch / 60000;
+    
+}
+
+void formatWatchMinutes(char * buffer, const void * data) {
+    
+    uint16_t minutes = keyWatchMinutes(data);
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("%02u:%02u"), minutes / 60, minutes % 60);
+    
+}
+
+uint16_t keyWatchSeconds(const void * data) {
+    
+    return ((const screenData *) data)->watch / 1000 % 60;
+    
+}
+
+void formatWatchSeconds(char * buffer, const void * data) {
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR(":%02u"), keyWatchSeconds(data));
+    
+}
+
+uint16_t keyWatchHundredths(const void * data) {
+    
+    return ((const screenData *) data)->watch % 1000 / 10;
+    
+}
+
+void formatWatchHundredths(char * buffer, const void * data) {
+    
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR(".%02u"), keyWatchHundredths(data));
+    
+}
+
+
+// ------------------------------------------------------------ //
+// field that shows the last lap or the state of the stopwatch
+
+uint16_t keyWatchLap(const void * data) {
+    
+    const Stopwatch * watch = ((const screenData *) data)->stopwatch;
+    
+    return (watch->laps << 2) | watch->state;
+    
+}
+
+void formatWatchLap(char * buffer, const void * data) {
+    
+    static const char states[4][8] PROGMEM = {"READY", "RUNNING", "STOPPED", "TIME UP"};
+    const Stopwatch * watch = ((const screenData *) data)->stopwatch;
+    char text[12];
+    
+    if (watch->laps == 0) {
+        
+        strcpy_P(buffer, states[watch->state]);
+        return;
+        
+    }
+    
+    STOPWATCHformat(text, STOPWATCHlastLap(watch));
+    snprintf_P(buffer, SCREEN_MAX_WIDTH + 1, PSTR("L%-3u%s"), watch->laps % 1000, text);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// screens (index = mode, the alarm screen is not part of the
+// cycle, it is shown while an alarm rings)
+
+static const screenField clock_fields[] PROGMEM = {
+    {0, 0,  5, keyTime,        formatTime},
+    {0, 5,  3, keySeconds,     formatSeconds},
+    {0, 9,  2, keyMeridiem,    formatMeridiem},
+    {1, 0, 16, keyDate,        formatDate},
+};
+
+static const screenField marquee_fields[] PROGMEM = {
+    {0, 0, 16, keyMarquee,     formatMarquee},
+};
+
+static const screenField climate_fields[] PROGMEM = {
+    {0, 0, 16, keyHumidity,    formatHumidity},
+    {1, 0, 16, keyTemperature, formatTemperature},
+};
+
+static const screenField stats_fields[] PROGMEM = {
+    {0, 0, 16, keyStats,       formatTemperatureStats},
+    {1, 0, 16, keyStats,       formatHumidityStats},
+};
+
+static const screenField trend_fields[] PROGMEM = {
+    {0, 0, 16, keyStats,       formatTemperatureTrend},
+    {1, 0, 16, keyStats,       formatHumidityTrend},
+};
+
+static const screenField comfort_fields[] PROGMEM = {
+    {0, 0, 16, keyDewPoint,    formatDewPoint},
+    {1, 0, 16, keyHeatIndex,   formatHeatIndex},
+};
+
+static const screenField outdoor_fields[] PROGMEM = {
+    {0, 0, 16, keyOutdoorHumidity,    formatOutdoorHumidity},
+    {1, 0, 16, keyOutdoorTemperature, formatOutdoorTemperature},
+};
+
+static const screenField watch_fields[] PROGMEM = {
+    {0, 0,  2, keyWatchLabel,      formatWatchLabel},
+    {0, 4,  5, keyWatchMinutes,    formatWatchMinutes},
+    {0, 9,  3, keyWatchSeconds,    formatWatchSeconds},
+    {0, 12, 3, keyWatchHundredths, formatWatchHundredths},
+    {1, 0, 16, keyWatchLap,        formatWatchLap},
+};
+
+static const screenField alarm_fields[] PROGMEM = {
+    {0, 0, 16, keyAlarm,       formatAlarm},
+    {1, 0,  5, keyTime,        formatTime},
+    {1, 5,  3, keySeconds,     formatSeconds},
+    {1, 9,  2, keyMeridiem,    formatMeridiem},
+};
+
+static const screenLayout screens[] PROGMEM = {
+    {clock_fields,   4, SOURCE_TIME},
+    {climate_fields, 2, SOURCE_TIME | SOURCE_CLIMATE},
+    {marquee_fields, 1, SOURCE_TIME | SOURCE_MARQUEE},
+    {stats_fields,   2, SOURCE_TIME},
+    {trend_fields,   2, SOURCE_TIME},
+    {comfort_fields, 2, SOURCE_TIME | SOURCE_CLIMATE},
+    {outdoor_fields, 2, SOURCE_TIME | SOURCE_CLIMATE},
+    {watch_fields,   5, SOURCE_WATCH},
+    {alarm_fields,   4, SOURCE_TIME},
+};
+
+# define SCREENS      (sizeof(screens) / sizeof(screens[0]) - 1)
+# define SCREEN_ALARM SCREENS
+
+// the stopwatch is the last screen of the cycle (the button
+// works differently there, see INT0_vect)
+# define SCREEN_WATCH (SCREENS - 1)
+
+
+// ------------------------------------------------------------ //
+// function that streams a time record (UTC) over the serial port
+
+void streamTime(Telemetry * tel, uint32_t utc) {
+    
+    uint8_t frame[TEL_FRAME_MAX];
+    
+    UARTwrite(frame, TELencodeTime(tel, frame, utc));
+    
+}
+
+
+// ------------------------------------------------------------ //
+// function that streams a humidity and temperature record over
+// the serial port
+
+void streamHumidityTemperature(Telemetry * tel, uint32_t utc, DHT11Data * data) {
+    
+    uint8_t frame[TEL_FRAME_MAX];
+    
+    UARTwrite(frame, TELencodeDHT11(tel, frame, utc,
+                                    data->humi_integral, data->humi_decimal,
+                                    data->temp_integral, data->temp_decimal));
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command that prints the statistics of the history,
+// "history dump" also prints the samples (newest first)
+
+void printHistory(const History * history, const char * args) {
+    
+    const historyStats * temperature = HISTORYstats(history, HISTORY_TEMPERATURE);
+    const historyStats * humidity = HISTORYstats(history, HISTORY_HUMIDITY);
+    int16_t values[HISTORY_VALUES];
+    char line[48];
+    uint32_t time;
+    
+    snprintf_P(line, sizeof(line), PSTR("samples %u interval %u rescans %u\r\n"),
+               HISTORYcount(history), HISTORY_INTERVAL, history->rescans);
+    UARTprint(line);
+    snprintf_P(line, sizeof(line), PSTR("temperature %d %d %d\r\n"),
+               HISTORYmean(history, HISTORY_TEMPERATURE), temperature->min, temperature->max);
+    UARTprint(line);
+    snprintf_P(line, sizeof(line), PSTR("humidity %d %d %d\r\n"),
+               HISTORYmean(history, HISTORY_HUMIDITY), humidity->min, humidity->max);
+    UARTprint(line);
+    
+    if (strcmp_P(args, PSTR("dump")) != 0) {
+        
+        return;
+        
+    }
+    
+    for (uint16_t age = 0; age < HISTORYcount(history); age++) {
+        
+        time = HISTORYget(history, age, values);
+        snprintf_P(line, sizeof(line), PSTR("%lu %d %d\r\n"),
+                   (unsigned long) time, values[HISTORY_TEMPERATURE], values[HISTORY_HUMIDITY]);
+        UARTprint(line);
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command that prints the cost and findings of the
+// display read-back
+
+void printScrub(const Screen * screen) {
+    
+    char line[48];
+    
+    snprintf_P(line, sizeof(line), PSTR("reads %lu repairs %u losses %u\r\n"),
+               (unsigned long) screen->scrub_reads, screen->scrub_repairs, screen->scrub_losses);
+    UARTprint(line);
+    snprintf_P(line, sizeof(line), PSTR("us %lu cells/s %u\r\n"),
+               (unsigned long) screen->scrub_us, SCREEN_SCRUB_CELLS * (1000 / SCRUB_INTERVAL));
+    UARTprint(line);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command that prints the boot timeline (us since
+// reset, phases not reached yet as -)
+
+void printBoot(void) {
+    
+    char line[24];
+    
+    for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+        
+        UARTprint_P(BOOTname(i));
+        
+        if (BOOTreached(i)) {
+            
+            snprintf_P(line, sizeof(line), PSTR(" %lu\r\n"), (unsigned long) BOOTtime(i));
+            UARTprint(line);
+            
+        } else {
+            
+            UARTprint_P(PSTR(" -\r\n"));
+            
+        }
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command that prints the stack high-water mark, the
+// bytes between heap and stack that were never touched and the
+// heap counters
+
+void printSram(void) {
+    
+    const sramHeap * heap = SRAMheap();
+    char line[72];
+    
+    snprintf_P(line, sizeof(line), PSTR("stack_peak %u unused %u free %u\r\n"),
+               SRAMstackPeak(), SRAMunused(), SRAMfree());
+    UARTprint(line);
+    snprintf_P(line, sizeof(line), PSTR("heap allocs %u frees %u failures %u used %u peak %u\r\n"),
+               heap->allocs, heap->frees, heap->failures, heap->used, heap->peak);
+    UARTprint(line);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command that prints the counters of the DHT11 sensors
+// and the age of their last valid reading (- if none yet)
+
+void printSensors(const DHT11scan * scan) {
+    
+    const dht11Sensor * sensor;
+    char line[64];
+    
+    for (uint8_t i = 0; i < scan->count; i++) {
+        
+        sensor = &scan->sensors[i];
+        snprintf_P(line, sizeof(line), PSTR("sensor %u reads %u timeouts %u checksum %u age "),
+                   i, sensor->reads, sensor->timeouts, sensor->checksum_errors);
+        UARTprint(line);
+        
+        if (sensor->valid) {
+            
+            snprintf_P(line, sizeof(line), PSTR("%lu\r\n"), (unsigned long) (HALmillis() - sensor->updated));
+            UARTprint(line);
+            
+        } else {
+            
+            UARTprint_P(PSTR("-\r\n"));
+            
+        }
+        
+    }
+    
+}
+
 
 // ------------------------------------------------------------ //
 // digital clock mode 
@@ -112,7 +829,20 @@ char * formatTemperature(DHT11Data * data) {
 // 0 = display time & date
 // 1 = humidity & temperature
 // 2 = auto-scroll text
-uint8_t mode = 0;
+// 3 = 24 h statistics of temperature & humidity
+// 4 = trend of temperature & humidity
+// 5 = dew point & heat index
+// 6 = outdoor humidity & temperature
+// 7 = stopwatch / countdown
+volatile uint8_t mode = 0;
+
+// set while an alarm rings, the button clears it
+volatile uint8_t alarm_ringing = 0;
+
+// press on the stopwatch screen for the main loop (event and the
+// HALmillis at which the button went down)
+volatile uint8_t button_event = BUTTON_NONE;
+volatile uint32_t button_at;
 
 
 // ------------------------------------------------------------ //
@@ -122,175 +852,416 @@ int main (void) {
     
     LCD lcd;
     DS1302 ds1302;
-    DHT11 dht11;
+    DHT11scan sensors;
+    Telemetry tel;
+    TimeSync timesync;
+    Drift drift;
+    Stopwatch stopwatch;
+    Settings settings;
+    Alarms alarms;
+    History history;
+    Console console;
+    Screen screen;
+    screenData data;
+    marqueeSource marquee_text;
+    Timezone tz;
     timeData curr_date_time;
-    DHT11Data curr_humi_temp;
-    char * time;
-    char * date;
-    char * humidity;
-    char * temperature;
-    char * scrolling_text;
+    timeData rtc;
+    uint32_t utc = 0;
+    uint32_t local;
+    uint32_t ring_start = 0;
+    char * line;
+    char * args;
+    uint8_t fired;
     uint8_t reinit_time;
+    uint8_t last_second;
+    uint8_t shown;
+    uint8_t sources;
+    uint8_t drawn;
+    uint8_t reading;
+    int16_t nudge;
+    uint8_t event;
+    uint8_t field;
+    uint32_t event_at;
+    uint32_t last_scrub = 0;
+    int16_t temperature;
+    int16_t humidity;
+    
+    // timeline of the start-up, the timer runs from here on, so the
+    // waits below count from reset
+    BOOTinit();
+    HALtimerInit();
+    
+    // set pins to output (the button is an input with pull-up)
+    hal_port_init(HAL_PORTD, (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6) | (1 << PD7), (1 << PD2));
+    hal_port_init(HAL_PORTB, (1 << PB0) | (1 << PB1) | (1 << PB2) | (1 << PB3) | (1 << PB4) | (1 << PB5), 0);
     
-    // configure interrupts for the button to switch mode
-    DDRD  = (0 << PD2);
-    PORTD = (1 << PD2);
-    EICRA = (1 << ISC01) | (0 << ISC00);
+    // configure the LCD and start its power on wait, the panel is
+    // initialized once the wait passed, everything up to there
+    // runs in the meantime
+# ifdef LCD_I2C
+    TWIinit();
+    LCDconfigI2C(&lcd, LCD_I2C_ADDRESS);
+# else
+    LCDconfig(&lcd, PB1, 0xFF, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
+# endif
+    LCDinitBegin(&lcd, 4, 2, 16, LCD_PWM_CONTRAST);
+    BOOTmark(BOOT_LCD_POWERON);
+    
+    // the DHT11 sensors start up alongside (read once DHT11ready,
+    // the screens show zeros or dashes until then)
+    DHT11scanInit(&sensors);
+    DHT11scanAdd(&sensors, HAL_PORTB, PB0, CLIMATE_INTERVAL);
+    DHT11scanAdd(&sensors, HAL_PORTC, PC0, OUTDOOR_INTERVAL);
+    memset(&data.climate, 0, sizeof(data.climate));
+    data.outdoor_valid = 0;
+    BOOTmark(BOOT_SENSOR);
+    
+    // configure interrupts for the button to switch mode (both
+    // edges, the stopwatch screen needs the time it was held)
+    EICRA = (0 << ISC01) | (1 << ISC00);
     EIMSK = (1 << INT0);
     sei();
     
-    // flag for setting the time again
-    reinit_time = 0;
+    // binary telemetry stream on the serial port, commands are received on it
+    UARTinit();
+    TELinit(&tel);
+    CONSOLEinit(&console);
+    SYNCinit(&timesync);
+    last_second = 0xFF;
+    
+    // cycle counter for the profiler (only with PROFILE=1)
+    PROFILEinit();
+    
+    // persistent settings
+    SETTINGSload(&settings);
+    mode = (settings.data.bootmode < SCREENS) ? settings.data.bootmode : 0;
+    
+    // samples of the last 24 h (read in the background at their interval)
+    HISTORYinit(&history);
+    data.history   = &history;
+    data.dewpoint  = 0;
+    data.heatindex = 0;
     
-    // set pins to output
-    DDRD = (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6) | (1 << PD7);
-    DDRB = (1 << PB0) | (1 << PB1) | (1 << PB2) | (1 << PB3) | (1 << PB4) | (1 << PB5);
+    // alarms (scheduled once the time is known)
+    ALARMSload(&alarms);
+    DRIFTload(&drift);
+    
+    // flag for setting the time again (cleared once it is done)
+    reinit_time = settings.data.reinit_time;
+    
+    // the RTC runs on UTC, the screens show the time of the zone
+    TZinit(&tz, settings.data.timezone);
+    data.clockmode = settings.data.clockmode;
+    BOOTmark(BOOT_SETTINGS);
+    
+    // stopwatch from the ms of timer0
+    STOPWATCHinit(&stopwatch);
+    data.stopwatch = &stopwatch;
     
     // initialize the RTC
     DS1302init(&ds1302, PB4, PD7, PB5);
     
-    // time and date should only be initialized once (RTC takes care of it afterwards)
+    // time and date should only be initialized once (RTC takes care of it afterwards),
+    // the "sync" console command sets them from the host to the ms (see timesync.h)
     if (reinit_time == 1) {
 
-        // get compile time and send it to the RTC module (maybe add an offset later)
-        DS1302timeDataInit(&curr_date_time, __DATE__, __TIME__, 4);
+        // get compile time (local) and send it to the RTC module as UTC
+        DS1302timeDataInit_P(&curr_date_time, PSTR(__DATE__), PSTR(__TIME__), 4);
+        DS1302timeDataFromSeconds(&curr_date_time, TZutc(&tz, DS1302timeDataToSeconds(&curr_date_time)));
         DS1302writeTimeData(&ds1302, &curr_date_time);
         
-        // 24h mode
-        DS1302setClockMode(&ds1302, 0);
-        
         // start the clock
         DS1302startClock(&ds1302);
         
+        SETTINGSset(&settings, SETTING_REINITTIME, 0, HALmillis());
+        
     }
     
-    // initialize the DHT11
-    DHT11init(&dht11, PB0);
+    // UTC needs the 24h mode (only written if it differs), 12h is up to the screens
+    DS1302setClockMode(&ds1302, 0);
     
-    // configure and initialize the LCD
-    LCDconfig(&lcd, PB1, 0xFF, PB2, PD3, PD4, PD5, PD6, 0, 0, 0, 0);
-    LCDinit(&lcd, 4, 2, 16, 1);
+    // next fire time of every alarm, afterwards only the first one is compared
+    DS1302readTimeData(&ds1302, &rtc);
+    DS1302timeDataFromBCD(&rtc);
+    ALARMSschedule(&alarms, TZlocal(&tz, DS1302timeDataToSeconds(&rtc)));
+    BOOTmark(BOOT_RTC);
+    
+    // scrolling text from flash, one line wide
+    MARQUEEsourceProgmem(&marquee_text, scrolling_text);
+    MARQUEEinit(&data.marquee, &marquee_text, 16, SCROLL_INTERVAL);
+    
+    // screen state and read-back counters
+    SCREENinit(&screen);
+    
+    // rest of the power on wait and the initialization of the LCD
+    while (!LCDinitService(&lcd)) {
+        
+        hal_delay_us(1);
+        
+    }
+    
+# if LCD_PWM_CONTRAST
+    LCDpwmSetContrast(&lcd, settings.data.contrast);
+# endif
+    BOOTmark(BOOT_LCD_READY);
     
     // master loop
     while (1) {
         
-        switch (mode) {
-    
-            case 0:
-
-                // loop that displays the clock
-                while (1) {
-
-                    // read the data
-                    DS1302readTimeData(&ds1302, &curr_date_time);
-
-                    // format it
-                    time = formatTime(&curr_date_time);
-                    date = formatDate(&curr_date_time);
-
-                    // return to position (0,0) and print the data
-                    LCDreturnHome(&lcd);
-                    LCDprint(&lcd, time);
-                    LCDsetCursorPosition(&lcd, 1, 0);
-                    LCDprint(&lcd, date);
+        // remember the mode for the next boot (committed once it settles)
+        SETTINGSset(&settings, SETTING_BOOTMODE, mode, HALmillis());
+        
+        // loop that keeps the screen of the mode up to date (only
+        // the fields whose data changed are redrawn)
+        shown = alarm_ringing ? SCREEN_ALARM : mode;
+        SCREENshow(&screen, &screens[shown]);
+        sources = pgm_read_byte(&screens[shown].sources);
+        MARQUEErestart(&data.marquee, HALmillis());
+        
+        while (1) {
 
-                    // free the memory
-                    free(time);
-                    free(date);
+            // write pending settings and alarms (one byte at a time)
+            SETTINGSservice(&settings, HALmillis());
+            ALARMSservice(&alarms);
+            DRIFTservice(&drift);
+            
+            // commands from the serial port
+            if ((line = CONSOLEread(&console)) != 0) {
+                
+                if ((args = CONSOLEmatch(line, PSTR("alarm"))) != 0) {
                     
-                    // check if still in clock mode
-                    if (mode != 0) {
-
-                        LCDclearDisplay(&lcd);
-                        break;
-
-                    }
-
-                }
-
-                break;
-
-            case 1:
-
-                // loop that displays temperature and humidity (will maybe add this with a DHT11)
-                while (1) {
+                    ALARMScommand(&alarms, args, TZlocal(&tz, utc));
                     
-                    // read the data
-                    DHT11readData(&dht11, &curr_humi_temp);
+                } else if ((args = CONSOLEmatch(line, PSTR("history"))) != 0) {
                     
-                    // format it
-                    humidity    = formatHumidity(&curr_humi_temp);
-                    temperature = formatTemperature(&curr_humi_temp);
+                    printHistory(&history, args);
                     
-                    // return to position (0,0) and print the data
-                    LCDreturnHome(&lcd);
-                    LCDprint(&lcd, humidity);
-                    LCDsetCursorPosition(&lcd, 1, 0);
-                    LCDprint(&lcd, temperature);
+                } else if (CONSOLEmatch(line, PSTR("scrub")) != 0) {
                     
-                    // free the memory
-                    free(humidity);
-                    free(temperature);
+                    printScrub(&screen);
                     
-                    // delay
-                    _delay_ms(2000);
+                } else if (CONSOLEmatch(line, PSTR("boot")) != 0) {
                     
-                    // check if still in temperature and humidity mode
-                    if (mode != 1) {
-
-                        LCDclearDisplay(&lcd);
-                        break;
-
-                    }
-
-                }
-
-                break;
-
-            case 2:
-
-                // loop that displays some automatically scrolling text
-                while (1) {
+                    printBoot();
+                    
+                } else if (CONSOLEmatch(line, PSTR("sram")) != 0) {
+                    
+                    printSram();
+                    
+                } else if (CONSOLEmatch(line, PSTR("sensors")) != 0) {
                     
-                    // 40 characters can fit in one line (null terminator is filtered out)
-                    scrolling_text = malloc(41 * sizeof(*scrolling_text));
-                    strcpy(scrolling_text, "this is some auto-scrolling text!");
+                    printSensors(&sensors);
                     
-                    // print the whole line, excess of 16 characters is in memory
-                    LCDreturnHome(&lcd);
-                    LCDprint(&lcd, scrolling_text);
+                } else if ((args = CONSOLEmatch(line, PSTR("sync"))) != 0) {
                     
-                    // scroll the display
-                    for (int i = 0; i < strlen(scrolling_text) - 16; i++) {
+                    SYNCcommand(&timesync, args, HALmillis());
+                    
+                } else if ((args = CONSOLEmatch(line, PSTR("drift"))) != 0) {
+                    
+                    DRIFTcommand(&drift, args);
+                    
+                } else if ((args = CONSOLEmatch(line, PSTR("set"))) != 0) {
+                    
+                    // changes apply right away (a reinit on the next boot), the
+                    // alarms are local times
+                    field = SETTINGScommand(&settings, args, HALmillis());
+                    
+                    if (field == SETTING_TIMEZONE) {
+                        
+                        TZinit(&tz, settings.data.timezone);
+                        DS1302timeDataFromSeconds(&data.time, TZlocal(&tz, utc));
+                        ALARMSschedule(&alarms, TZlocal(&tz, utc));
                         
-                        _delay_ms(1000);
-                        LCDshiftDisplayLeft(&lcd);
+# if LCD_PWM_CONTRAST
+                    } else if (field == SETTING_CONTRAST) {
                         
-                        // to avoid getting stuck here
-                        if (mode != 2) {
-                            
-                            break;
-                            
-                        }
+                        LCDpwmSetContrast(&lcd, settings.data.contrast);
+                        
+# endif
+                    } else if (field == SETTING_CLOCKMODE) {
+                        
+                        data.clockmode = settings.data.clockmode;
                         
                     }
                     
-                    _delay_ms(2000);
+                } else if ((args = CONSOLEmatch(line, PSTR("stopwatch"))) != 0) {
+                    
+                    STOPWATCHcommand(&stopwatch, args);
                     
-                    free(scrolling_text);
+                } else {
                     
-                    // check if still in auto-scroll text mode
-                    if (mode != 2) {
+                    UARTprint_P(PSTR("error: unknown command\r\n"));
+                    
+                }
+                
+                // the reply is complete, delimit it from the next frame
+                UARTendText();
+                
+            }
+            
+            // time synchronization with the host, the alarms follow a corrected time and
+            // the offset is the drift of the RTC since the previous one
+            if (SYNCservice(&timesync, &tel, &ds1302, HALmillis()) == SYNC_SET) {
+                
+                ALARMSschedule(&alarms, TZlocal(&tz, timesync.synced));
+                DRIFTmeasure(&drift, &timesync.offset, timesync.elapsed, timesync.synced);
+                
+            }
+            
+            // read the time
+            DS1302readTimeData(&ds1302, &rtc);
 
-                        LCDclearDisplay(&lcd);
-                        break;
+            // stream the time once per second
+            if (rtc.second != last_second) {
+                
+                last_second = rtc.second;
+                
+                // local time only costs a comparison unless a transition was passed
+                DS1302timeDataFromBCD(&rtc);
+                utc = DS1302timeDataToSeconds(&rtc);
+                local = TZlocal(&tz, utc);
+                SYNCtick(&timesync, utc, HALmillis());
+                
+                // move the RTC once its drift added up to a step
+                if ((nudge = DRIFTtick(&drift, utc)) != 0 && SYNCadjust(&timesync, nudge, HALmillis())) {
+                    
+                    DRIFTnudged(&drift, nudge);
+                    
+                }
+                DS1302timeDataFromSeconds(&data.time, local);
+                
+                streamTime(&tel, utc);
+                
+                // only the first alarm of the schedule is compared
+                if ((fired = ALARMScheck(&alarms, local)) != ALARM_NONE) {
+                    
+                    data.alarm   = fired;
+                    data.ringing = alarms.entries[fired];
+                    ring_start   = HALmillis();
+                    alarm_ringing = 1;
+                    
+                }
+                
+                // dump the profiler table once per minute
+                if (data.time.second == 0) {
+                    
+                    PROFILEdump();
+                    
+                }
+                
+            }
+            
+            // read humidity and temperature while they are shown or the history needs a
+            // sample (the sensors take turns, failed readings are retried at their interval),
+            // stream the indoor one with the time as timestamp
+            reading = DHT11scanService(&sensors, (sources & SOURCE_CLIMATE) || HISTORYdue(&history, utc));
+            
+            if (reading == SENSOR_INDOOR) {
+                
+                data.climate = sensors.sensors[SENSOR_INDOOR].data;
+                temperature  = data.climate.temp_integral * 10 + data.climate.temp_decimal;
+                humidity     = data.climate.humi_integral * 10 + data.climate.humi_decimal;
+                
+                streamHumidityTemperature(&tel, utc, &data.climate);
+                HISTORYadd(&history, utc, temperature, humidity);
+                
+                data.dewpoint  = COMFORTdewPoint(temperature, humidity);
+                data.heatindex = COMFORTheatIndex(temperature, humidity);
+                BOOTmark(BOOT_CLIMATE);
+                
+            } else if (reading == SENSOR_OUTDOOR) {
+                
+                data.outdoor       = sensors.sensors[SENSOR_OUTDOOR].data;
+                data.outdoor_valid = 1;
+                
+            }
 
-                    }
+            // advance the scrolling text
+            if (sources & SOURCE_MARQUEE) {
+                
+                MARQUEEservice(&data.marquee, HALmillis());
+                
+            }
+            
+            // presses on the stopwatch screen count from when the button went down
+            if (button_event != BUTTON_NONE) {
+                
+                cli();
+                event        = button_event;
+                event_at     = button_at;
+                button_event = BUTTON_NONE;
+                sei();
+                
+                if (event == BUTTON_SHORT) {
+                    
+                    STOPWATCHstartStop(&stopwatch, event_at);
+                    
+                } else {
+                    
+                    STOPWATCHlapReset(&stopwatch, event_at);
+                    
+                }
+                
+            }
+            
+            // a countdown that ends brings up its screen
+            if (STOPWATCHservice(&stopwatch, HALmillis())) {
+                
+                mode = SCREEN_WATCH;
+                
+            }
+            
+            if (sources & SOURCE_WATCH) {
+                
+                data.watch = STOPWATCHvalue(&stopwatch, HALmillis());
+                
+            }
+            
+            // redraw what changed, or else read back a few cells of the display
+            drawn = SCREENupdate(&screen, &lcd, &data);
+            
+            // the first frame is up, the bars of the trend screen are only
+            // loaded afterwards (CGRAM changes show on the panel right away)
+            if (!BOOTreached(BOOT_FIRST_FRAME)) {
+                
+                BOOTmark(BOOT_FIRST_FRAME);
+                SPARKLINEload(&lcd);
+                
+            }
+            
+            if (drawn == 0 && HALmillis() - last_scrub >= SCRUB_INTERVAL) {
+                
+                last_scrub = HALmillis();
+                
+                // the controller lost its state, start over as after power on
+                if (SCREENscrub(&screen, &lcd) == SCREEN_SCRUB_LOST) {
+                    
+                    LCDinit(&lcd, 4, 2, 16, LCD_PWM_CONTRAST);
+# if LCD_PWM_CONTRAST
+                    LCDpwmSetContrast(&lcd, settings.data.contrast);
+# endif
+                    SPARKLINEload(&lcd);
+                    SCREENinvalidate(&screen);
                     
                 }
+                
+            }
+            
+            // the alarm stops after a while
+            if (alarm_ringing && HALmillis() - ring_start >= ALARM_RING_TIME) {
+                
+                alarm_ringing = 0;
+                
+            }
+            
+            // check if the mode changed or an alarm started or stopped
+            if ((alarm_ringing ? SCREEN_ALARM : mode) != shown) {
 
                 break;
 
+            }
+
         }
         
     }
@@ -301,17 +1272,83 @@ int main (void) {
 
 
 // ------------------------------------------------------------ //
-// interrupt service routine for INT0
+// interrupt service routine for INT0 (both edges)
 //
-// cycle modes of the digital clock
+// cycle modes of the digital clock when pressed (or dismiss a
+// ringing alarm), on the stopwatch screen the time it was held
+// decides once it is released: start/stop, lap/reset or the
+// next mode
 
 ISR(INT0_vect) {
     
-    mode ++;
+    static uint32_t last_edge = 0;
+    static uint32_t pressed_at;
+    static uint8_t pressed = 0;
+    uint32_t now = HALmillis();
+    uint32_t held;
+    
+    if (now - last_edge < BUTTON_DEBOUNCE_MS) {
+        
+        return;
+        
+    }
+    
+    last_edge = now;
+    
+    // pressed (active low)
+    if (hal_gpio_read(HAL_PORTD, PD2) == 0) {
+        
+        if (alarm_ringing) {
+            
+            alarm_ringing = 0;
+            return;
+            
+        }
+        
+        if (mode == SCREEN_WATCH) {
+            
+            pressed    = 1;
+            pressed_at = now;
+            return;
+            
+        }
+        
+        mode ++;
+        
+        if (mode >= SCREENS) {
+            
+            mode = 0;
+            
+        }
+        
+        return;
+        
+    }
+    
+    // released, only presses that started on the stopwatch screen count
+    if (!pressed) {
+        
+        return;
+        
+    }
+    
+    pressed = 0;
+    held    = now - pressed_at;
     
-    if (mode > 2) {
+    if (mode != SCREEN_WATCH) {
+        
+        return;
+        
+    }
+    
+    if (held >= BUTTON_LEAVE_MS) {
+        
+        mode = (SCREEN_WATCH + 1) % SCREENS;
+        
+    } else {
         
-        mode = 0;
+        button_event = (held >= BUTTON_LONG_MS) ? BUTTON_LONG : BUTTON_SHORT;
+        button_at    = pressed_at;
         
     }
     
@@ -0,0 +1,273 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "marquee.h"
+
+# ifndef HOST
+# include <util/atomic.h>
+# endif
+
+
+// ------------------------------------------------------------ //
+// text in flash (PSTR or PROGMEM)
+
+static char MARQUEEreadProgmem(const void * ctx, uint16_t index) {
+    
+    return pgm_read_byte((const char *) ctx + index);
+    
+}
+
+static uint16_t MARQUEElengthProgmem(const void * ctx) {
+    
+    return strlen_P((const char *) ctx);
+    
+}
+
+void MARQUEEsourceProgmem(marqueeSource * source, const char * text) {
+    
+    source->read   = MARQUEEreadProgmem;
+    source->length = MARQUEElengthProgmem;
+    source->ctx    = text;
+    source->loop   = 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// text in RAM (may be changed while it is shown)
+
+static char MARQUEEreadString(const void * ctx, uint16_t index) {
+    
+    return ((const char *) ctx)[index];
+    
+}
+
+static uint16_t MARQUEElengthString(const void * ctx) {
+    
+    return strlen((const char *) ctx);
+    
+}
+
+void MARQUEEsourceString(marqueeSource * source, const char * text) {
+    
+    source->read   = MARQUEEreadString;
+    source->length = MARQUEElengthString;
+    source->ctx    = text;
+    source->loop   = 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// ring buffer, the length is the number of characters ever
+// written (wraps after 65535), characters that were already
+// overwritten read as spaces
+
+static uint16_t MARQUEElengthRing(const void * ctx) {
+    
+    uint16_t head;
+    
+# ifdef HOST
+    
+    head = ((const marqueeRing *) ctx)->_head;
+    
+# else
+    
+    // the ring may be written from an interrupt
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        
+        head = ((const marqueeRing *) ctx)->_head;
+        
+    }
+    
+# endif
+    
+    return head;
+    
+}
+
+static char MARQUEEreadRing(const void * ctx, uint16_t index) {
+    
+    const marqueeRing * ring = ctx;
+    
+    if ((uint16_t) (MARQUEElengthRing(ctx) - index) > MARQUEE_RING_SIZE) {
+        
+        return ' ';
+        
+    }
+    
+    return ring->_buffer[index & (MARQUEE_RING_SIZE - 1)];
+    
+}
+
+void MARQUEEsourceRing(marqueeSource * source, marqueeRing * ring) {
+    
+    source->read   = MARQUEEreadRing;
+    source->length = MARQUEElengthRing;
+    source->ctx    = ring;
+    source->loop   = 0;
+    
+}
+
+void MARQUEEringInit(marqueeRing * ring) {
+    
+    ring->_head = 0;
+    
+}
+
+// safe to call from an interrupt (single writer)
+void MARQUEEringPut(marqueeRing * ring, char c) {
+    
+    ring->_buffer[ring->_head & (MARQUEE_RING_SIZE - 1)] = c;
+    ring->_head++;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// initialize the marquee
+//
+// width    = number of characters in the window
+// interval = ms per step (lower is faster)
+
+void MARQUEEinit(Marquee * marquee, const marqueeSource * source, uint8_t width, uint16_t interval) {
+    
+    marquee->_source   = *source;
+    marquee->_width    = (width > MARQUEE_MAX_WIDTH) ? MARQUEE_MAX_WIDTH : width;
+    marquee->_interval = interval;
+    
+    MARQUEErestart(marquee, 0);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// change the speed (ms per step)
+
+void MARQUEEsetSpeed(Marquee * marquee, uint16_t interval) {
+    
+    marquee->_interval = interval;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// start over, fixed texts begin left aligned, streams with the
+// window ending at the newest character
+
+void MARQUEErestart(Marquee * marquee, uint32_t now) {
+    
+    uint16_t length = marquee->_source.length(marquee->_source.ctx);
+    
+    if (marquee->_source.loop) {
+        
+        marquee->_step = marquee->_width;
+        
+    } else {
+        
+        marquee->_step = length;
+        
+    }
+    
+    marquee->_last = now;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// advance the window if the interval passed, returns 1 if it
+// moved
+//
+// a stream only moves while there are characters the window has
+// not reached, so text that arrives slowly is not skipped
+
+uint8_t MARQUEEservice(Marquee * marquee, uint32_t now) {
+    
+    uint16_t length;
+    
+    if (now - marquee->_last < marquee->_interval) {
+        
+        return 0;
+        
+    }
+    
+    length = marquee->_source.length(marquee->_source.ctx);
+    
+    if (marquee->_source.loop) {
+        
+        // the last character left the window, let the text enter
+        // again (step 0 would repeat the blank window just shown)
+        if (marquee->_step >= length + marquee->_width) {
+            
+            marquee->_step = 1;
+            
+        } else {
+            
+            marquee->_step++;
+            
+        }
+        
+    } else if (marquee->_step < length) {
+        
+        marquee->_step++;
+        
+    } else if (marquee->_step > length) {
+        
+        // the length of the ring wrapped around
+        marquee->_step = length;
+        
+    } else {
+        
+        // nothing new, the next character is shown once it arrives
+        return 0;
+        
+    }
+    
+    marquee->_last = now;
+    
+    return 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// current step (changes whenever the window does)
+
+uint16_t MARQUEEstep(const Marquee * marquee) {
+    
+    return marquee->_step;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// writes the window into buffer (width characters + '\0'),
+// positions before and after the text are spaces
+
+void MARQUEEwindow(const Marquee * marquee, char * buffer) {
+    
+    uint16_t length = marquee->_source.length(marquee->_source.ctx);
+    uint16_t index  = marquee->_step - marquee->_width;
+    
+    for (uint8_t i = 0; i < marquee->_width; i++, index++) {
+        
+        // also catches indices below 0 (wrapped around)
+        if (index < length) {
+            
+            buffer[i] = marquee->_source.read(marquee->_source.ctx, index);
+            
+        } else {
+            
+            buffer[i] = ' ';
+            
+        }
+        
+    }
+    
+    buffer[marquee->_width] = '\0';
+    
+}
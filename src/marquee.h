@@ -0,0 +1,96 @@
+# ifndef MARQUEE_H
+# define MARQUEE_H
+
+// ------------------------------------------------------------ //
+// scrolling text of any length
+//
+// the marquee is a window of up to MARQUEE_MAX_WIDTH characters
+// that slides over a text source one character per step, the
+// text enters on the right and leaves on the left:
+//
+//   step s shows the characters s - width ... s - 1
+//
+// the window is drawn as a screen field (see screen.h), with the
+// step as its key, so only the cells that change are written
+//
+// sources either have a fixed text that starts over once it has
+// scrolled out (flash or RAM string), or are fed with characters
+// while scrolling (ring buffer, e.g. filled from a serial
+// receiver), then the marquee waits for new characters
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define MARQUEE_MAX_WIDTH    16
+
+// size of the ring buffer source (must be a power of 2)
+# define MARQUEE_RING_SIZE    64
+
+
+// ------------------------------------------------------------ //
+// text sources
+//
+// read:   character at index (only called for index < length)
+// length: number of characters so far
+
+typedef struct marqueeSource {
+    
+    char (*read)(const void * ctx, uint16_t index);
+    uint16_t (*length)(const void * ctx);
+    const void * ctx;
+    
+    // 1 = start over after the text scrolled out, 0 = wait for more
+    uint8_t loop;
+    
+} marqueeSource;
+
+// ring buffer with the last MARQUEE_RING_SIZE characters written
+typedef struct marqueeRing {
+    
+    char _buffer[MARQUEE_RING_SIZE];
+    volatile uint16_t _head;
+    
+} marqueeRing;
+
+
+// ------------------------------------------------------------ //
+// struct for storing the window and the pacing
+
+typedef struct Marquee {
+    
+    marqueeSource _source;
+    
+    // window width and current step
+    uint8_t _width;
+    uint16_t _step;
+    
+    // ms per step and time of the last step
+    uint16_t _interval;
+    uint32_t _last;
+    
+} Marquee;
+
+
+// ------------------------------------------------------------ //
+// text sources
+
+void MARQUEEsourceProgmem(marqueeSource * source, const char * text);
+void MARQUEEsourceString(marqueeSource * source, const char * text);
+void MARQUEEsourceRing(marqueeSource * source, marqueeRing * ring);
+
+void MARQUEEringInit(marqueeRing * ring);
+void MARQUEEringPut(marqueeRing * ring, char c);
+
+
+// ------------------------------------------------------------ //
+// user commands for the marquee
+
+void MARQUEEinit(Marquee * marquee, const marqueeSource * source, uint8_t width, uint16_t interval);
+void MARQUEEsetSpeed(Marquee * marquee, uint16_t interval);
+void MARQUEErestart(Marquee * marquee, uint32_t now);
+uint8_t MARQUEEservice(Marquee * marquee, uint32_t now);
+uint16_t MARQUEEstep(const Marquee * marquee);
+void MARQUEEwindow(const Marquee * marquee, char * buffer);
+
+# endif
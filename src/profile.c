@@ -0,0 +1,187 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+
+# include "hal.h"
+# include "profile.h"
+
+# ifdef PROFILE
+
+# ifndef HOST
+# include <util/atomic.h>
+# endif
+
+# include "uart.h"
+
+
+// -------------------------------------------------- //
+// statistics table, high word of the cycle counter and
+// cost of an empty PROFILE_BEGIN/PROFILE_END pair
+
+static profileEntry profile_table[PROFILE_SLOTS];
+static volatile uint16_t profile_overflows = 0;
+static uint16_t profile_overhead = 0;
+
+static const char profile_name_lcdsend[] PROGMEM          = "LCDsend";
+static const char profile_name_lcdbegintransfer[] PROGMEM = "LCDbeginTransfer";
+static const char profile_name_ds1302read[] PROGMEM       = "DS1302readTimeData";
+static const char profile_name_dht11read[] PROGMEM        = "DHT11readData";
+static const char profile_name_formattime[] PROGMEM       = "formatTime";
+static const char profile_name_formatdate[] PROGMEM       = "formatDate";
+static const char profile_name_formathumi[] PROGMEM       = "formatHumidity";
+static const char profile_name_formattemp[] PROGMEM       = "formatTemperature";
+static const char profile_name_dewpoint[] PROGMEM         = "COMFORTdewPoint";
+static const char profile_name_heatindex[] PROGMEM        = "COMFORTheatIndex";
+
+static PGM_P const profile_names[PROFILE_SLOTS] PROGMEM = {
+    profile_name_lcdsend,
+    profile_name_lcdbegintransfer,
+    profile_name_ds1302read,
+    profile_name_dht11read,
+    profile_name_formattime,
+    profile_name_formatdate,
+    profile_name_formathumi,
+    profile_name_formattemp,
+    profile_name_dewpoint,
+    profile_name_heatindex
+};
+
+
+// -------------------------------------------------- //
+// start timer1 in normal mode without prescaler and
+// measure the overhead of the instrumentation
+
+void PROFILEinit(void) {
+    
+    uint32_t start;
+    
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10);
+    TIMSK1 = (1 << TOIE1);
+    
+    start = PROFILEcycles();
+    profile_overhead = PROFILEcycles() - start;
+    
+    PROFILEreset();
+    
+}
+
+
+// -------------------------------------------------- //
+// returns the 32-bit cycle counter
+//
+// on the host the simulated time is converted to cycles
+
+uint32_t PROFILEcycles(void) {
+    
+# ifdef HOST
+    
+    return HALhostCycles();
+    
+# else
+    
+    uint16_t low;
+    uint16_t high;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        
+        low  = TCNT1;
+        high = profile_overflows;
+        
+        // an overflow that has not been serviced yet
+        if ((TIFR1 & (1 << TOV1)) && low < 0x8000) {
+            
+            high++;
+            
+        }
+        
+    }
+    
+    return ((uint32_t) high << 16) | low;
+    
+# endif
+    
+}
+
+
+// -------------------------------------------------- //
+// adds one measurement to the table
+
+void PROFILErecord(uint8_t slot, uint32_t cycles) {
+    
+    profileEntry * entry = &profile_table[slot];
+    
+    cycles = (cycles > profile_overhead) ? cycles - profile_overhead : 0;
+    
+    entry->calls++;
+    entry->total_cycles += cycles;
+    
+    if (cycles > entry->max_cycles) {
+        
+        entry->max_cycles = cycles;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// clears the table
+
+void PROFILEreset(void) {
+    
+    for (uint8_t i = 0; i < PROFILE_SLOTS; i++) {
+        
+        profile_table[i].calls        = 0;
+        profile_table[i].total_cycles = 0;
+        profile_table[i].max_cycles   = 0;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// prints the table over the serial port
+//
+// one line per function: name calls total max (cycles)
+// the text goes out between the telemetry frames, delimited by
+// 0x00 like a frame (see uart.h), so the decoder sets it aside
+// without losing the frames around it
+
+void PROFILEdump(void) {
+    
+    char line[64];
+    
+    UARTprint_P(PSTR("# profile: function calls total_cycles max_cycles\r\n"));
+    
+    for (uint8_t i = 0; i < PROFILE_SLOTS; i++) {
+        
+        UARTprint_P(pgm_read_ptr(&profile_names[i]));
+        snprintf_P(line, sizeof(line), PSTR(" %lu %lu %lu\r\n"),
+                (unsigned long) profile_table[i].calls,
+                (unsigned long) profile_table[i].total_cycles,
+                (unsigned long) profile_table[i].max_cycles);
+        UARTprint(line);
+        
+    }
+    
+    UARTendText();
+    
+}
+
+
+// -------------------------------------------------- //
+// interrupt service routine for timer1 overflow
+//
+// extends the counter to 32 bits
+
+ISR(TIMER1_OVF_vect) {
+    
+    profile_overflows++;
+    
+}
+
+# endif
@@ -0,0 +1,74 @@
+# ifndef PROFILE_H
+# define PROFILE_H
+
+// ------------------------------------------------------------ //
+// hot-path profiler
+//
+// enable with "make PROFILE=1", otherwise all macros expand to
+// nothing and no timer, table or code is added to the firmware
+//
+// timer1 runs freely at F_CPU, so the stamps are cpu cycles
+// (extended to 32 bits by the overflow interrupt)
+
+
+// ------------------------------------------------------------ //
+// profiled functions (index into the table)
+
+enum profileSlots {
+    PROF_LCDSEND = 0,
+    PROF_LCDBEGINTRANSFER,
+    PROF_DS1302READTIMEDATA,
+    PROF_DHT11READDATA,
+    PROF_FORMATTIME,
+    PROF_FORMATDATE,
+    PROF_FORMATHUMIDITY,
+    PROF_FORMATTEMPERATURE,
+    PROF_DEWPOINT,
+    PROF_HEATINDEX,
+    PROFILE_SLOTS
+};
+
+
+# ifdef PROFILE
+
+// ------------------------------------------------------------ //
+// struct for storing the statistics of one function
+
+typedef struct profileEntry {
+    
+    uint32_t calls;
+    uint32_t total_cycles;
+    uint32_t max_cycles;
+    
+} profileEntry;
+
+
+// ------------------------------------------------------------ //
+// instrumentation macros, place at the start and end of a function
+// (calls of nested profiled functions are included in the cycles)
+
+# define PROFILE_BEGIN(slot)    uint32_t _profile_start_##slot = PROFILEcycles()
+# define PROFILE_END(slot)      PROFILErecord(slot, PROFILEcycles() - _profile_start_##slot)
+
+
+// ------------------------------------------------------------ //
+// initialization, recording and readout
+
+void PROFILEinit(void);
+uint32_t PROFILEcycles(void);
+void PROFILErecord(uint8_t slot, uint32_t cycles);
+void PROFILEreset(void);
+void PROFILEdump(void);
+
+# else
+
+# define PROFILE_BEGIN(slot)
+# define PROFILE_END(slot)
+
+# define PROFILEinit()
+# define PROFILEreset()
+# define PROFILEdump()
+
+# endif
+
+# endif
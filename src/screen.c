@@ -0,0 +1,316 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "lcd.h"
+# include "screen.h"
+
+
+// ------------------------------------------------------------ //
+// initialize before the first SCREENshow
+
+void SCREENinit(Screen * screen) {
+    
+    screen->_scrub        = 0;
+    screen->scrub_reads   = 0;
+    screen->scrub_repairs = 0;
+    screen->scrub_losses  = 0;
+    screen->scrub_us      = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// switch to another layout, everything is drawn on the next
+// update (after clearing the display)
+
+void SCREENshow(Screen * screen, const screenLayout * layout) {
+    
+    memcpy_P(&screen->_layout, layout, sizeof(screen->_layout));
+    screen->redraws = 0;
+    screen->cells   = 0;
+    
+    SCREENinvalidate(screen);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// redraw the whole screen on the next update
+
+void SCREENinvalidate(Screen * screen) {
+    
+    screen->_valid = 0;
+    screen->_clear = 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// redraw one field on the next update, even if its key is the
+// same (e.g. after something else wrote over its cells)
+
+void SCREENinvalidateField(Screen * screen, uint8_t field) {
+    
+    screenField description;
+    
+    uint16_t cell;
+    
+    memcpy_P(&description, &screen->_layout.fields[field], sizeof(description));
+    screen->_valid &= ~(1 << field);
+    
+    // the whole shadow is reset with the next clear
+    if (screen->_clear) {
+        
+        return;
+        
+    }
+    
+    // no character matches '\0', so every cell is written again
+    cell = description.row * screen->_cols + description.col;
+    
+    for (uint8_t j = 0; j < description.width; j++, cell++) {
+        
+        screen->_shadow[cell % screen->_cells] = '\0';
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// redraw the fields whose data changed, returns how many were
+// drawn
+//
+// a redrawn field only writes the cells that differ from the
+// shadow copy of the display, each run of changed cells costs
+// one cursor command plus one write per cell (and LCDcharacter
+// moves the cursor where a run crosses the end of a row), the
+// pass stops once the LCD has no room for both of them, or for
+// SCREEN_RUN_ROOM bytes before a run
+
+uint8_t SCREENupdate(Screen * screen, LCD * lcd, const void * data) {
+    
+    screenField field;
+    char buffer[SCREEN_MAX_WIDTH + 1];
+    uint16_t cell;
+    uint8_t run;
+    uint16_t key;
+    uint8_t drawn = 0;
+    uint8_t i;
+    
+    if (screen->_clear) {
+        
+        LCDclearDisplay(lcd);
+        memset(screen->_shadow, ' ', sizeof(screen->_shadow));
+        screen->_clear = 0;
+        
+        // panels larger than the shadow only use its first cells
+        screen->_cols  = (lcd->_cols > SCREEN_MAX_WIDTH) ? SCREEN_MAX_WIDTH : lcd->_cols;
+        screen->_cells = screen->_cols * ((lcd->_rows > SCREEN_MAX_ROWS) ? SCREEN_MAX_ROWS : lcd->_rows);
+        
+    }
+    
+    for (i = 0; i < screen->_layout.count; i++) {
+        
+        memcpy_P(&field, &screen->_layout.fields[i], sizeof(field));
+        key = field.key(data);
+        
+        if ((screen->_valid & (1 << i)) && screen->_keys[i] == key) {
+            
+            continue;
+            
+        }
+        
+        // format and pad to the width of the field
+        buffer[0] = '\0';
+        field.format(buffer, data);
+        
+        for (uint8_t j = 0; j < field.width; j++) {
+            
+            if (buffer[j] == '\0') {
+                
+                buffer[j] = ' ';
+                buffer[j + 1] = '\0';
+                
+            }
+            
+        }
+        
+        // write the changed cells
+        cell = (field.row * screen->_cols + field.col) % screen->_cells;
+        run = 0;
+        
+        for (uint8_t j = 0; j < field.width; j++) {
+            
+            if (screen->_shadow[cell] == buffer[j]) {
+                
+                run = 0;
+                
+            } else {
+                
+                // the queue is full, the rest of the field is drawn by the next pass
+                if (LCDroom(lcd) < (run ? 2 : SCREEN_RUN_ROOM)) {
+                    
+                    screen->_valid &= ~(1 << i);
+                    screen->redraws += drawn;
+                    
+                    return drawn;
+                    
+                }
+                
+                if (!run) {
+                    
+                    LCDsetCursorPosition(lcd, cell / screen->_cols, cell % screen->_cols);
+                    run = 1;
+                    
+                }
+                
+                LCDcharacter(lcd, buffer[j]);
+                screen->_shadow[cell] = buffer[j];
+                screen->cells ++;
+                
+            }
+            
+            // past the last cell of the panel, the next one is the first
+            if (++cell == screen->_cells) {
+                
+                cell = 0;
+                
+            }
+            
+            // the rows of a panel wider than the shadow do not continue each other
+            if (screen->_cols != lcd->_cols && cell % screen->_cols == 0) {
+                
+                run = 0;
+                
+            }
+            
+        }
+        
+        screen->_keys[i] = key;
+        screen->_valid |= (1 << i);
+        drawn ++;
+        
+    }
+    
+    screen->redraws += drawn;
+    
+    return drawn;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// reads back the next cells (up to the end of their row), writes
+// the ones that differ from the shadow again and returns how many
+// that were, or SCREEN_SCRUB_LOST
+//
+// cells of fields waiting for a redraw ('\0' in the shadow) are
+// skipped, nothing is read before the first update
+
+uint8_t SCREENscrub(Screen * screen, LCD * lcd) {
+    
+    uint32_t start = HALmicros();
+    uint8_t row;
+    uint8_t col;
+    uint8_t count;
+    uint8_t repaired = 0;
+    uint8_t address;
+    uint8_t lost;
+    uint8_t run;
+    char cells[SCREEN_SCRUB_CELLS];
+    char * shadow;
+    
+    if (screen->_clear || lcd->_rw_pin == 0xFF) {
+        
+        return 0;
+        
+    }
+    
+    if (screen->_scrub >= screen->_cells) {
+        
+        screen->_scrub = 0;
+        
+    }
+    
+    row   = screen->_scrub / screen->_cols;
+    col   = screen->_scrub % screen->_cols;
+    count = screen->_cols - col;
+    
+    if (count > SCREEN_SCRUB_CELLS) {
+        
+        count = SCREEN_SCRUB_CELLS;
+        
+    }
+    
+    address = (lcd->_row_address[row] & 0x7F) + col;
+    LCDsetCursorPosition(lcd, row, col);
+    lost = (LCDreadAddress(lcd) != address);
+    
+    for (uint8_t j = 0; j < count; j++) {
+        
+        cells[j] = LCDreadCharacter(lcd);
+        
+    }
+    
+    // after the reads the address counter has to be count cells further (a controller
+    // that fell back to 8 bits takes every nibble for a byte and moves twice as far)
+    address += count;
+    
+    if (lcd->_rows == 1) {
+        
+        address = (address == 0x50) ? 0x00 : address;
+        
+    } else {
+        
+        address = (address == 0x28) ? 0x40 : (address == 0x68) ? 0x00 : address;
+        
+    }
+    
+    if (lost || LCDreadAddress(lcd) != address) {
+        
+        screen->scrub_losses++;
+        screen->scrub_us += HALmicros() - start;
+        
+        return SCREEN_SCRUB_LOST;
+        
+    }
+    
+    // write the cells that differ, each run after setting its address (reads
+    // and writes do not share the address counter without it)
+    shadow = &screen->_shadow[screen->_scrub];
+    run = 0;
+    
+    for (uint8_t j = 0; j < count; j++) {
+        
+        if (shadow[j] == '\0' || shadow[j] == cells[j]) {
+            
+            run = 0;
+            continue;
+            
+        }
+        
+        if (!run) {
+            
+            LCDsetCursorPosition(lcd, row, col + j);
+            run = 1;
+            
+        }
+        
+        LCDcharacter(lcd, shadow[j]);
+        repaired++;
+        
+    }
+    
+    screen->scrub_reads += count;
+    screen->_scrub += count;
+    screen->scrub_repairs += repaired;
+    screen->scrub_us += HALmicros() - start;
+    
+    return repaired;
+    
+}
@@ -0,0 +1,150 @@
+# ifndef SCREEN_H
+# define SCREEN_H
+
+// ------------------------------------------------------------ //
+// declarative screens made of fields
+//
+// a screen is a table of fields at fixed positions, each field
+// has a key function that condenses the data it shows into a
+// number, and a formatter that writes its text:
+//
+//   row | col | width | key(data) | format(buffer, data)
+//
+// SCREENupdate only redraws the fields whose key changed since
+// they were last drawn, so e.g. the date is written once a day
+// instead of on every pass of the main loop, and of those only
+// the cells that differ from a shadow copy of the display
+//
+// field and layout tables are kept in flash (PROGMEM), the
+// active layout is copied to the Screen struct by SCREENshow
+//
+// the shadow holds the cells row after row as the panel shows
+// them, a field that runs past the end of its row continues at
+// the start of the next one (as LCDprint does), whatever DDRAM
+// address that row has
+//
+// a pass stops at a cell the LCD cannot take without waiting
+// for its queue (I2C backpack, shared bus), the field stays
+// invalid and the next pass continues where the shadow differs,
+// so a redraw is spread over the passes instead of stalling one
+
+
+// ------------------------------------------------------------ //
+// limits
+
+# define SCREEN_MAX_FIELDS    8
+
+// largest panel (e.g. 4 and 20 for a 20x4 panel, costs a byte
+// of RAM per cell)
+# ifndef SCREEN_MAX_ROWS
+# define SCREEN_MAX_ROWS      2
+# endif
+
+# ifndef SCREEN_MAX_WIDTH
+# define SCREEN_MAX_WIDTH     16
+# endif
+
+
+// ------------------------------------------------------------ //
+// read-back of the display (only with the rw pin of the LCD wired)
+//
+// SCREENscrub reads SCREEN_SCRUB_CELLS cells of DDRAM per call and
+// compares them with the shadow, cells that differ (e.g. after
+// noise on the bus) are written again, the next call continues
+// where the last one stopped
+//
+// before and after reading, the address counter has to read back
+// as the address that was set and the one behind the last cell,
+// otherwise the controller lost its state (reset by a brown-out,
+// out of step in 4-bit mode) and only a new LCDinit helps
+
+# define SCREEN_SCRUB_CELLS   4
+
+// room (LCDroom) a run of changed cells needs to start, so a
+// redraw that waits for the queue of the LCD goes on in runs
+// instead of a cursor command per cell
+# define SCREEN_RUN_ROOM      8
+
+// returned by SCREENscrub if the LCD has to be initialized again
+# define SCREEN_SCRUB_LOST    0xFF
+
+
+// ------------------------------------------------------------ //
+// field and screen descriptions (const tables in PROGMEM)
+
+typedef struct screenField {
+    
+    // position and number of cells (the text is padded with spaces)
+    uint8_t row;
+    uint8_t col;
+    uint8_t width;
+    
+    // value that changes whenever the text would change
+    uint16_t (*key)(const void * data);
+    
+    // writes at most width characters (null terminated)
+    void (*format)(char * buffer, const void * data);
+    
+} screenField;
+
+typedef struct screenLayout {
+    
+    const screenField * fields;
+    uint8_t count;
+    
+    // data sources the application refreshes for this screen
+    uint8_t sources;
+    
+} screenLayout;
+
+
+// ------------------------------------------------------------ //
+// struct for storing the active layout and the drawn state
+
+typedef struct Screen {
+    
+    screenLayout _layout;
+    
+    // key of each field when it was last drawn
+    uint16_t _keys[SCREEN_MAX_FIELDS];
+    
+    // bit per field, set when its cells are up to date
+    uint8_t _valid;
+    
+    // display has to be cleared before the next update
+    uint8_t _clear;
+    
+    // what the display currently shows (row * cols + col) and the
+    // number of columns of the panel
+    char _shadow[SCREEN_MAX_ROWS * SCREEN_MAX_WIDTH];
+    uint8_t _cols;
+    uint8_t _cells;
+    
+    // number of fields drawn and cells written since SCREENshow
+    uint16_t redraws;
+    uint16_t cells;
+    
+    // next cell to read back
+    uint8_t _scrub;
+    
+    // cells read back and written again, lost controller states and
+    // time spent reading back (us, never reset)
+    uint32_t scrub_reads;
+    uint16_t scrub_repairs;
+    uint16_t scrub_losses;
+    uint32_t scrub_us;
+    
+} Screen;
+
+
+// ------------------------------------------------------------ //
+// user commands for showing screens
+
+void SCREENinit(Screen * screen);
+void SCREENshow(Screen * screen, const screenLayout * layout);
+void SCREENinvalidate(Screen * screen);
+void SCREENinvalidateField(Screen * screen, uint8_t field);
+uint8_t SCREENupdate(Screen * screen, LCD * lcd, const void * data);
+uint8_t SCREENscrub(Screen * screen, LCD * lcd);
+
+# endif
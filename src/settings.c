@@ -0,0 +1,247 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "lcd.h"
+# include "settings.h"
+# include "telemetry.h"
+# include "timezone.h"
+# include "uart.h"
+
+
+// -------------------------------------------------- //
+// default settings (used if no valid slot is found)
+
+static const settingsData settings_default PROGMEM = {
+    
+    LCD_DEFAULT_CONTRAST,   // contrast
+    0,                      // 24h mode
+    0,                      // clock screen
+    0,                      // keep RTC time
+    0                       // UTC
+    
+};
+
+
+// -------------------------------------------------- //
+// fields that can be changed on the console (name, field and
+// largest value)
+
+typedef struct settingsCommand {
+    
+    char name[SETTINGS_NAME_MAX];
+    uint8_t field;
+    uint8_t max;
+    
+} settingsCommand;
+
+// (the contrast of the I2C backpack is set by its potentiometer)
+static const settingsCommand settings_commands[] PROGMEM = {
+# ifndef LCD_I2C
+    {"contrast",  SETTING_CONTRAST,   255},
+# endif
+    {"clockmode", SETTING_CLOCKMODE,  1},
+    {"reinit",    SETTING_REINITTIME, 1},
+    {"tz",        SETTING_TIMEZONE,   TZ_ZONES - 1},
+};
+
+# define SETTINGS_COMMANDS (sizeof(settings_commands) / sizeof(settings_commands[0]))
+
+
+// -------------------------------------------------- //
+// reads a slot and checks it, returns 1 if it is valid
+
+static uint8_t SETTINGSreadSlot(uint8_t slot, uint8_t * buffer) {
+    
+    uint16_t address = SETTINGS_EEPROM_BASE + slot * SETTINGS_SLOT_SIZE;
+    
+    for (uint8_t i = 0; i < SETTINGS_SLOT_SIZE; i++) {
+        
+        buffer[i] = hal_eeprom_read(address + i);
+        
+    }
+    
+    // same crc as the telemetry frames
+    return buffer[1] == SETTINGS_VERSION &&
+           TELcrc8(buffer, SETTINGS_SLOT_SIZE - 1) == buffer[SETTINGS_SLOT_SIZE - 1];
+    
+}
+
+
+// -------------------------------------------------- //
+// loads the newest valid slot or the defaults
+
+void SETTINGSload(Settings * settings) {
+    
+    uint8_t buffer[SETTINGS_SLOT_SIZE];
+    uint8_t next[SETTINGS_SLOT_SIZE];
+    uint8_t found = 0;
+    
+    memcpy_P(&settings->data, &settings_default, sizeof(settings->data));
+    settings->_slot     = SETTINGS_SLOTS - 1;
+    settings->_sequence = 0xFF;
+    settings->_dirty    = 0;
+    settings->_write_pos = 0xFF;
+    settings->commits   = 0;
+    
+    for (uint8_t slot = 0; slot < SETTINGS_SLOTS && !found; slot++) {
+        
+        if (!SETTINGSreadSlot(slot, buffer)) {
+            
+            continue;
+            
+        }
+        
+        // the newest slot is not followed by its successor in the sequence
+        if (SETTINGSreadSlot((slot + 1) % SETTINGS_SLOTS, next) && next[0] == (uint8_t) (buffer[0] + 1)) {
+            
+            continue;
+            
+        }
+        
+        found = 1;
+        settings->_slot     = slot;
+        settings->_sequence = buffer[0];
+        
+        for (uint8_t i = 0; i < SETTINGS_FIELDS; i++) {
+            
+            ((uint8_t *) &settings->data)[i] = buffer[2 + i];
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// changes a field, the commit is deferred until no
+// change happened for SETTINGS_COMMIT_DELAY ms
+
+void SETTINGSset(Settings * settings, uint8_t field, uint8_t value, uint32_t now) {
+    
+    uint8_t * data = (uint8_t *) &settings->data;
+    
+    if (data[field] == value) {
+        
+        return;
+        
+    }
+    
+    data[field] = value;
+    settings->_dirty   = 1;
+    settings->_changed = now;
+    
+}
+
+
+// -------------------------------------------------- //
+// call regularly from the main loop, starts a pending
+// commit and writes at most one byte per call
+
+void SETTINGSservice(Settings * settings, uint32_t now) {
+    
+    uint16_t address;
+    
+    // start a commit once the changes have settled
+    if (settings->_write_pos == 0xFF) {
+        
+        if (!settings->_dirty || now - settings->_changed < SETTINGS_COMMIT_DELAY) {
+            
+            return;
+            
+        }
+        
+        settings->_dirty = 0;
+        settings->_slot  = (settings->_slot + 1) % SETTINGS_SLOTS;
+        settings->_sequence++;
+        
+        settings->_buffer[0] = settings->_sequence;
+        settings->_buffer[1] = SETTINGS_VERSION;
+        
+        for (uint8_t i = 0; i < SETTINGS_FIELDS; i++) {
+            
+            settings->_buffer[2 + i] = ((uint8_t *) &settings->data)[i];
+            
+        }
+        
+        settings->_buffer[SETTINGS_SLOT_SIZE - 1] = TELcrc8(settings->_buffer, SETTINGS_SLOT_SIZE - 1);
+        settings->_write_pos = 0;
+        
+    }
+    
+    // previous byte still being written
+    if (!hal_eeprom_ready()) {
+        
+        return;
+        
+    }
+    
+    // unchanged bytes are skipped by the update
+    address = SETTINGS_EEPROM_BASE + settings->_slot * SETTINGS_SLOT_SIZE + settings->_write_pos;
+    hal_eeprom_update(address, settings->_buffer[settings->_write_pos]);
+    
+    if (++settings->_write_pos == SETTINGS_SLOT_SIZE) {
+        
+        settings->_write_pos = 0xFF;
+        settings->commits++;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// console command, "set" prints the fields that can be changed,
+// "set <name> <value>" changes one of them (committed like any
+// other change), returns the field that changed or
+// SETTINGS_FIELDS
+
+uint8_t SETTINGScommand(Settings * settings, const char * args, uint32_t now) {
+    
+    char name[SETTINGS_NAME_MAX];
+    char line[24];
+    unsigned int value;
+    uint8_t field;
+    
+    if (*args == '\0') {
+        
+        for (uint8_t i = 0; i < SETTINGS_COMMANDS; i++) {
+            
+            strcpy_P(name, settings_commands[i].name);
+            field = pgm_read_byte(&settings_commands[i].field);
+            snprintf_P(line, sizeof(line), PSTR("%s %u\r\n"), name, ((const uint8_t *) &settings->data)[field]);
+            UARTprint(line);
+            
+        }
+        
+        return SETTINGS_FIELDS;
+        
+    }
+    
+    if (sscanf_P(args, PSTR("%9s %u"), name, &value) == 2) {
+        
+        for (uint8_t i = 0; i < SETTINGS_COMMANDS; i++) {
+            
+            if (strcmp_P(name, settings_commands[i].name) == 0 && value <= pgm_read_byte(&settings_commands[i].max)) {
+                
+                field = pgm_read_byte(&settings_commands[i].field);
+                SETTINGSset(settings, field, value, now);
+                
+                return field;
+                
+            }
+            
+        }
+        
+    }
+    
+    UARTprint_P(PSTR("error: set [<name> <value>]\r\n"));
+    
+    return SETTINGS_FIELDS;
+    
+}
@@ -0,0 +1,110 @@
+# ifndef SETTINGS_H
+# define SETTINGS_H
+
+// ------------------------------------------------------------ //
+// persistent settings in EEPROM
+//
+// the record is stored in a ring of slots, every commit goes to
+// the next slot, so the wear is spread over all of them:
+//
+//   sequence | version | settings ... | crc8
+//
+// the newest slot is the valid one whose successor does not
+// continue the sequence, a slot that was interrupted while being
+// written fails the crc and the previous one is used instead
+//
+// changes are only committed after SETTINGS_COMMIT_DELAY ms
+// without further changes, and the commit writes one byte per
+// call of SETTINGSservice (only when the EEPROM is ready), so the
+// main loop never waits for the ~3.3 ms write time
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define SETTINGS_VERSION         2
+# define SETTINGS_EEPROM_BASE     0
+# define SETTINGS_SLOTS           16
+# define SETTINGS_COMMIT_DELAY    5000
+
+// longest name of a field on the console (incl. terminator)
+# define SETTINGS_NAME_MAX        10
+
+
+// ------------------------------------------------------------ //
+// the settings record (index of each field for SETTINGSset)
+
+enum settingsFields {
+    SETTING_CONTRAST = 0,
+    SETTING_CLOCKMODE,
+    SETTING_BOOTMODE,
+    SETTING_REINITTIME,
+    SETTING_TIMEZONE,
+    SETTINGS_FIELDS
+};
+
+typedef struct settingsData {
+    
+    // lcd contrast (timer2 pwm duty cycle)
+    uint8_t contrast;
+    
+    // clock mode (1 = 12h, 0 = 24h)
+    uint8_t clockmode;
+    
+    // display mode after power on
+    uint8_t bootmode;
+    
+    // write the compile time to the RTC on the next boot
+    uint8_t reinit_time;
+    
+    // time zone of the display (enum timezones, the RTC runs on UTC)
+    uint8_t timezone;
+    
+} settingsData;
+
+// sequence, version, fields, crc
+# define SETTINGS_SLOT_SIZE       (SETTINGS_FIELDS + 3)
+
+
+// ------------------------------------------------------------ //
+// struct for storing the settings and the commit state
+
+typedef struct Settings {
+    
+    settingsData data;
+    
+    // slot and sequence number of the last commit
+    uint8_t _slot;
+    uint8_t _sequence;
+    
+    // pending changes
+    uint8_t _dirty;
+    uint32_t _changed;
+    
+    // commit in progress (0xFF = none)
+    uint8_t _write_pos;
+    uint8_t _buffer[SETTINGS_SLOT_SIZE];
+    
+    // number of commits since power on
+    uint16_t commits;
+    
+} Settings;
+
+
+// ------------------------------------------------------------ //
+// loading, changing and committing
+
+void SETTINGSload(Settings * settings);
+void SETTINGSset(Settings * settings, uint8_t field, uint8_t value, uint32_t now);
+void SETTINGSservice(Settings * settings, uint32_t now);
+
+
+// ------------------------------------------------------------ //
+// console command ("set", "set <name> <value>"), the names are
+// contrast (0-255, not in an LCD_I2C build), clockmode (1 = 12h),
+// reinit (1 = write the compile time to the RTC on the next boot)
+// and tz (enum timezones)
+
+uint8_t SETTINGScommand(Settings * settings, const char * args, uint32_t now);
+
+# endif
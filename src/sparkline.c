@@ -0,0 +1,103 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "lcd.h"
+# include "history.h"
+# include "sparkline.h"
+
+
+// ------------------------------------------------------------ //
+// bars of 1 to 8 pixels (bottom aligned)
+
+static const uint8_t sparkline_glyphs[SPARKLINE_LEVELS][8] PROGMEM = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+};
+
+
+// ------------------------------------------------------------ //
+// loads the bars into CGRAM (once after LCDinit)
+
+void SPARKLINEload(LCD * lcd) {
+    
+    uint8_t pattern[8];
+    
+    for (uint8_t level = 0; level < SPARKLINE_LEVELS; level++) {
+        
+        memcpy_P(pattern, sparkline_glyphs[level], sizeof(pattern));
+        LCDcustomCharacter(lcd, level, pattern);
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// level of a value between min and max (1-8, rounded), a flat
+// history is drawn at half height
+
+uint8_t SPARKLINElevel(int16_t value, int16_t min, int16_t max) {
+    
+    uint16_t range = max - min;
+    
+    if (range == 0) {
+        
+        return SPARKLINE_LEVELS / 2;
+        
+    }
+    
+    return 1 + ((uint32_t) (value - min) * (SPARKLINE_LEVELS - 1) + range / 2) / range;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// writes the bars of the newest samples into buffer (width
+// characters + '\0'), one column per interval
+
+void SPARKLINEformat(char * buffer, const History * history, uint8_t value, uint8_t width) {
+    
+    const historyStats * stats = HISTORYstats(history, value);
+    int16_t values[HISTORY_VALUES];
+    uint32_t newest;
+    uint32_t time;
+    uint32_t column;
+    
+    memset(buffer, ' ', width);
+    buffer[width] = '\0';
+    
+    if (HISTORYcount(history) == 0) {
+        
+        return;
+        
+    }
+    
+    newest = HISTORYget(history, 0, values);
+    
+    // walk back until the samples are left of the graph
+    for (uint16_t age = 0; age < HISTORYcount(history); age++) {
+        
+        time   = HISTORYget(history, age, values);
+        column = (newest - time) / HISTORY_INTERVAL;
+        
+        if (column >= width) {
+            
+            break;
+            
+        }
+        
+        buffer[width - 1 - column] = SPARKLINE_GLYPH(SPARKLINElevel(values[value], stats->min, stats->max));
+        
+    }
+    
+}
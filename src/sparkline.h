@@ -0,0 +1,35 @@
+# ifndef SPARKLINE_H
+# define SPARKLINE_H
+
+// ------------------------------------------------------------ //
+// trend of the history as a bar graph, one character per sample
+//
+// the 8 custom characters hold bars of 1 to 8 pixels, they are
+// loaded once and never change, so a new sample only rewrites
+// the characters of the columns whose bar changed (at most one
+// line, see screen.h)
+//
+// the bars are scaled between minimum and maximum of the last
+// 24 h, so the scale only moves when an extreme enters or leaves
+// the history, the newest sample is in the rightmost column and
+// missed samples stay empty
+//
+// the characters are used with the codes 8-15 (same CGRAM as
+// 0-7), so a line of bars is still a string
+
+
+// ------------------------------------------------------------ //
+// settings
+
+# define SPARKLINE_LEVELS         8
+# define SPARKLINE_GLYPH(level)   (0x08 + (level) - 1)
+
+
+// ------------------------------------------------------------ //
+// user commands for the bar graph
+
+void SPARKLINEload(LCD * lcd);
+uint8_t SPARKLINElevel(int16_t value, int16_t min, int16_t max);
+void SPARKLINEformat(char * buffer, const History * history, uint8_t value, uint8_t width);
+
+# endif
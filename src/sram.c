@@ -0,0 +1,183 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+# include <stdlib.h>
+
+# include "hal.h"
+# include "sram.h"
+
+
+// ------------------------------------------------------------ //
+// heap counters
+
+static sramHeap sram_heap;
+
+
+# ifndef HOST
+
+// ------------------------------------------------------------ //
+// linker symbols and the malloc of avr-libc
+
+extern uint8_t __heap_start;
+extern char * __brkval;
+
+void * __real_malloc(size_t size);
+void __real_free(void * block);
+
+
+// ------------------------------------------------------------ //
+// paints everything above the static variables, runs from .init1
+// (before the stack pointer is set up and anything is on the
+// stack, so it cannot use any)
+
+void SRAMpaint(void) __attribute__((naked, used, section(".init1")));
+
+void SRAMpaint(void) {
+    
+    __asm__ volatile (
+        "    ldi r30, lo8(__heap_start)\n"
+        "    ldi r31, hi8(__heap_start)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(%1)\n"
+        "1:  st Z+, r24\n"
+        "    cpi r30, lo8(%1)\n"
+        "    cpc r31, r25\n"
+        "    brne 1b\n"
+        :: "i" (SRAM_CANARY), "i" (RAMEND + 1)
+    );
+    
+}
+
+
+// ------------------------------------------------------------ //
+// first byte above the heap (the heap is empty until the first
+// malloc)
+
+static uint8_t * SRAMheapEnd(void) {
+    
+    return __brkval ? (uint8_t *) __brkval : &__heap_start;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// painted bytes above the heap that were never written
+
+uint16_t SRAMunused(void) {
+    
+    uint8_t * p = SRAMheapEnd();
+    
+    while (p <= (uint8_t *) RAMEND && *p == SRAM_CANARY) {
+        
+        p++;
+        
+    }
+    
+    return p - SRAMheapEnd();
+    
+}
+
+
+// ------------------------------------------------------------ //
+// most bytes the stack ever used (high-water mark)
+
+uint16_t SRAMstackPeak(void) {
+    
+    return ((uint8_t *) RAMEND + 1 - SRAMheapEnd()) - SRAMunused();
+    
+}
+
+
+// ------------------------------------------------------------ //
+// bytes between the heap and the stack pointer right now
+
+uint16_t SRAMfree(void) {
+    
+    return (uint8_t *) SP - SRAMheapEnd();
+    
+}
+
+
+// ------------------------------------------------------------ //
+// counting malloc and free (avr-libc keeps the size of a block
+// in the 2 bytes before it)
+
+static uint16_t SRAMblockSize(void * block) {
+    
+    return *((size_t *) block - 1) + sizeof(size_t);
+    
+}
+
+void * __wrap_malloc(size_t size) {
+    
+    void * block = __real_malloc(size);
+    
+    if (!block) {
+        
+        sram_heap.failures++;
+        return 0;
+        
+    }
+    
+    sram_heap.allocs++;
+    sram_heap.used += SRAMblockSize(block);
+    
+    if (sram_heap.used > sram_heap.peak) {
+        
+        sram_heap.peak = sram_heap.used;
+        
+    }
+    
+    return block;
+    
+}
+
+void __wrap_free(void * block) {
+    
+    if (!block) {
+        
+        return;
+        
+    }
+    
+    sram_heap.frees++;
+    sram_heap.used -= SRAMblockSize(block);
+    __real_free(block);
+    
+}
+
+# else
+
+// ------------------------------------------------------------ //
+// no painted SRAM on the host
+
+uint16_t SRAMunused(void) {
+    
+    return 0;
+    
+}
+
+uint16_t SRAMstackPeak(void) {
+    
+    return 0;
+    
+}
+
+uint16_t SRAMfree(void) {
+    
+    return 0;
+    
+}
+
+# endif
+
+
+// ------------------------------------------------------------ //
+// heap counters (all 0 as long as nothing is allocated)
+
+const sramHeap * SRAMheap(void) {
+    
+    return &sram_heap;
+    
+}
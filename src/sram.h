@@ -0,0 +1,54 @@
+# ifndef SRAM_H
+# define SRAM_H
+
+// ------------------------------------------------------------ //
+// stack and heap usage
+//
+// the SRAM above the static variables (__heap_start to RAMEND)
+// is painted with SRAM_CANARY before main runs, the stack grows
+// down into it and the heap up:
+//
+//   .data .bss | heap ->   painted   <- stack | RAMEND
+//
+// the lowest byte the stack ever changed gives its high-water
+// mark, the painted bytes left between the top of the heap and
+// the stack are the margin that was never touched (0 = the two
+// met at some point)
+//
+// malloc and free are wrapped (--wrap in the Makefile) to count
+// the allocations and the bytes in use
+//
+// "make stack" estimates the worst case at build time (see
+// host/stackreport.c), the host build has no painted SRAM and
+// returns 0 for everything
+//
+// most of the stack is the frame of main, which holds the state
+// of every module (the history alone is 320 bytes), about 1 KB
+// on the target before anything is called
+
+# define SRAM_CANARY    0xC5
+
+
+// ------------------------------------------------------------ //
+// heap counters (bytes include the 2 byte header of a block)
+
+typedef struct sramHeap {
+    
+    uint16_t allocs;
+    uint16_t frees;
+    uint16_t failures;
+    uint16_t used;
+    uint16_t peak;
+    
+} sramHeap;
+
+
+// ------------------------------------------------------------ //
+// user commands for reading the usage
+
+uint16_t SRAMstackPeak(void);
+uint16_t SRAMunused(void);
+uint16_t SRAMfree(void);
+const sramHeap * SRAMheap(void);
+
+# endif
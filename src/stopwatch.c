@@ -0,0 +1,224 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+# include <string.h>
+
+# include "hal.h"
+# include "uart.h"
+# include "stopwatch.h"
+
+
+// ------------------------------------------------------------ //
+// initialize (stopwatch, reset)
+
+void STOPWATCHinit(Stopwatch * watch) {
+    
+    watch->state      = STOPWATCH_READY;
+    watch->duration   = 0;
+    watch->_elapsed   = 0;
+    watch->_lap_start = 0;
+    watch->laps       = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// counts down from duration (ms) or up if it is 0, resets
+
+void STOPWATCHsetCountdown(Stopwatch * watch, uint32_t duration) {
+    
+    watch->duration   = (duration > STOPWATCH_MAX_MS) ? STOPWATCH_MAX_MS : duration;
+    watch->state      = STOPWATCH_READY;
+    watch->_elapsed   = 0;
+    watch->_lap_start = 0;
+    watch->laps       = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// starts or stops (a countdown that is done starts over)
+
+void STOPWATCHstartStop(Stopwatch * watch, uint32_t now) {
+    
+    if (watch->state == STOPWATCH_RUNNING) {
+        
+        watch->_elapsed = STOPWATCHelapsed(watch, now);
+        watch->state    = STOPWATCH_STOPPED;
+        return;
+        
+    }
+    
+    if (watch->state == STOPWATCH_DONE) {
+        
+        STOPWATCHsetCountdown(watch, watch->duration);
+        
+    }
+    
+    watch->_start = now;
+    watch->state  = STOPWATCH_RUNNING;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// takes a lap while running, resets otherwise
+
+void STOPWATCHlapReset(Stopwatch * watch, uint32_t now) {
+    
+    uint32_t elapsed;
+    
+    if (watch->state != STOPWATCH_RUNNING) {
+        
+        STOPWATCHsetCountdown(watch, watch->duration);
+        return;
+        
+    }
+    
+    elapsed = STOPWATCHelapsed(watch, now);
+    
+    watch->lap_times[watch->laps % STOPWATCH_LAPS] = elapsed - watch->_lap_start;
+    watch->_lap_start = elapsed;
+    watch->laps++;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// ms counted so far (up to STOPWATCH_MAX_MS)
+
+uint32_t STOPWATCHelapsed(const Stopwatch * watch, uint32_t now) {
+    
+    uint32_t elapsed = watch->_elapsed;
+    
+    if (watch->state == STOPWATCH_RUNNING) {
+        
+        elapsed += now - watch->_start;
+        
+    }
+    
+    return (elapsed > STOPWATCH_MAX_MS) ? STOPWATCH_MAX_MS : elapsed;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// ms shown: the elapsed time or what is left of the countdown
+
+uint32_t STOPWATCHvalue(const Stopwatch * watch, uint32_t now) {
+    
+    uint32_t elapsed = STOPWATCHelapsed(watch, now);
+    
+    if (watch->duration == 0) {
+        
+        return elapsed;
+        
+    }
+    
+    return (elapsed < watch->duration) ? watch->duration - elapsed : 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call in the main loop, stops a countdown at zero, returns 1
+// when it got there
+
+uint8_t STOPWATCHservice(Stopwatch * watch, uint32_t now) {
+    
+    if (watch->state != STOPWATCH_RUNNING || watch->duration == 0 ||
+        STOPWATCHelapsed(watch, now) < watch->duration) {
+        
+        return 0;
+        
+    }
+    
+    watch->_elapsed = watch->duration;
+    watch->state    = STOPWATCH_DONE;
+    
+    return 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command, "stopwatch" prints the time and the laps,
+// "stopwatch countdown <m>:<ss>" and "stopwatch up" switch
+// between countdown and stopwatch (and reset)
+
+void STOPWATCHcommand(Stopwatch * watch, const char * args) {
+    
+    static const char states[4][8] PROGMEM = {"ready", "running", "stopped", "done"};
+    unsigned int minutes, seconds;
+    uint16_t lap;
+    char text[12];
+    char line[32];
+    
+    if (strncmp_P(args, PSTR("countdown "), 10) == 0) {
+        
+        if (sscanf_P(args + 10, PSTR("%u:%u"), &minutes, &seconds) != 2 || seconds > 59 || minutes > 5999) {
+            
+            UARTprint_P(PSTR("error: stopwatch countdown <m>:<ss>\r\n"));
+            return;
+            
+        }
+        
+        STOPWATCHsetCountdown(watch, (minutes * 60UL + seconds) * 1000UL);
+        
+    } else if (strcmp_P(args, PSTR("up")) == 0) {
+        
+        STOPWATCHsetCountdown(watch, 0);
+        
+    } else if (*args != '\0') {
+        
+        UARTprint_P(PSTR("error: stopwatch [countdown <m>:<ss> | up]\r\n"));
+        return;
+        
+    }
+    
+    UARTprint_P((watch->duration != 0) ? PSTR("countdown ") : PSTR("stopwatch "));
+    STOPWATCHformat(text, STOPWATCHvalue(watch, HALmillis()));
+    UARTprint(text);
+    UARTprint_P(PSTR(" "));
+    UARTprint_P(states[watch->state]);
+    snprintf_P(line, sizeof(line), PSTR(" laps %u\r\n"), watch->laps);
+    UARTprint(line);
+    
+    // the laps that are still kept, oldest first
+    lap = (watch->laps > STOPWATCH_LAPS) ? watch->laps - STOPWATCH_LAPS : 0;
+    
+    for (; lap < watch->laps; lap++) {
+        
+        STOPWATCHformat(text, watch->lap_times[lap % STOPWATCH_LAPS]);
+        snprintf_P(line, sizeof(line), PSTR("lap %u %s\r\n"), lap + 1, text);
+        UARTprint(line);
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// time of the last lap (0 = none)
+
+uint32_t STOPWATCHlastLap(const Stopwatch * watch) {
+    
+    return (watch->laps != 0) ? watch->lap_times[(watch->laps - 1) % STOPWATCH_LAPS] : 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// writes ms as hh:mm:ss.cc (12 bytes), the hours wrap at 100
+// (they never get there below STOPWATCH_MAX_MS)
+
+void STOPWATCHformat(char * buffer, uint32_t ms) {
+    
+    uint32_t seconds = ms / 1000;
+    
+    snprintf_P(buffer, 12, PSTR("%02u:%02u:%02u.%02u"), (unsigned int) (seconds / 3600 % 100),
+               (unsigned int) (seconds / 60 % 60), (unsigned int) (seconds % 60), (unsigned int) (ms % 1000 / 10));
+    
+}
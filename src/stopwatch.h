@@ -0,0 +1,85 @@
+# ifndef STOPWATCH_H
+# define STOPWATCH_H
+
+// ------------------------------------------------------------ //
+// stopwatch and countdown
+//
+// the time is taken from the ms of timer0 (HALmillis), not from
+// the RTC whose seconds are only read once per second, so it has
+// the resolution of the tick and the screen shows 10 ms steps
+//
+// start, stop and lap take the ms at which they happened (e.g.
+// when the button went down), so the time does not depend on
+// when the main loop gets to them
+//
+// a lap is the time since the previous one (or the start), the
+// last STOPWATCH_LAPS of them are kept, a countdown stops by
+// itself once it reaches zero (STOPWATCHservice)
+
+
+// ------------------------------------------------------------ //
+// settings
+
+// laps kept (the older ones are overwritten)
+# define STOPWATCH_LAPS           8
+
+// longest time shown (99:59:59.99) and countdown set (ms)
+# define STOPWATCH_MAX_MS         359999990UL
+
+// states
+# define STOPWATCH_READY          0
+# define STOPWATCH_RUNNING        1
+# define STOPWATCH_STOPPED        2
+# define STOPWATCH_DONE           3
+
+
+// ------------------------------------------------------------ //
+// struct for storing the stopwatch and its laps
+
+typedef struct Stopwatch {
+    
+    uint8_t state;
+    
+    // countdown from duration (ms), 0 = stopwatch
+    uint32_t duration;
+    
+    // HALmillis of the start and the ms counted before it (the
+    // time of the runs before the last stop)
+    uint32_t _start;
+    uint32_t _elapsed;
+    
+    // elapsed time of the last lap and the laps (number taken so
+    // far, times in a ring at laps % STOPWATCH_LAPS)
+    uint32_t _lap_start;
+    uint16_t laps;
+    uint32_t lap_times[STOPWATCH_LAPS];
+    
+} Stopwatch;
+
+
+// ------------------------------------------------------------ //
+// user commands for the stopwatch (now = HALmillis)
+
+void STOPWATCHinit(Stopwatch * watch);
+void STOPWATCHsetCountdown(Stopwatch * watch, uint32_t duration);
+void STOPWATCHstartStop(Stopwatch * watch, uint32_t now);
+void STOPWATCHlapReset(Stopwatch * watch, uint32_t now);
+uint32_t STOPWATCHelapsed(const Stopwatch * watch, uint32_t now);
+uint32_t STOPWATCHvalue(const Stopwatch * watch, uint32_t now);
+uint8_t STOPWATCHservice(Stopwatch * watch, uint32_t now);
+
+
+// ------------------------------------------------------------ //
+// console command ("stopwatch", "stopwatch countdown m:ss",
+// "stopwatch up")
+
+void STOPWATCHcommand(Stopwatch * watch, const char * args);
+
+
+// ------------------------------------------------------------ //
+// helper functions
+
+uint32_t STOPWATCHlastLap(const Stopwatch * watch);
+void STOPWATCHformat(char * buffer, uint32_t ms);
+
+# endif
@@ -0,0 +1,248 @@
+// -------------------------------------------------- //
+// dependencies
+//
+// no hardware access, so the same code is used by the
+// host-side decoder
+
+# include <stdint.h>
+
+# include "telemetry.h"
+
+
+// -------------------------------------------------- //
+// initialize the stream
+
+void TELinit(Telemetry * tel) {
+    
+    tel->_sequence = 0;
+    
+}
+
+
+// -------------------------------------------------- //
+// encodes a time record
+
+uint8_t TELencodeTime(Telemetry * tel, uint8_t * frame, uint32_t timestamp) {
+    
+    uint8_t payload[TEL_PAYLOAD_TIME];
+    
+    for (int i = 0; i < 4; i++) {
+        
+        payload[i] = (timestamp >> (8 * i)) & 0xFF;
+        
+    }
+    
+    return TELencodeRecord(tel, frame, TEL_RECORD_TIME, payload, TEL_PAYLOAD_TIME);
+    
+}
+
+
+// -------------------------------------------------- //
+// encodes a temperature and humidity record
+
+uint8_t TELencodeDHT11(Telemetry * tel, uint8_t * frame, uint32_t timestamp,
+                       uint8_t humi_integral, uint8_t humi_decimal,
+                       uint8_t temp_integral, uint8_t temp_decimal) {
+    
+    uint8_t payload[TEL_PAYLOAD_DHT11];
+    
+    for (int i = 0; i < 4; i++) {
+        
+        payload[i] = (timestamp >> (8 * i)) & 0xFF;
+        
+    }
+    
+    payload[4] = humi_integral;
+    payload[5] = humi_decimal;
+    payload[6] = temp_integral;
+    payload[7] = temp_decimal;
+    
+    return TELencodeRecord(tel, frame, TEL_RECORD_DHT11, payload, TEL_PAYLOAD_DHT11);
+    
+}
+
+
+// -------------------------------------------------- //
+// encodes a time synchronization request
+
+uint8_t TELencodeSync(Telemetry * tel, uint8_t * frame, uint32_t timestamp, uint16_t ms, uint8_t id) {
+    
+    uint8_t payload[TEL_PAYLOAD_SYNC];
+    
+    for (int i = 0; i < 4; i++) {
+        
+        payload[i] = (timestamp >> (8 * i)) & 0xFF;
+        
+    }
+    
+    payload[4] = ms & 0xFF;
+    payload[5] = ms >> 8;
+    payload[6] = id;
+    
+    return TELencodeRecord(tel, frame, TEL_RECORD_SYNC, payload, TEL_PAYLOAD_SYNC);
+    
+}
+
+
+// -------------------------------------------------- //
+// adds header and crc to a payload and encodes it into
+// a delimited frame
+
+uint8_t TELencodeRecord(Telemetry * tel, uint8_t * frame, uint8_t type,
+                        const uint8_t * payload, uint8_t length) {
+    
+    uint8_t record[TEL_PAYLOAD_MAX + TEL_OVERHEAD];
+    uint8_t frame_length;
+    
+    record[0] = type;
+    record[1] = tel->_sequence++;
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        record[2 + i] = payload[i];
+        
+    }
+    
+    record[2 + length] = TELcrc8(record, 2 + length);
+    
+    // stuff the record and append the delimiter
+    frame_length = TELcobsEncode(record, length + TEL_OVERHEAD, frame);
+    frame[frame_length++] = 0x00;
+    
+    return frame_length;
+    
+}
+
+
+// -------------------------------------------------- //
+// decodes a frame and checks its crc
+
+uint8_t TELdecodeFrame(const uint8_t * frame, uint8_t length, uint8_t * record) {
+    
+    uint8_t record_length;
+    
+    if (length < 2 || length > TEL_PAYLOAD_MAX + TEL_OVERHEAD + 1) {
+        
+        return 0;
+        
+    }
+    
+    record_length = TELcobsDecode(frame, length, record);
+    
+    if (record_length < TEL_OVERHEAD) {
+        
+        return 0;
+        
+    }
+    
+    if (TELcrc8(record, record_length - 1) != record[record_length - 1]) {
+        
+        return 0;
+        
+    }
+    
+    return record_length - 1;
+    
+}
+
+
+// -------------------------------------------------- //
+// crc-8 with polynomial 0x07 (x^8 + x^2 + x + 1)
+
+uint8_t TELcrc8(const uint8_t * data, uint8_t length) {
+    
+    uint8_t crc = 0;
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        crc ^= data[i];
+        
+        for (int j = 0; j < 8; j++) {
+            
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+            
+        }
+        
+    }
+    
+    return crc;
+    
+}
+
+
+// -------------------------------------------------- //
+// COBS encoding (without delimiter)
+//
+// every zero is replaced by the distance to the next zero,
+// a leading code byte holds the distance to the first one
+// out must hold length + 1 bytes (frames are < 254 bytes)
+
+uint8_t TELcobsEncode(const uint8_t * data, uint8_t length, uint8_t * out) {
+    
+    uint8_t code_index = 0;
+    uint8_t out_index  = 1;
+    uint8_t code       = 1;
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        if (data[i] == 0) {
+            
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+            
+        } else {
+            
+            out[out_index++] = data[i];
+            code++;
+            
+        }
+        
+    }
+    
+    out[code_index] = code;
+    
+    return out_index;
+    
+}
+
+
+// -------------------------------------------------- //
+// COBS decoding (without delimiter)
+//
+// returns the decoded length or 0 if the frame is malformed
+
+uint8_t TELcobsDecode(const uint8_t * data, uint8_t length, uint8_t * out) {
+    
+    uint8_t out_index = 0;
+    uint8_t i = 0;
+    
+    while (i < length) {
+        
+        uint8_t code = data[i++];
+        
+        // a zero or a code pointing past the end is a broken frame
+        if (code == 0 || i + code - 1 > length) {
+            
+            return 0;
+            
+        }
+        
+        for (uint8_t j = 1; j < code; j++) {
+            
+            out[out_index++] = data[i++];
+            
+        }
+        
+        // every code except the last one stands for a zero
+        if (i < length) {
+            
+            out[out_index++] = 0;
+            
+        }
+        
+    }
+    
+    return out_index;
+    
+}
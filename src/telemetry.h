@@ -0,0 +1,88 @@
+# ifndef TELEMETRY_H
+# define TELEMETRY_H
+
+// ------------------------------------------------------------ //
+// wire format
+//
+// every record is sent as one frame:
+//
+//   COBS(type | sequence | payload | crc8) 0x00
+//
+// COBS (consistent overhead byte stuffing) removes all zero
+// bytes from the frame, so 0x00 only ever appears as the frame
+// delimiter and a receiver can resynchronize after any error
+// crc8 uses polynomial 0x07 over type, sequence and payload
+// multi-byte values are little endian
+
+// record types
+# define TEL_RECORD_TIME     0x01
+# define TEL_RECORD_DHT11    0x02
+# define TEL_RECORD_SYNC     0x03
+
+// payload sizes of the record types
+// time:  uint32 seconds since 2000-01-01 00:00:00
+// dht11: uint32 timestamp, humidity (int, dec), temperature (int, dec)
+// sync:  uint32 timestamp, uint16 ms, request id (see timesync.h)
+# define TEL_PAYLOAD_TIME    4
+# define TEL_PAYLOAD_DHT11   8
+# define TEL_PAYLOAD_SYNC    7
+
+// largest payload of all record types
+# define TEL_PAYLOAD_MAX     8
+
+// header (type, sequence) and crc
+# define TEL_OVERHEAD        3
+
+// size of the largest encoded frame (incl. COBS code byte and delimiter)
+# define TEL_FRAME_MAX       (TEL_PAYLOAD_MAX + TEL_OVERHEAD + 2)
+
+
+// ------------------------------------------------------------ //
+// struct for storing the state of the telemetry stream
+
+typedef struct Telemetry {
+    
+    // sequence number of the next frame, lets the receiver detect loss
+    uint8_t _sequence;
+    
+} Telemetry;
+
+
+// ------------------------------------------------------------ //
+// initialization of the stream
+
+void TELinit(Telemetry * tel);
+
+
+// ------------------------------------------------------------ //
+// encoding of records into frames
+//
+// frame must hold TEL_FRAME_MAX bytes, returns the frame length
+
+uint8_t TELencodeTime(Telemetry * tel, uint8_t * frame, uint32_t timestamp);
+uint8_t TELencodeDHT11(Telemetry * tel, uint8_t * frame, uint32_t timestamp,
+                       uint8_t humi_integral, uint8_t humi_decimal,
+                       uint8_t temp_integral, uint8_t temp_decimal);
+uint8_t TELencodeSync(Telemetry * tel, uint8_t * frame, uint32_t timestamp, uint16_t ms, uint8_t id);
+uint8_t TELencodeRecord(Telemetry * tel, uint8_t * frame, uint8_t type,
+                        const uint8_t * payload, uint8_t length);
+
+
+// ------------------------------------------------------------ //
+// decoding of frames (without the delimiter)
+//
+// record must hold TEL_PAYLOAD_MAX + TEL_OVERHEAD bytes, returns
+// the length of type, sequence and payload or 0 if the frame is
+// corrupted
+
+uint8_t TELdecodeFrame(const uint8_t * frame, uint8_t length, uint8_t * record);
+
+
+// ------------------------------------------------------------ //
+// helper functions
+
+uint8_t TELcrc8(const uint8_t * data, uint8_t length);
+uint8_t TELcobsEncode(const uint8_t * data, uint8_t length, uint8_t * out);
+uint8_t TELcobsDecode(const uint8_t * data, uint8_t length, uint8_t * out);
+
+# endif
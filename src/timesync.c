@@ -0,0 +1,356 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdio.h>
+# include <stdint.h>
+
+# include "hal.h"
+# include "ds1302.h"
+# include "telemetry.h"
+# include "uart.h"
+# include "timesync.h"
+
+
+// ------------------------------------------------------------ //
+// initialize (no time until the first SYNCtick)
+
+void SYNCinit(TimeSync * sync) {
+    
+    sync->_ticked      = 0;
+    sync->_state       = SYNC_IDLE;
+    sync->_id          = 0;
+    sync->_adjust      = 0;
+    sync->synced       = 0;
+    sync->elapsed      = 0;
+    sync->requests     = 0;
+    sync->answers      = 0;
+    sync->failures     = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call when the RTC second changed, now = HALmillis when the new
+// second was read (the first call after the start only tells the
+// second, its ms are known from the first change on)
+
+void SYNCtick(TimeSync * sync, uint32_t utc, uint32_t now) {
+    
+    sync->_utc  = utc;
+    sync->_tick = now;
+    
+    if (sync->_ticked < 2) {
+        
+        sync->_ticked++;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// time of the clock with ms (RTC second and the ms since then)
+
+void SYNCnow(const TimeSync * sync, syncTime * time, uint32_t now) {
+    
+    uint32_t elapsed = now - sync->_tick;
+    
+    time->seconds = sync->_utc + elapsed / 1000;
+    time->ms      = elapsed % 1000;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// starts a synchronization (the first request waits until the
+// ms of the clock are known), returns 0 if one is running
+
+uint8_t SYNCstart(TimeSync * sync, uint32_t now) {
+    
+    if (sync->_state != SYNC_IDLE) {
+        
+        return 0;
+        
+    }
+    
+    sync->_state      = SYNC_EXCHANGE;
+    sync->_round      = 0;
+    sync->_answers    = 0;
+    sync->_best_delay = 0xFFFF;
+    sync->_sent       = now - SYNC_INTERVAL_MS;
+    
+    return 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// moves the RTC by ms (negative = back) at its next second,
+// returns 0 if a synchronization is running
+
+uint8_t SYNCadjust(TimeSync * sync, int16_t ms, uint32_t now) {
+    
+    syncOffset offset;
+    
+    if (sync->_ticked < 2 || sync->_state != SYNC_IDLE) {
+        
+        return 0;
+        
+    }
+    
+    offset.seconds = (ms < 0) ? -1 : 0;
+    offset.ms      = (ms < 0) ? 1000 + ms : ms;
+    
+    sync->_adjust = 1;
+    SYNCschedule(sync, &offset, now);
+    
+    return 1;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// call in the main loop, sends the requests and writes the
+// corrected time to the RTC at the full second
+//
+// returns SYNC_SET once a synchronization wrote the RTC
+// (sync->synced), SYNC_ADJUSTED after an adjustment
+
+uint8_t SYNCservice(TimeSync * sync, Telemetry * tel, DS1302 * ds1302, uint32_t now) {
+    
+    uint8_t frame[TEL_FRAME_MAX];
+    char line[24];
+    timeData data;
+    uint32_t late;
+    
+    if (sync->_state == SYNC_EXCHANGE && sync->_ticked == 2 && now - sync->_sent >= SYNC_INTERVAL_MS) {
+        
+        if (sync->_round == SYNC_ROUNDS) {
+            
+            SYNCfinish(sync, now);
+            return SYNC_NONE;
+            
+        }
+        
+        // next request, answers to the previous one are ignored from now on
+        sync->_id++;
+        sync->_round++;
+        sync->_sent = now;
+        sync->requests++;
+        SYNCnow(sync, &sync->_t1, now);
+        
+        UARTwrite(frame, TELencodeSync(tel, frame, sync->_t1.seconds, sync->_t1.ms, sync->_id));
+        
+    }
+    
+    if (sync->_state != SYNC_WRITE || (int32_t) (sync->_write_at - now) > SYNC_SPIN_MS) {
+        
+        return SYNC_NONE;
+        
+    }
+    
+    // wait for the full second in place, a late loop only loses whole seconds
+    while ((int32_t) (HALmillis() - sync->_write_at) < 0) {
+        
+        hal_delay_us(1);
+        
+    }
+    
+    late = HALmillis() - sync->_write_at;
+    sync->_write_seconds += late / 1000;
+    sync->_write_at      += late - late % 1000;
+    
+    DS1302timeDataFromSeconds(&data, sync->_write_seconds);
+    DS1302writeTimeData(ds1302, &data);
+    
+    sync->_state = SYNC_IDLE;
+    SYNCtick(sync, sync->_write_seconds, sync->_write_at);
+    
+    if (sync->_adjust) {
+        
+        return SYNC_ADJUSTED;
+        
+    }
+    
+    sync->elapsed = (sync->synced != 0) ? sync->_write_seconds - sync->synced : 0;
+    sync->synced  = sync->_write_seconds;
+    
+    UARTprint_P(PSTR("sync offset "));
+    SYNCprintOffset(&sync->offset);
+    snprintf_P(line, sizeof(line), PSTR(" s delay %u ms\r\n"), sync->delay);
+    UARTprint(line);
+    
+    return SYNC_SET;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// console command, "sync" starts a synchronization, the host
+// answers with "sync <id> <t2 seconds>.<t2 ms> <t3 - t2 ms>"
+//
+// now = HALmillis when the line was read (t4)
+
+void SYNCcommand(TimeSync * sync, char * args, uint32_t now) {
+    
+    unsigned int id, ms, hold;
+    unsigned long seconds;
+    syncTime t2;
+    
+    if (*args == '\0') {
+        
+        if (!SYNCstart(sync, now)) {
+            
+            UARTprint_P(PSTR("error: sync running\r\n"));
+            
+        }
+        
+        return;
+        
+    }
+    
+    if (sscanf_P(args, PSTR("%u %lu.%u %u"), &id, &seconds, &ms, &hold) != 4 || ms > 999) {
+        
+        UARTprint_P(PSTR("error: sync <id> <seconds>.<ms> <hold ms>\r\n"));
+        return;
+        
+    }
+    
+    t2.seconds = seconds;
+    t2.ms      = ms;
+    
+    SYNCanswer(sync, id, &t2, hold, now);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// evaluates an answer, hold = t3 - t2 (ms)
+//
+// t4 is taken as t1 plus the ms since the request was sent, so a
+// SYNCtick in between does not count as part of the exchange
+
+void SYNCanswer(TimeSync * sync, uint8_t id, const syncTime * t2, uint16_t hold, uint32_t now) {
+    
+    uint32_t elapsed = now - sync->_sent;
+    int32_t seconds;
+    int32_t ms;
+    
+    if (sync->_state != SYNC_EXCHANGE || id != sync->_id || hold > elapsed) {
+        
+        return;
+        
+    }
+    
+    sync->answers++;
+    sync->_answers++;
+    
+    // offset = (t2 - t1) + ((t3 - t2) - (t4 - t1)) / 2, rounded down to full seconds
+    seconds = t2->seconds - sync->_t1.seconds;
+    ms      = (int32_t) t2->ms - sync->_t1.ms + ((int32_t) hold - (int32_t) elapsed) / 2;
+    
+    while (ms < 0) {
+        
+        ms += 1000;
+        seconds--;
+        
+    }
+    
+    seconds += ms / 1000;
+    ms      %= 1000;
+    
+    // the shortest exchange has the smallest possible error
+    if (elapsed - hold < sync->_best_delay) {
+        
+        sync->_best.seconds = seconds;
+        sync->_best.ms      = ms;
+        sync->_best_delay   = elapsed - hold;
+        
+    }
+    
+}
+
+
+// ------------------------------------------------------------ //
+// after the last exchange: schedules the write of the corrected
+// time at its next full second
+
+void SYNCfinish(TimeSync * sync, uint32_t now) {
+    
+    if (sync->_answers == 0) {
+        
+        sync->failures++;
+        sync->_state = SYNC_IDLE;
+        UARTprint_P(PSTR("error: sync not answered\r\n"));
+        return;
+        
+    }
+    
+    sync->offset  = sync->_best;
+    sync->delay   = sync->_best_delay;
+    sync->_adjust = 0;
+    
+    SYNCschedule(sync, &sync->_best, now);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// schedules the write of the time plus offset at its next full
+// second
+
+void SYNCschedule(TimeSync * sync, const syncOffset * offset, uint32_t now) {
+    
+    syncTime time;
+    uint16_t ms;
+    
+    SYNCnow(sync, &time, now);
+    
+    sync->_write_seconds = time.seconds + offset->seconds;
+    ms = time.ms + offset->ms;
+    
+    if (ms >= 1000) {
+        
+        ms -= 1000;
+        sync->_write_seconds++;
+        
+    }
+    
+    if (ms != 0) {
+        
+        sync->_write_seconds++;
+        sync->_write_at = now + 1000 - ms;
+        
+    } else {
+        
+        sync->_write_at = now;
+        
+    }
+    
+    sync->_state = SYNC_WRITE;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// prints an offset as seconds with ms (e.g. -0.250)
+
+void SYNCprintOffset(const syncOffset * offset) {
+    
+    // sign, the digits of a long, the dot and the ms
+    char text[18];
+    int32_t seconds = offset->seconds;
+    uint16_t ms = offset->ms;
+    
+    if (seconds < 0 && ms != 0) {
+        
+        seconds++;
+        ms = 1000 - ms;
+        
+    }
+    
+    snprintf_P(text, sizeof(text), PSTR("%s%ld.%03u"), (offset->seconds < 0) ? "-" : "",
+               (long) ((seconds < 0) ? -seconds : seconds), ms);
+    UARTprint(text);
+    
+}
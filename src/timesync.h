@@ -0,0 +1,142 @@
+# ifndef TIMESYNC_H
+# define TIMESYNC_H
+
+// ------------------------------------------------------------ //
+// time synchronization with a host over the serial port
+//
+// an exchange works like NTP: the clock sends its time t1 in a
+// telemetry record (TEL_RECORD_SYNC), the host notes the arrival
+// t2 and answers on the console with t2 and the time it took
+// until it sent the answer (t3 - t2), the answer arrives at t4:
+//
+//   sync <id> <t2 seconds>.<t2 ms> <t3 - t2 ms>
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2
+//   delay  = (t4 - t1) - (t3 - t2)
+//
+// the offset is exact if both directions take the same time,
+// otherwise it is off by at most delay / 2, so of SYNC_ROUNDS
+// exchanges the one with the smallest delay is used
+//
+// the time of the clock is the RTC second plus the ms since it
+// began (SYNCtick), the corrected time is written to the RTC
+// once it reaches a full second, the write restarts the second
+// divider of the RTC there
+//
+// the same write moves the RTC by a few ms (SYNCadjust), which
+// compensates its drift (see drift.h)
+
+
+// ------------------------------------------------------------ //
+// settings
+
+// exchanges per synchronization and the time between them (ms),
+// answers that arrive later than that are ignored
+# define SYNC_ROUNDS          4
+# define SYNC_INTERVAL_MS     500
+
+// the write is waited for in place once it is this close (ms)
+# define SYNC_SPIN_MS         20
+
+// states
+# define SYNC_IDLE            0
+# define SYNC_EXCHANGE        1
+# define SYNC_WRITE           2
+
+// results of SYNCservice
+# define SYNC_NONE            0
+# define SYNC_SET             1
+# define SYNC_ADJUSTED        2
+
+
+// ------------------------------------------------------------ //
+// times (seconds since 2000-01-01 00:00:00 UTC and ms) and
+// offsets (seconds rounded down, so ms is always positive)
+
+typedef struct syncTime {
+    
+    uint32_t seconds;
+    uint16_t ms;
+    
+} syncTime;
+
+typedef struct syncOffset {
+    
+    int32_t seconds;
+    uint16_t ms;
+    
+} syncOffset;
+
+
+// ------------------------------------------------------------ //
+// struct for storing the exchanges and the last result
+
+typedef struct TimeSync {
+    
+    // RTC second and the HALmillis at which it was seen first,
+    // number of SYNCtick calls (up to 2)
+    uint32_t _utc;
+    uint32_t _tick;
+    uint8_t _ticked;
+    
+    uint8_t _state;
+    uint8_t _round;
+    uint8_t _id;
+    
+    // request in flight (t1 and HALmillis when it was sent)
+    syncTime _t1;
+    uint32_t _sent;
+    
+    // best exchange so far
+    syncOffset _best;
+    uint16_t _best_delay;
+    uint8_t _answers;
+    
+    // second to write to the RTC at HALmillis _write_at, 1 if it
+    // is an adjustment instead of a synchronization
+    uint32_t _write_seconds;
+    uint32_t _write_at;
+    uint8_t _adjust;
+    
+    // result of the last synchronization: offset applied, delay of
+    // the exchange used, RTC second written (0 = never) and the
+    // seconds since the one before (0 = none)
+    syncOffset offset;
+    uint16_t delay;
+    uint32_t synced;
+    uint32_t elapsed;
+    
+    // statistics
+    uint16_t requests;
+    uint16_t answers;
+    uint16_t failures;
+    
+} TimeSync;
+
+
+// ------------------------------------------------------------ //
+// user commands for the synchronization (now = HALmillis)
+
+void SYNCinit(TimeSync * sync);
+void SYNCtick(TimeSync * sync, uint32_t utc, uint32_t now);
+void SYNCnow(const TimeSync * sync, syncTime * time, uint32_t now);
+uint8_t SYNCstart(TimeSync * sync, uint32_t now);
+uint8_t SYNCadjust(TimeSync * sync, int16_t ms, uint32_t now);
+uint8_t SYNCservice(TimeSync * sync, Telemetry * tel, DS1302 * ds1302, uint32_t now);
+
+
+// ------------------------------------------------------------ //
+// console command ("sync" starts, "sync <id> ..." is an answer)
+
+void SYNCcommand(TimeSync * sync, char * args, uint32_t now);
+
+
+// ------------------------------------------------------------ //
+// helper functions
+
+void SYNCanswer(TimeSync * sync, uint8_t id, const syncTime * t2, uint16_t hold, uint32_t now);
+void SYNCfinish(TimeSync * sync, uint32_t now);
+void SYNCschedule(TimeSync * sync, const syncOffset * offset, uint32_t now);
+void SYNCprintOffset(const syncOffset * offset);
+
+# endif
@@ -0,0 +1,275 @@
+// ------------------------------------------------------------ //
+// dependencies
+
+# include <stdint.h>
+
+# include "hal.h"
+# include "ds1302.h"
+# include "timezone.h"
+
+
+// ------------------------------------------------------------ //
+// rules of the zones (index = enum timezones)
+
+# define TZ_NONE                  {0, 0, 0, 0, 0}
+# define TZ_EU_START              {MAR, 5, 0, TZ_REF_UTC, 60}
+# define TZ_EU_END                {OCT, 5, 0, TZ_REF_UTC, 60}
+# define TZ_US_START              {MAR, 2, 0, TZ_REF_WALL, 120}
+# define TZ_US_END                {NOV, 1, 0, TZ_REF_WALL, 120}
+
+static const tzRule tz_rules[TZ_ZONES] PROGMEM = {
+    {   0,  0, TZ_NONE,     TZ_NONE},                                   // UTC
+    {   0, 60, TZ_EU_START, TZ_EU_END},                                 // WET/WEST, GMT/BST
+    {  60, 60, TZ_EU_START, TZ_EU_END},                                 // CET/CEST
+    { 120, 60, TZ_EU_START, TZ_EU_END},                                 // EET/EEST
+    {-300, 60, TZ_US_START, TZ_US_END},                                 // EST/EDT
+    {-360, 60, TZ_US_START, TZ_US_END},                                 // CST/CDT
+    {-420, 60, TZ_US_START, TZ_US_END},                                 // MST/MDT
+    {-480, 60, TZ_US_START, TZ_US_END},                                 // PST/PDT
+    { 330,  0, TZ_NONE,     TZ_NONE},                                   // IST
+    { 540,  0, TZ_NONE,     TZ_NONE},                                   // JST
+    { 600, 60, {OCT, 1, 0, TZ_REF_WALL, 120}, {APR, 1, 0, TZ_REF_WALL, 180}} // AEST/AEDT
+};
+
+static const uint8_t tz_days_in_month[12] PROGMEM = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+
+// ------------------------------------------------------------ //
+// initialize with one of the built-in zones
+
+void TZinit(Timezone * tz, uint8_t zone) {
+    
+    tzRule rule;
+    
+    if (zone >= TZ_ZONES) {
+        
+        zone = TZ_ZONE_UTC;
+        
+    }
+    
+    memcpy_P(&rule, &tz_rules[zone], sizeof(rule));
+    TZsetRule(tz, &rule);
+    
+}
+
+
+// ------------------------------------------------------------ //
+// initialize with any rule (the period is evaluated with the
+// next conversion)
+
+void TZsetRule(Timezone * tz, const tzRule * rule) {
+    
+    tz->_rule       = *rule;
+    tz->_from       = TZ_NEVER;
+    tz->_next       = 0;
+    tz->_offset     = 0;
+    tz->_dst        = 0;
+    tz->evaluations = 0;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// converts UTC to local time, the rule is only evaluated if the
+// time is outside of the current period
+
+uint32_t TZlocal(Timezone * tz, uint32_t utc) {
+    
+    if (utc < tz->_from || utc >= tz->_next) {
+        
+        TZevaluate(tz, utc);
+        
+    }
+    
+    return utc + tz->_offset;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// converts local time to UTC (e.g. for setting the clock)
+//
+// times that occur twice when the clocks go back resolve to
+// the second one, times skipped when they go forward are taken
+// as standard time (02:30 on the change day in CET = 01:30 UTC,
+// shown as 03:30 CEST)
+
+uint32_t TZutc(Timezone * tz, uint32_t local) {
+    
+    uint32_t utc = local - tz->_rule.offset * 60L;
+    
+    TZlocal(tz, utc);
+    
+    if (tz->_dst) {
+        
+        utc -= tz->_rule.dst * 60L;
+        TZlocal(tz, utc);
+        
+        // read with dst it falls before the change, so it was skipped
+        if (!tz->_dst) {
+            
+            utc += tz->_rule.dst * 60L;
+            TZlocal(tz, utc);
+            
+        }
+        
+    }
+    
+    return utc;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// daylight saving time active at the last conversion
+
+uint8_t TZisDST(const Timezone * tz) {
+    
+    return tz->_dst;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// UTC of the next transition after the last conversion
+
+uint32_t TZnextTransition(const Timezone * tz) {
+    
+    return tz->_next;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// returns the UTC of a transition in year (0-99 = 2000-2099)
+//
+// before = offset in minutes in effect up to the transition,
+// only used for wall clock references
+
+uint32_t TZtransition(const tzTransition * transition, uint8_t year, int16_t before) {
+    
+    timeData first = {0, 0, 0, 1, transition->month, 0, year};
+    uint16_t days;
+    uint8_t length;
+    uint8_t day;
+    uint32_t instant;
+    
+    days   = DS1302timeDataToSeconds(&first) / 86400UL;
+    length = pgm_read_byte(&tz_days_in_month[transition->month - 1]);
+    
+    if (transition->month == FEB && (year % 4) == 0) {
+        
+        length++;
+        
+    }
+    
+    // first matching day of the week (2000-01-01 was a saturday), then the n-th week
+    day = 1 + (transition->dayofweek + 7 - (days + 6) % 7) % 7 + 7 * (transition->week - 1);
+    
+    // week 5 is the last one, which may be the 4th
+    while (day > length) {
+        
+        day -= 7;
+        
+    }
+    
+    instant = (uint32_t) (days + day - 1) * 86400UL + transition->minute * 60UL;
+    
+    if (transition->reference == TZ_REF_WALL) {
+        
+        instant -= before * 60L;
+        
+    }
+    
+    return instant;
+    
+}
+
+
+// ------------------------------------------------------------ //
+// finds the transitions around utc and stores the period and
+// the offset that is valid in it
+//
+// the transitions of the previous, current and next year are
+// checked, so rules that span the new year (southern
+// hemisphere) work the same way
+
+void TZevaluate(Timezone * tz, uint32_t utc) {
+    
+    const tzRule * rule = &tz->_rule;
+    timeData date;
+    uint32_t instant;
+    uint32_t previous = 0;
+    uint8_t previous_dst = 0;
+    uint8_t found = 0;
+    uint8_t next_dst = 0;
+    
+    tz->evaluations++;
+    tz->_from = 0;
+    tz->_next = TZ_NEVER;
+    
+    if (rule->start.month != 0) {
+        
+        DS1302timeDataFromSeconds(&date, utc);
+        
+        for (int8_t year = date.year - 1; year <= date.year + 1; year++) {
+            
+            if (year < 0 || year > 99) {
+                
+                continue;
+                
+            }
+            
+            for (uint8_t dst = 0; dst < 2; dst++) {
+                
+                // the start switches to dst (before: standard), the end back
+                if (dst) {
+                    
+                    instant = TZtransition(&rule->start, year, rule->offset);
+                    
+                } else {
+                    
+                    instant = TZtransition(&rule->end, year, rule->offset + rule->dst);
+                    
+                }
+                
+                if (instant <= utc) {
+                    
+                    if (!found || instant > previous) {
+                        
+                        previous     = instant;
+                        previous_dst = dst;
+                        found        = 1;
+                        
+                    }
+                    
+                } else if (instant < tz->_next) {
+                    
+                    tz->_next = instant;
+                    next_dst  = dst;
+                    
+                }
+                
+            }
+            
+        }
+        
+    }
+    
+    if (found) {
+        
+        tz->_from = previous;
+        tz->_dst  = previous_dst;
+        
+    } else {
+        
+        // before the first transition, the opposite of the next one
+        tz->_dst = (tz->_next != TZ_NEVER) && !next_dst;
+        
+    }
+    
+    tz->_offset = (tz->_rule.offset + (tz->_dst ? tz->_rule.dst : 0)) * 60L;
+    
+}
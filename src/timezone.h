@@ -0,0 +1,108 @@
+# ifndef TIMEZONE_H
+# define TIMEZONE_H
+
+// ------------------------------------------------------------ //
+// time zones and daylight saving time
+//
+// the RTC runs on UTC (seconds since 2000-01-01 00:00:00, see
+// DS1302timeDataToSeconds), local time is UTC plus the offset of
+// the zone, which changes at the two transitions of the rule:
+//
+//   month | week (1-4, 5 = last) | day of the week | minute
+//
+// the minute is either UTC (EU rules, 01:00 UTC) or the wall
+// clock time just before the switch (US rules, 02:00 local)
+//
+// the rule is only evaluated when the time leaves the period
+// between the last and the next transition, otherwise a local
+// time costs a comparison and an addition
+
+
+// ------------------------------------------------------------ //
+// zones (index into the table in flash, stored in the settings)
+
+enum timezones {
+    TZ_ZONE_UTC = 0,
+    TZ_ZONE_EUROPE_WESTERN,
+    TZ_ZONE_EUROPE_CENTRAL,
+    TZ_ZONE_EUROPE_EASTERN,
+    TZ_ZONE_US_EASTERN,
+    TZ_ZONE_US_CENTRAL,
+    TZ_ZONE_US_MOUNTAIN,
+    TZ_ZONE_US_PACIFIC,
+    TZ_ZONE_INDIA,
+    TZ_ZONE_JAPAN,
+    TZ_ZONE_AUSTRALIA_EASTERN,
+    TZ_ZONES
+};
+
+// reference of the transition minute
+# define TZ_REF_UTC     0
+# define TZ_REF_WALL    1
+
+// no transition pending (beyond 2099)
+# define TZ_NEVER       0xFFFFFFFFUL
+
+
+// ------------------------------------------------------------ //
+// rules (month 0 = no daylight saving time)
+
+typedef struct tzTransition {
+    
+    uint8_t month;
+    uint8_t week;
+    uint8_t dayofweek;
+    uint8_t reference;
+    uint16_t minute;
+    
+} tzTransition;
+
+typedef struct tzRule {
+    
+    // standard offset and daylight saving time on top of it (minutes)
+    int16_t offset;
+    int16_t dst;
+    
+    tzTransition start;
+    tzTransition end;
+    
+} tzRule;
+
+
+// ------------------------------------------------------------ //
+// struct for storing the rule and the current period
+
+typedef struct Timezone {
+    
+    tzRule _rule;
+    
+    // period [_from, _next) in which _offset is valid (UTC seconds)
+    uint32_t _from;
+    uint32_t _next;
+    int32_t _offset;
+    uint8_t _dst;
+    
+    // number of rule evaluations
+    uint16_t evaluations;
+    
+} Timezone;
+
+
+// ------------------------------------------------------------ //
+// user commands for converting between UTC and local time
+
+void TZinit(Timezone * tz, uint8_t zone);
+void TZsetRule(Timezone * tz, const tzRule * rule);
+uint32_t TZlocal(Timezone * tz, uint32_t utc);
+uint32_t TZutc(Timezone * tz, uint32_t local);
+uint8_t TZisDST(const Timezone * tz);
+uint32_t TZnextTransition(const Timezone * tz);
+
+
+// ------------------------------------------------------------ //
+// functions for evaluating the rule
+
+uint32_t TZtransition(const tzTransition * transition, uint8_t year, int16_t before);
+void TZevaluate(Timezone * tz, uint32_t utc);
+
+# endif
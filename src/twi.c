@@ -0,0 +1,191 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include <avr/io.h>
+# include <avr/interrupt.h>
+# include <util/atomic.h>
+
+# include "twi.h"
+# include "macros.h"
+
+
+// -------------------------------------------------- //
+// status codes of the master transmitter (TWSR & 0xF8)
+
+# define TWI_START          0x08
+# define TWI_REPEATED_START 0x10
+# define TWI_ADDRESS_ACK    0x18
+# define TWI_DATA_ACK       0x28
+
+
+// -------------------------------------------------- //
+// queue (head written by TWIwrite, tail by the interrupt),
+// slave of the queued bytes and whether a transfer runs
+
+static volatile uint8_t twi_queue[TWI_QUEUE_SIZE];
+static volatile uint8_t twi_head = 0;
+static volatile uint8_t twi_tail = 0;
+static volatile uint8_t twi_address = 0;
+static volatile uint8_t twi_running = 0;
+
+static twiStats twi_stats;
+
+
+// -------------------------------------------------- //
+// initialize the TWI (prescaler 1)
+//
+// SCL = F_CPU / (16 + 2 * TWBR)
+
+void TWIinit(void) {
+    
+    TWSR = 0;
+    TWBR = ((F_CPU / TWI_FREQ) - 16) / 2;
+    TWCR = (1 << TWEN);
+    
+}
+
+
+// -------------------------------------------------- //
+// queue bytes for a slave (7-bit address), blocks only
+// while the queue is full or holds bytes of another slave
+
+void TWIwrite(uint8_t address, const uint8_t * data, uint8_t length) {
+    
+    uint8_t next;
+    
+    if (address != twi_address) {
+        
+        TWIflush();
+        twi_address = address;
+        
+    }
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        next = (twi_head + 1) & (TWI_QUEUE_SIZE - 1);
+        
+        if (next == twi_tail) {
+            
+            twi_stats.waits++;
+            
+            // wait for the interrupt to make room
+            while (next == twi_tail);
+            
+        }
+        
+        twi_queue[twi_head] = data[i];
+        twi_head = next;
+        
+    }
+    
+    // start a transfer unless one is running (it picks up the new bytes)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        
+        if (!twi_running) {
+            
+            // the stop condition of the last transfer has to be sent first
+            while (TWCR & (1 << TWSTO));
+            
+            twi_running = 1;
+            TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+            
+        }
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// bytes that can be queued without waiting
+
+uint8_t TWIroom(void) {
+    
+    return (twi_tail - twi_head - 1) & (TWI_QUEUE_SIZE - 1);
+    
+}
+
+
+// -------------------------------------------------- //
+// returns 1 while bytes are queued or being sent
+
+uint8_t TWIbusy(void) {
+    
+    return twi_running;
+    
+}
+
+
+// -------------------------------------------------- //
+// waits until every queued byte was sent
+
+void TWIflush(void) {
+    
+    while (twi_running);
+    
+}
+
+
+// -------------------------------------------------- //
+// counters since TWIinit
+
+const twiStats * TWIstats(void) {
+    
+    return &twi_stats;
+    
+}
+
+
+// -------------------------------------------------- //
+// interrupt service routine for the TWI
+//
+// sends the address after the start condition, then one
+// queued byte per acknowledge, and the stop condition once
+// the queue is empty or the slave did not acknowledge
+
+ISR(TWI_vect) {
+    
+    switch (TWSR & 0xF8) {
+        
+        case TWI_START:
+        case TWI_REPEATED_START:
+            
+            TWDR = twi_address << 1;
+            TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+            
+            return;
+        
+        case TWI_ADDRESS_ACK:
+        case TWI_DATA_ACK:
+            
+            if (twi_tail != twi_head) {
+                
+                TWDR = twi_queue[twi_tail];
+                twi_tail = (twi_tail + 1) & (TWI_QUEUE_SIZE - 1);
+                twi_stats.bytes++;
+                TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+                
+                return;
+                
+            }
+            
+            twi_stats.transfers++;
+            
+            break;
+        
+        default:
+            
+            // not acknowledged or arbitration lost
+            twi_tail = twi_head;
+            twi_stats.errors++;
+            
+            break;
+        
+    }
+    
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+    twi_running = 0;
+    
+}
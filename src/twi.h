@@ -0,0 +1,58 @@
+# ifndef TWI_H
+# define TWI_H
+
+// ------------------------------------------------------------ //
+// interrupt driven TWI (I2C) master, write only
+//
+// bytes for one slave are queued and sent in the background by
+// the TWI interrupt, as one transfer for as long as the queue
+// does not run dry:
+//
+//   START | address + W | byte | byte | ... | STOP
+//
+// bytes queued while a transfer runs extend it, so a stream of
+// writes costs the address byte only once, writing to another
+// slave waits until the queue is empty
+//
+// slaves that do not acknowledge are counted as errors, the
+// rest of their transfer is dropped
+
+// ------------------------------------------------------------ //
+// settings
+
+// bus clock, 100 kHz is the most the PCF8574 of the LCD backpack
+// is rated for (the backpack also relies on the bus to space the
+// instructions of the panel, see LCDi2cWrite)
+# ifndef TWI_FREQ
+# define TWI_FREQ 100000UL
+# endif
+
+// size of the queue (must be a power of 2)
+# define TWI_QUEUE_SIZE 64
+
+
+// ------------------------------------------------------------ //
+// counters (bytes and transfers sent, bytes the writer waited
+// for room, transfers that were not acknowledged)
+
+typedef struct twiStats {
+    
+    uint32_t bytes;
+    uint16_t transfers;
+    uint16_t waits;
+    uint16_t errors;
+    
+} twiStats;
+
+
+// ------------------------------------------------------------ //
+// user commands for the TWI
+
+void TWIinit(void);
+void TWIwrite(uint8_t address, const uint8_t * data, uint8_t length);
+uint8_t TWIroom(void);
+uint8_t TWIbusy(void);
+void TWIflush(void);
+const twiStats * TWIstats(void);
+
+# endif
@@ -0,0 +1,209 @@
+// -------------------------------------------------- //
+// dependencies
+
+# include <stdint.h>
+
+# include <avr/io.h>
+# include <avr/interrupt.h>
+# include <avr/pgmspace.h>
+
+# include "uart.h"
+# include "macros.h"
+
+
+// -------------------------------------------------- //
+// transmit ring buffer
+//
+// head is only changed by the writer, tail only by the
+// interrupt, so no locking is needed for 8-bit indices
+
+static volatile uint8_t tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+
+
+// -------------------------------------------------- //
+// receive ring buffer (head written by the interrupt, tail
+// by the reader, bytes are dropped when it is full)
+
+static volatile uint8_t rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+
+
+// -------------------------------------------------- //
+// 1 while text was sent since the last delimiter
+
+static uint8_t tx_text = 0;
+
+
+// -------------------------------------------------- //
+// initialize the serial port (8N1, double speed)
+
+void UARTinit(void) {
+    
+    UBRR0  = (F_CPU / 8 / UART_BAUD) - 1;
+    UCSR0A = (1 << U2X0);
+    UCSR0B = (1 << TXEN0) | (1 << RXEN0) | (1 << RXCIE0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    
+}
+
+
+// -------------------------------------------------- //
+// queue one byte for transmission
+
+void UARTputc(uint8_t c) {
+    
+    uint8_t next = (tx_head + 1) & (UART_TX_BUFFER_SIZE - 1);
+    
+    // wait for the interrupt to make room
+    while (next == tx_tail);
+    
+    tx_buffer[tx_head] = c;
+    tx_head = next;
+    
+    // (re)enable the data register empty interrupt
+    set_io_bit(UCSR0B, UDRIE0);
+    
+}
+
+
+// -------------------------------------------------- //
+// delimits text from frames (see uart.h)
+
+static void UARTbeginText(void) {
+    
+    if (!tx_text) {
+        
+        UARTputc(0x00);
+        tx_text = 1;
+        
+    }
+    
+}
+
+void UARTendText(void) {
+    
+    if (tx_text) {
+        
+        UARTputc(0x00);
+        tx_text = 0;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// queue a block of bytes for transmission
+
+void UARTwrite(const uint8_t * data, uint8_t length) {
+    
+    UARTendText();
+    
+    for (uint8_t i = 0; i < length; i++) {
+        
+        UARTputc(data[i]);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// queue a string for transmission
+
+void UARTprint(const char * data) {
+    
+    UARTbeginText();
+    
+    for (int i = 0; data[i] != '\0'; i++) {
+        
+        UARTputc(data[i]);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// queue a string from flash for transmission
+
+void UARTprint_P(PGM_P data) {
+    
+    char c;
+    
+    UARTbeginText();
+    
+    while ((c = pgm_read_byte(data++)) != '\0') {
+        
+        UARTputc(c);
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// number of received bytes waiting in the buffer
+
+uint8_t UARTavailable(void) {
+    
+    return (rx_head - rx_tail) & (UART_RX_BUFFER_SIZE - 1);
+    
+}
+
+
+// -------------------------------------------------- //
+// takes the next received byte (check UARTavailable first)
+
+uint8_t UARTgetc(void) {
+    
+    uint8_t c = rx_buffer[rx_tail];
+    
+    rx_tail = (rx_tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+    
+    return c;
+    
+}
+
+
+// -------------------------------------------------- //
+// interrupt service routine for USART receive complete
+
+ISR(USART_RX_vect) {
+    
+    uint8_t c = UDR0;
+    uint8_t next = (rx_head + 1) & (UART_RX_BUFFER_SIZE - 1);
+    
+    if (next != rx_tail) {
+        
+        rx_buffer[rx_head] = c;
+        rx_head = next;
+        
+    }
+    
+}
+
+
+// -------------------------------------------------- //
+// interrupt service routine for USART data register empty
+//
+// moves the next byte of the buffer into the data register
+// and disables itself once the buffer is empty
+
+ISR(USART_UDRE_vect) {
+    
+    if (tx_head == tx_tail) {
+        
+        clear_io_bit(UCSR0B, UDRIE0);
+        
+    } else {
+        
+        UDR0 = tx_buffer[tx_tail];
+        tx_tail = (tx_tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+        
+    }
+    
+}
@@ -0,0 +1,58 @@
+# ifndef UART_H
+# define UART_H
+
+// ------------------------------------------------------------ //
+// settings
+
+// baud rate of the serial port (double speed mode is used)
+# ifndef UART_BAUD
+# define UART_BAUD 115200UL
+# endif
+
+// size of the transmit and receive buffers (must be powers of 2)
+# define UART_TX_BUFFER_SIZE 64
+# define UART_RX_BUFFER_SIZE 32
+
+
+// ------------------------------------------------------------ //
+// initialization of the serial port
+
+void UARTinit(void);
+
+
+// ------------------------------------------------------------ //
+// user commands for sending data
+//
+// the data is queued in the transmit buffer and sent in the
+// background by the UDRE interrupt, the functions only block
+// if the buffer is full
+//
+// text (UARTprint) shares the port with the telemetry frames
+// (UARTwrite), so it is kept between 0x00 delimiters like a
+// frame: a 0x00 goes out before text that follows a frame and
+// before a frame that follows text (or at UARTendText), so text
+// never runs into a frame and only costs the receiver a block
+// it cannot decode
+
+void UARTputc(uint8_t c);
+void UARTwrite(const uint8_t * data, uint8_t length);
+void UARTprint(const char * data);
+
+// same for strings in flash (PSTR or PROGMEM)
+void UARTprint_P(const char * data);
+
+// ends the text sent so far (e.g. a reply) right away instead of
+// before the next frame
+void UARTendText(void);
+
+
+// ------------------------------------------------------------ //
+// user commands for receiving data
+//
+// received bytes are collected by the RX interrupt, the buffer
+// holds UART_RX_BUFFER_SIZE - 1 bytes
+
+uint8_t UARTavailable(void);
+uint8_t UARTgetc(void);
+
+# endif